@@ -0,0 +1,331 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+// GL Includes
+#include <GL/glew.h>
+
+// How a channel is stored on disk (see AnimationFile.h): angles in degrees keep 16 bits per turn,
+// any other value is normalized to the channel's own range
+enum AnimationChannelType
+{
+	ANIMATION_CHANNEL_VALUE = 0,
+	ANIMATION_CHANNEL_ANGLE
+};
+
+// A value at a given time, in seconds
+struct AnimationKey
+{
+	GLfloat time;
+	GLfloat value;
+};
+
+// Keys of a single animated variable, sorted by time and linearly interpolated.
+// Evaluation remembers the last segment used, so playing forward (or backward) is O(1) amortized;
+// a jump somewhere else falls back to a binary search.
+class AnimationChannel
+{
+public:
+	AnimationChannel() : cursor(0)
+	{
+	}
+
+	// Inserts a key keeping the order, a key at an existing time replaces its value
+	void AddKey(GLfloat time, GLfloat value)
+	{
+		AnimationKey key = { time, value };
+		std::vector<AnimationKey>::iterator it = std::lower_bound(this->keys.begin(), this->keys.end(), key, compareKeys);
+
+		if (it != this->keys.end() && it->time == time)
+		{
+			it->value = value;
+		}
+		else
+		{
+			this->keys.insert(it, key);
+		}
+
+		this->cursor = 0;
+	}
+
+	void Clear()
+	{
+		this->keys.clear();
+		this->cursor = 0;
+	}
+
+	void Reserve(size_t count)
+	{
+		this->keys.reserve(count);
+	}
+
+	// Value at time t, held constant before the first and after the last key
+	GLfloat Evaluate(GLfloat t)
+	{
+		if (this->keys.empty())
+		{
+			return 0.0f;
+		}
+
+		if (t <= this->keys.front().time)
+		{
+			return this->keys.front().value;
+		}
+
+		if (t >= this->keys.back().time)
+		{
+			return this->keys.back().value;
+		}
+
+		size_t i = this->findSegment(t);
+		const AnimationKey &a = this->keys[i];
+		const AnimationKey &b = this->keys[i + 1];
+		GLfloat span = b.time - a.time;
+		GLfloat alpha = (span > 0.0f) ? (t - a.time) / span : 0.0f;
+
+		return a.value + (b.value - a.value) * alpha;
+	}
+
+	size_t GetKeyCount() const
+	{
+		return this->keys.size();
+	}
+
+	const AnimationKey &GetKey(size_t i) const
+	{
+		return this->keys[i];
+	}
+
+	GLfloat GetStartTime() const
+	{
+		return this->keys.empty() ? 0.0f : this->keys.front().time;
+	}
+
+	GLfloat GetEndTime() const
+	{
+		return this->keys.empty() ? 0.0f : this->keys.back().time;
+	}
+
+private:
+	std::vector<AnimationKey> keys;
+	size_t cursor; // Segment [cursor, cursor + 1] used by the last evaluation
+
+	static bool compareKeys(const AnimationKey &a, const AnimationKey &b)
+	{
+		return a.time < b.time;
+	}
+
+	// Index i such that keys[i].time <= t < keys[i + 1].time, t must be inside the key range
+	size_t findSegment(GLfloat t)
+	{
+		size_t last = this->keys.size() - 1;
+
+		if (this->cursor < last)
+		{
+			// Same segment as last time, the common case while playing
+			if (this->keys[this->cursor].time <= t && t < this->keys[this->cursor + 1].time)
+			{
+				return this->cursor;
+			}
+
+			// Next or previous segment, when a frame crosses a key
+			if (this->cursor + 1 < last && this->keys[this->cursor + 1].time <= t && t < this->keys[this->cursor + 2].time)
+			{
+				return ++this->cursor;
+			}
+
+			if (this->cursor > 0 && this->keys[this->cursor - 1].time <= t && t < this->keys[this->cursor].time)
+			{
+				return --this->cursor;
+			}
+		}
+
+		// Seek: first key after t, the segment starts one before it
+		AnimationKey key = { t, 0.0f };
+		std::vector<AnimationKey>::iterator it = std::upper_bound(this->keys.begin(), this->keys.end(), key, compareKeys);
+		this->cursor = (size_t)(it - this->keys.begin()) - 1;
+
+		return this->cursor;
+	}
+};
+
+// A set of named channels, each one optionally bound to the variable it animates
+class AnimationClip
+{
+public:
+	AnimationClip() : looping(false)
+	{
+	}
+
+	// Adds a channel and returns its index. When target is given Capture/Apply read and write it.
+	GLuint AddChannel(const std::string &name, GLfloat *target = nullptr, AnimationChannelType type = ANIMATION_CHANNEL_VALUE)
+	{
+		this->names.push_back(name);
+		this->targets.push_back(target);
+		this->types.push_back(type);
+		this->channels.push_back(AnimationChannel());
+
+		return (GLuint)this->channels.size() - 1;
+	}
+
+	// Index of the channel with that name, -1 when there is none
+	GLint FindChannel(const std::string &name) const
+	{
+		for (GLuint i = 0; i < this->names.size(); i++)
+		{
+			if (this->names[i] == name)
+			{
+				return (GLint)i;
+			}
+		}
+
+		return -1;
+	}
+
+	AnimationChannel &GetChannel(GLuint i)
+	{
+		return this->channels[i];
+	}
+
+	const std::string &GetChannelName(GLuint i) const
+	{
+		return this->names[i];
+	}
+
+	AnimationChannelType GetChannelType(GLuint i) const
+	{
+		return this->types[i];
+	}
+
+	GLuint GetChannelCount() const
+	{
+		return (GLuint)this->channels.size();
+	}
+
+	// Stores the current value of every bound variable as a key at the given time
+	void Capture(GLfloat time)
+	{
+		for (GLuint i = 0; i < this->channels.size(); i++)
+		{
+			if (this->targets[i])
+			{
+				this->channels[i].AddKey(time, *this->targets[i]);
+			}
+		}
+	}
+
+	// Writes the value of every channel at time t into its bound variable
+	void Apply(GLfloat t)
+	{
+		t = this->wrapTime(t);
+
+		for (GLuint i = 0; i < this->channels.size(); i++)
+		{
+			if (this->targets[i])
+			{
+				*this->targets[i] = this->channels[i].Evaluate(t);
+			}
+		}
+	}
+
+	// Same as Apply, but into an array with one value per channel
+	void Evaluate(GLfloat t, GLfloat *values)
+	{
+		t = this->wrapTime(t);
+
+		for (GLuint i = 0; i < this->channels.size(); i++)
+		{
+			values[i] = this->channels[i].Evaluate(t);
+		}
+	}
+
+	void Clear()
+	{
+		for (GLuint i = 0; i < this->channels.size(); i++)
+		{
+			this->channels[i].Clear();
+		}
+	}
+
+	// Time of the earliest key of any channel
+	GLfloat GetStartTime() const
+	{
+		GLfloat start = 0.0f;
+		bool first = true;
+
+		for (GLuint i = 0; i < this->channels.size(); i++)
+		{
+			if (this->channels[i].GetKeyCount())
+			{
+				start = first ? this->channels[i].GetStartTime() : std::min(start, this->channels[i].GetStartTime());
+				first = false;
+			}
+		}
+
+		return start;
+	}
+
+	// Time of the latest key of any channel
+	GLfloat GetEndTime() const
+	{
+		GLfloat end = 0.0f;
+		bool first = true;
+
+		for (GLuint i = 0; i < this->channels.size(); i++)
+		{
+			if (this->channels[i].GetKeyCount())
+			{
+				end = first ? this->channels[i].GetEndTime() : std::max(end, this->channels[i].GetEndTime());
+				first = false;
+			}
+		}
+
+		return end;
+	}
+
+	GLfloat GetDuration() const
+	{
+		return this->GetEndTime() - this->GetStartTime();
+	}
+
+	void SetLooping(bool looping)
+	{
+		this->looping = looping;
+	}
+
+	bool IsLooping() const
+	{
+		return this->looping;
+	}
+
+private:
+	std::vector<AnimationChannel> channels;
+	std::vector<std::string> names;
+	std::vector<GLfloat *> targets;
+	std::vector<AnimationChannelType> types;
+	bool looping;
+
+	GLfloat wrapTime(GLfloat t) const
+	{
+		GLfloat start = this->GetStartTime();
+		GLfloat duration = this->GetEndTime() - start;
+
+		if (this->looping && duration > 0.0f)
+		{
+			GLfloat local = fmodf(t - start, duration);
+
+			if (local < 0.0f)
+			{
+				local += duration;
+			}
+
+			t = start + local;
+		}
+
+		return t;
+	}
+};
@@ -0,0 +1,374 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+// SIMD Includes
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// GL Includes
+#include <GL/glew.h>
+
+#include "Animation.h"
+#include "JobSystem.h"
+
+// Evaluation kernels, the best one compiled in is used by default (/arch:AVX2 or /arch:AVX512 in MSVC)
+enum AnimationKernel
+{
+	ANIMATION_KERNEL_SCALAR = 0,
+	ANIMATION_KERNEL_AVX2,
+	ANIMATION_KERNEL_AVX512
+};
+
+// Instances are processed in blocks of this many lanes, arrays are padded to it
+const GLuint ANIMATION_BATCH_LANES = 16;
+
+// Blocks per job when the update is split over a job system (1024 instances)
+const GLuint ANIMATION_BATCH_JOB_BLOCKS = 64;
+
+// Plays one clip on many instances, each with its own time and speed. Everything is stored as
+// structure of arrays: per instance the current segment [segStart, segEnd) and, per channel, the value
+// at the start of the segment and its delta. The per frame update is then a straight
+// time += dt * speed; value = from + delta * alpha over contiguous floats, done 8 or 16 lanes at a time.
+// Only the lanes that cross a key drop to scalar code to load their next segment.
+// Every pose holds all the channels, so the batch keys the clip at the key times of all its channels
+// together: a clip from AnimationClip::Capture shares them already, a loaded one (simplified per channel)
+// gets a pose wherever any of its channels has a key.
+class AnimationBatch
+{
+public:
+	// Copies the poses of the clip at the union of its channels' key times
+	AnimationBatch(AnimationClip &clip, bool looping = true) : looping(looping), instanceCount(0), paddedCount(0)
+	{
+		this->channelCount = clip.GetChannelCount();
+
+		for (GLuint c = 0; c < this->channelCount; c++)
+		{
+			AnimationChannel &channel = clip.GetChannel(c);
+
+			for (size_t k = 0; k < channel.GetKeyCount(); k++)
+			{
+				this->keyTimes.push_back(channel.GetKey(k).time);
+			}
+		}
+
+		std::sort(this->keyTimes.begin(), this->keyTimes.end());
+		this->keyTimes.erase(std::unique(this->keyTimes.begin(), this->keyTimes.end()), this->keyTimes.end());
+
+		for (size_t k = 0; k < this->keyTimes.size(); k++)
+		{
+			for (GLuint c = 0; c < this->channelCount; c++)
+			{
+				this->keyValues.push_back(clip.GetChannel(c).Evaluate(this->keyTimes[k]));
+			}
+		}
+
+		this->from.resize(this->channelCount);
+		this->delta.resize(this->channelCount);
+		this->values.resize(this->channelCount);
+
+#if defined(__AVX512F__)
+		this->kernel = ANIMATION_KERNEL_AVX512;
+#elif defined(__AVX2__)
+		this->kernel = ANIMATION_KERNEL_AVX2;
+#else
+		this->kernel = ANIMATION_KERNEL_SCALAR;
+#endif
+	}
+
+	// Adds an instance starting at the given clip time and playback speed, returns its index. Instances only
+	// play forward (segments are only advanced past their end): a negative speed is clamped to 0, which
+	// holds the instance at its start pose.
+	GLuint AddInstance(GLfloat startTime = 0.0f, GLfloat speed = 1.0f)
+	{
+		GLuint i = this->instanceCount++;
+
+		if (this->instanceCount > this->paddedCount)
+		{
+			this->paddedCount += ANIMATION_BATCH_LANES;
+			this->resize();
+		}
+
+		this->time[i] = this->keyTimes.empty() ? 0.0f : this->keyTimes.front() + startTime;
+		this->speed[i] = std::max(speed, 0.0f);
+		this->keyIndex[i] = 0;
+		this->loadSegment(i);
+
+		return i;
+	}
+
+	// Advances every instance by deltaTime seconds, which must not be negative. With a job system the blocks of instances are
+	// split in jobs of ANIMATION_BATCH_JOB_BLOCKS blocks each.
+	void Update(GLfloat deltaTime, JobSystem *jobs = nullptr)
+	{
+		GLuint blocks = this->paddedCount / ANIMATION_BATCH_LANES;
+
+		if (!jobs)
+		{
+			this->updateRange(0, this->paddedCount, deltaTime);
+			return;
+		}
+
+		jobs->ParallelFor(blocks, ANIMATION_BATCH_JOB_BLOCKS, [this, deltaTime](GLuint begin, GLuint end, GLuint)
+		{
+			this->updateRange(begin * ANIMATION_BATCH_LANES, end * ANIMATION_BATCH_LANES, deltaTime);
+		});
+	}
+
+	GLfloat GetValue(GLuint channel, GLuint instance) const
+	{
+		return this->values[channel][instance];
+	}
+
+	// Contiguous values of one channel for every instance
+	const GLfloat *GetChannelData(GLuint channel) const
+	{
+		return this->values[channel].data();
+	}
+
+	GLuint GetInstanceCount() const
+	{
+		return this->instanceCount;
+	}
+
+	GLuint GetChannelCount() const
+	{
+		return this->channelCount;
+	}
+
+	// Selects a kernel, falling back to the best one that was compiled in
+	void SetKernel(AnimationKernel requested)
+	{
+#if defined(__AVX512F__)
+		this->kernel = requested;
+#elif defined(__AVX2__)
+		this->kernel = std::min(requested, ANIMATION_KERNEL_AVX2);
+#else
+		this->kernel = ANIMATION_KERNEL_SCALAR;
+		(void)requested;
+#endif
+	}
+
+	AnimationKernel GetKernel() const
+	{
+		return this->kernel;
+	}
+
+private:
+	/*  Clip data  */
+	std::vector<GLfloat> keyTimes;
+	std::vector<GLfloat> keyValues; // keyValues[key * channelCount + channel]
+	GLuint channelCount;
+	bool looping;
+	AnimationKernel kernel;
+
+	/*  Instance data (structure of arrays)  */
+	GLuint instanceCount, paddedCount;
+	std::vector<GLfloat> time, speed, segStart, segEnd, invSpan;
+	std::vector<GLuint> keyIndex;
+	std::vector<std::vector<GLfloat> > from, delta, values;
+
+	/*  Functions    */
+	// Padding lanes never move and never reach the end of their segment
+	void resize()
+	{
+		GLfloat never = std::numeric_limits<GLfloat>::max();
+
+		this->time.resize(this->paddedCount, 0.0f);
+		this->speed.resize(this->paddedCount, 0.0f);
+		this->segStart.resize(this->paddedCount, 0.0f);
+		this->segEnd.resize(this->paddedCount, never);
+		this->invSpan.resize(this->paddedCount, 0.0f);
+		this->keyIndex.resize(this->paddedCount, 0);
+
+		for (GLuint c = 0; c < this->channelCount; c++)
+		{
+			this->from[c].resize(this->paddedCount, 0.0f);
+			this->delta[c].resize(this->paddedCount, 0.0f);
+			this->values[c].resize(this->paddedCount, 0.0f);
+		}
+	}
+
+	// Finds the segment that holds the instance's time (wrapping it when looping) and loads its values
+	void loadSegment(GLuint i)
+	{
+		GLuint keys = (GLuint)this->keyTimes.size();
+
+		if (keys < 2)
+		{
+			this->segEnd[i] = std::numeric_limits<GLfloat>::max();
+			this->invSpan[i] = 0.0f;
+
+			for (GLuint c = 0; c < this->channelCount; c++)
+			{
+				this->from[c][i] = keys ? this->keyValues[c] : 0.0f;
+				this->delta[c][i] = 0.0f;
+				this->values[c][i] = this->from[c][i];
+			}
+
+			return;
+		}
+
+		GLfloat first = this->keyTimes.front();
+		GLfloat last = this->keyTimes.back();
+
+		if (this->time[i] >= last)
+		{
+			if (this->looping)
+			{
+				this->time[i] = first + fmodf(this->time[i] - first, last - first);
+				this->keyIndex[i] = 0;
+			}
+			else
+			{
+				// Hold the last pose
+				this->keyIndex[i] = keys - 1;
+				this->segStart[i] = last;
+				this->segEnd[i] = std::numeric_limits<GLfloat>::max();
+				this->invSpan[i] = 0.0f;
+
+				for (GLuint c = 0; c < this->channelCount; c++)
+				{
+					this->from[c][i] = this->keyValues[(keys - 1) * this->channelCount + c];
+					this->delta[c][i] = 0.0f;
+					this->values[c][i] = this->from[c][i];
+				}
+
+				return;
+			}
+		}
+
+		// Usually only one step forward from the cached key
+		GLuint k = this->keyIndex[i];
+
+		if (k >= keys - 1 || this->keyTimes[k] > this->time[i])
+		{
+			k = 0;
+		}
+
+		while (k + 2 < keys && this->keyTimes[k + 1] <= this->time[i])
+		{
+			k++;
+		}
+
+		this->keyIndex[i] = k;
+		this->segStart[i] = this->keyTimes[k];
+		this->segEnd[i] = this->keyTimes[k + 1];
+
+		GLfloat span = this->segEnd[i] - this->segStart[i];
+		this->invSpan[i] = (span > 0.0f) ? 1.0f / span : 0.0f;
+
+		GLfloat alpha = std::min(std::max((this->time[i] - this->segStart[i]) * this->invSpan[i], 0.0f), 1.0f);
+
+		for (GLuint c = 0; c < this->channelCount; c++)
+		{
+			GLfloat a = this->keyValues[k * this->channelCount + c];
+			GLfloat b = this->keyValues[(k + 1) * this->channelCount + c];
+
+			this->from[c][i] = a;
+			this->delta[c][i] = b - a;
+			this->values[c][i] = a + (b - a) * alpha;
+		}
+	}
+
+	// [begin, end) must be multiples of ANIMATION_BATCH_LANES
+	void updateRange(GLuint begin, GLuint end, GLfloat deltaTime)
+	{
+		for (GLuint block = begin; block < end; block += ANIMATION_BATCH_LANES)
+		{
+			GLuint crossed = 0;
+
+			switch (this->kernel)
+			{
+#if defined(__AVX512F__)
+			case ANIMATION_KERNEL_AVX512:
+				crossed = this->updateBlockAVX512(block, deltaTime);
+				break;
+#endif
+#if defined(__AVX2__) || defined(__AVX512F__)
+			case ANIMATION_KERNEL_AVX2:
+				crossed = this->updateBlockAVX2(block, deltaTime) | (this->updateBlockAVX2(block + 8, deltaTime) << 8);
+				break;
+#endif
+			default:
+				crossed = this->updateBlockScalar(block, deltaTime);
+				break;
+			}
+
+			// Lanes that reached the end of their segment load the next one
+			for (GLuint lane = 0; crossed; lane++, crossed >>= 1)
+			{
+				if (crossed & 1)
+				{
+					this->loadSegment(block + lane);
+				}
+			}
+		}
+	}
+
+	// Returns a bit per lane that crossed its segment end
+	GLuint updateBlockScalar(GLuint block, GLfloat deltaTime)
+	{
+		GLuint crossed = 0;
+
+		for (GLuint lane = 0; lane < ANIMATION_BATCH_LANES; lane++)
+		{
+			GLuint i = block + lane;
+			GLfloat t = this->time[i] + deltaTime * this->speed[i];
+			GLfloat alpha = std::min((t - this->segStart[i]) * this->invSpan[i], 1.0f);
+
+			this->time[i] = t;
+
+			for (GLuint c = 0; c < this->channelCount; c++)
+			{
+				this->values[c][i] = this->from[c][i] + this->delta[c][i] * alpha;
+			}
+
+			crossed |= (t >= this->segEnd[i]) ? (1u << lane) : 0u;
+		}
+
+		return crossed;
+	}
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+	// 8 lanes, without FMA so it also builds with plain -mavx2
+	GLuint updateBlockAVX2(GLuint i, GLfloat deltaTime)
+	{
+		__m256 t = _mm256_add_ps(_mm256_loadu_ps(&this->time[i]), _mm256_mul_ps(_mm256_set1_ps(deltaTime), _mm256_loadu_ps(&this->speed[i])));
+		__m256 alpha = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(t, _mm256_loadu_ps(&this->segStart[i])), _mm256_loadu_ps(&this->invSpan[i])), _mm256_set1_ps(1.0f));
+
+		_mm256_storeu_ps(&this->time[i], t);
+
+		for (GLuint c = 0; c < this->channelCount; c++)
+		{
+			__m256 value = _mm256_add_ps(_mm256_loadu_ps(&this->from[c][i]), _mm256_mul_ps(_mm256_loadu_ps(&this->delta[c][i]), alpha));
+			_mm256_storeu_ps(&this->values[c][i], value);
+		}
+
+		return (GLuint)_mm256_movemask_ps(_mm256_cmp_ps(t, _mm256_loadu_ps(&this->segEnd[i]), _CMP_GE_OQ));
+	}
+#endif
+
+#if defined(__AVX512F__)
+	// 16 lanes
+	GLuint updateBlockAVX512(GLuint i, GLfloat deltaTime)
+	{
+		__m512 t = _mm512_fmadd_ps(_mm512_set1_ps(deltaTime), _mm512_loadu_ps(&this->speed[i]), _mm512_loadu_ps(&this->time[i]));
+		__m512 alpha = _mm512_min_ps(_mm512_mul_ps(_mm512_sub_ps(t, _mm512_loadu_ps(&this->segStart[i])), _mm512_loadu_ps(&this->invSpan[i])), _mm512_set1_ps(1.0f));
+
+		_mm512_storeu_ps(&this->time[i], t);
+
+		for (GLuint c = 0; c < this->channelCount; c++)
+		{
+			__m512 value = _mm512_fmadd_ps(_mm512_loadu_ps(&this->delta[c][i]), alpha, _mm512_loadu_ps(&this->from[c][i]));
+			_mm512_storeu_ps(&this->values[c][i], value);
+		}
+
+		return (GLuint)_mm512_cmp_ps_mask(t, _mm512_loadu_ps(&this->segEnd[i]), _CMP_GE_OQ);
+	}
+#endif
+};
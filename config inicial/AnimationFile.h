@@ -0,0 +1,346 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include "Animation.h"
+
+// Binary clip format, little endian, one block per channel so it can be decoded while it streams in:
+//   "ANIM" | u16 version | u16 channelCount | f32 startTime | f32 duration
+//   per channel: u8 nameLength | name | u8 type | u32 keyCount | f32 base | f32 range
+//                keyCount x u16 time (normalized to the clip) | keyCount x u16 value
+// Value channels store (value - base) / range in 16 bits. Angle channels store the angle modulo 360
+// in 16 bits and are unwrapped on load, base holds the first key's full turns. Every key takes
+// 4 bytes on disk against 8 in memory, before the curve simplification removes the redundant ones.
+const char ANIMATION_FILE_MAGIC[4] = { 'A', 'N', 'I', 'M' };
+const GLushort ANIMATION_FILE_VERSION = 1;
+const GLfloat ANIMATION_QUANTIZATION_STEPS = 65535.0f;
+
+// Default simplification tolerances: scene units for values, degrees for angles
+const GLfloat ANIMATION_VALUE_TOLERANCE = 0.001f;
+const GLfloat ANIMATION_ANGLE_TOLERANCE = 0.1f;
+
+/*  Little endian helpers  */
+inline void WriteAnimationU16(std::ostream &out, GLushort value)
+{
+	char bytes[2] = { (char)(value & 0xFF), (char)(value >> 8) };
+	out.write(bytes, 2);
+}
+
+inline void WriteAnimationU32(std::ostream &out, GLuint value)
+{
+	char bytes[4] = { (char)(value & 0xFF), (char)((value >> 8) & 0xFF), (char)((value >> 16) & 0xFF), (char)(value >> 24) };
+	out.write(bytes, 4);
+}
+
+inline void WriteAnimationF32(std::ostream &out, GLfloat value)
+{
+	GLuint bits;
+	memcpy(&bits, &value, sizeof(bits));
+	WriteAnimationU32(out, bits);
+}
+
+inline GLushort ReadAnimationU16(const unsigned char *bytes)
+{
+	return (GLushort)(bytes[0] | (bytes[1] << 8));
+}
+
+inline GLuint ReadAnimationU32(const unsigned char *bytes)
+{
+	return (GLuint)bytes[0] | ((GLuint)bytes[1] << 8) | ((GLuint)bytes[2] << 16) | ((GLuint)bytes[3] << 24);
+}
+
+inline GLfloat ReadAnimationF32(const unsigned char *bytes)
+{
+	GLuint bits = ReadAnimationU32(bytes);
+	GLfloat value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+inline GLushort QuantizeAnimationValue(GLfloat normalized)
+{
+	return (GLushort)(std::min(std::max(normalized, 0.0f), 1.0f) * ANIMATION_QUANTIZATION_STEPS + 0.5f);
+}
+
+// Removes the keys that linear interpolation between their neighbours already reproduces within the tolerance.
+// Greedy: from each kept key, reach the furthest key whose line still passes close to every key in between.
+inline std::vector<AnimationKey> SimplifyAnimationKeys(const std::vector<AnimationKey> &keys, GLfloat tolerance)
+{
+	if (keys.size() <= 2)
+	{
+		return keys;
+	}
+
+	std::vector<AnimationKey> kept;
+	size_t anchor = 0;
+	kept.push_back(keys[0]);
+
+	while (anchor < keys.size() - 1)
+	{
+		size_t end = anchor + 1;
+
+		for (size_t candidate = anchor + 2; candidate < keys.size(); candidate++)
+		{
+			const AnimationKey &a = keys[anchor];
+			const AnimationKey &b = keys[candidate];
+			bool fits = true;
+
+			for (size_t i = anchor + 1; i < candidate && fits; i++)
+			{
+				GLfloat span = b.time - a.time;
+				GLfloat alpha = (span > 0.0f) ? (keys[i].time - a.time) / span : 0.0f;
+				fits = fabsf(a.value + (b.value - a.value) * alpha - keys[i].value) <= tolerance;
+			}
+
+			if (!fits)
+			{
+				break;
+			}
+
+			end = candidate;
+		}
+
+		kept.push_back(keys[end]);
+		anchor = end;
+	}
+
+	return kept;
+}
+
+// Splits the segments that turn half a circle or more, so the shortest path unwrap on load gives the same curve
+inline std::vector<AnimationKey> SplitAngleKeys(const std::vector<AnimationKey> &keys)
+{
+	std::vector<AnimationKey> split;
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		if (i > 0)
+		{
+			const AnimationKey &a = keys[i - 1];
+			const AnimationKey &b = keys[i];
+			GLuint pieces = (GLuint)(fabsf(b.value - a.value) / 179.0f) + 1;
+
+			for (GLuint p = 1; p < pieces; p++)
+			{
+				GLfloat alpha = (GLfloat)p / pieces;
+				AnimationKey middle = { a.time + (b.time - a.time) * alpha, a.value + (b.value - a.value) * alpha };
+				split.push_back(middle);
+			}
+		}
+
+		split.push_back(keys[i]);
+	}
+
+	return split;
+}
+
+// Writes the clip. Tolerances of 0 keep every key.
+inline bool SaveAnimationClip(std::ostream &out, AnimationClip &clip, GLfloat valueTolerance = ANIMATION_VALUE_TOLERANCE, GLfloat angleTolerance = ANIMATION_ANGLE_TOLERANCE)
+{
+	GLfloat startTime = clip.GetStartTime();
+	GLfloat duration = clip.GetDuration();
+
+	out.write(ANIMATION_FILE_MAGIC, 4);
+	WriteAnimationU16(out, ANIMATION_FILE_VERSION);
+	WriteAnimationU16(out, (GLushort)clip.GetChannelCount());
+	WriteAnimationF32(out, startTime);
+	WriteAnimationF32(out, duration);
+
+	for (GLuint c = 0; c < clip.GetChannelCount(); c++)
+	{
+		AnimationChannel &channel = clip.GetChannel(c);
+		AnimationChannelType type = clip.GetChannelType(c);
+		const std::string &name = clip.GetChannelName(c);
+		std::vector<AnimationKey> keys;
+
+		for (size_t k = 0; k < channel.GetKeyCount(); k++)
+		{
+			keys.push_back(channel.GetKey(k));
+		}
+
+		keys = SimplifyAnimationKeys(keys, (ANIMATION_CHANNEL_ANGLE == type) ? angleTolerance : valueTolerance);
+
+		GLfloat base = 0.0f, range = 0.0f;
+
+		if (ANIMATION_CHANNEL_ANGLE == type)
+		{
+			keys = SplitAngleKeys(keys);
+			base = keys.empty() ? 0.0f : floorf(keys[0].value / 360.0f) * 360.0f;
+			range = 360.0f;
+		}
+		else if (!keys.empty())
+		{
+			GLfloat maxValue = keys[0].value;
+			base = keys[0].value;
+
+			for (size_t k = 0; k < keys.size(); k++)
+			{
+				base = std::min(base, keys[k].value);
+				maxValue = std::max(maxValue, keys[k].value);
+			}
+
+			range = maxValue - base;
+		}
+
+		out.put((char)std::min(name.size(), (size_t)255));
+		out.write(name.data(), std::min(name.size(), (size_t)255));
+		out.put((char)type);
+		WriteAnimationU32(out, (GLuint)keys.size());
+		WriteAnimationF32(out, base);
+		WriteAnimationF32(out, range);
+
+		for (size_t k = 0; k < keys.size(); k++)
+		{
+			WriteAnimationU16(out, QuantizeAnimationValue((duration > 0.0f) ? (keys[k].time - startTime) / duration : 0.0f));
+		}
+
+		for (size_t k = 0; k < keys.size(); k++)
+		{
+			if (ANIMATION_CHANNEL_ANGLE == type)
+			{
+				GLfloat angle = fmodf(keys[k].value, 360.0f);
+				angle = (angle < 0.0f) ? angle + 360.0f : angle;
+				WriteAnimationU16(out, (GLushort)((GLuint)(angle / 360.0f * 65536.0f + 0.5f) & 0xFFFF));
+			}
+			else
+			{
+				WriteAnimationU16(out, QuantizeAnimationValue((range > 0.0f) ? (keys[k].value - base) / range : 0.0f));
+			}
+		}
+	}
+
+	return out.good();
+}
+
+// Reads a clip. Channels whose name already exists in the clip replace its keys (keeping the bound
+// variable); the rest are added unbound. Returns false on a malformed or truncated stream.
+inline bool LoadAnimationClip(std::istream &in, AnimationClip &clip)
+{
+	unsigned char header[16];
+
+	if (!in.read((char *)header, sizeof(header)) || memcmp(header, ANIMATION_FILE_MAGIC, 4) != 0)
+	{
+		std::cout << "ERROR::ANIMATION::NOT_AN_ANIMATION_FILE" << std::endl;
+		return false;
+	}
+
+	if (ReadAnimationU16(header + 4) != ANIMATION_FILE_VERSION)
+	{
+		std::cout << "ERROR::ANIMATION::UNSUPPORTED_VERSION" << std::endl;
+		return false;
+	}
+
+	GLuint channelCount = ReadAnimationU16(header + 6);
+	GLfloat startTime = ReadAnimationF32(header + 8);
+	GLfloat duration = ReadAnimationF32(header + 12);
+	std::vector<unsigned char> block;
+
+	for (GLuint c = 0; c < channelCount; c++)
+	{
+		unsigned char nameLength;
+		char name[256];
+		unsigned char channelHeader[13];
+
+		if (!in.read((char *)&nameLength, 1) || !in.read(name, nameLength) || !in.read((char *)channelHeader, sizeof(channelHeader)))
+		{
+			std::cout << "ERROR::ANIMATION::TRUNCATED_FILE" << std::endl;
+			return false;
+		}
+
+		AnimationChannelType type = (AnimationChannelType)channelHeader[0];
+		GLuint keyCount = ReadAnimationU32(channelHeader + 1);
+		GLfloat base = ReadAnimationF32(channelHeader + 5);
+		GLfloat range = ReadAnimationF32(channelHeader + 9);
+
+		// Both key arrays in one read
+		block.resize(keyCount * 4);
+
+		if (keyCount && !in.read((char *)&block[0], block.size()))
+		{
+			std::cout << "ERROR::ANIMATION::TRUNCATED_FILE" << std::endl;
+			return false;
+		}
+
+		std::string channelName(name, nameLength);
+		GLint index = clip.FindChannel(channelName);
+
+		if (index < 0)
+		{
+			index = (GLint)clip.AddChannel(channelName, nullptr, type);
+		}
+
+		AnimationChannel &channel = clip.GetChannel(index);
+		channel.Clear();
+		channel.Reserve(keyCount);
+
+		const unsigned char *times = keyCount ? &block[0] : nullptr;
+		const unsigned char *values = keyCount ? &block[keyCount * 2] : nullptr;
+		GLfloat turn = base;
+		GLfloat previousAngle = 0.0f;
+
+		for (GLuint k = 0; k < keyCount; k++)
+		{
+			GLfloat time = startTime + ReadAnimationU16(times + k * 2) / ANIMATION_QUANTIZATION_STEPS * duration;
+			GLfloat value;
+
+			if (ANIMATION_CHANNEL_ANGLE == type)
+			{
+				GLfloat angle = ReadAnimationU16(values + k * 2) / 65536.0f * 360.0f;
+
+				// Take the shortest way around from the previous key
+				if (k > 0)
+				{
+					GLfloat step = angle - previousAngle;
+					turn += (step > 180.0f) ? -360.0f : ((step < -180.0f) ? 360.0f : 0.0f);
+				}
+
+				previousAngle = angle;
+				value = turn + angle;
+			}
+			else
+			{
+				value = base + ReadAnimationU16(values + k * 2) / ANIMATION_QUANTIZATION_STEPS * range;
+			}
+
+			channel.AddKey(time, value);
+		}
+	}
+
+	return true;
+}
+
+inline bool SaveAnimationClip(const std::string &path, AnimationClip &clip, GLfloat valueTolerance = ANIMATION_VALUE_TOLERANCE, GLfloat angleTolerance = ANIMATION_ANGLE_TOLERANCE)
+{
+	std::ofstream file(path.c_str(), std::ios::binary);
+
+	if (!file)
+	{
+		std::cout << "ERROR::ANIMATION::FILE_NOT_SUCCESFULLY_WRITTEN " << path << std::endl;
+		return false;
+	}
+
+	return SaveAnimationClip(file, clip, valueTolerance, angleTolerance);
+}
+
+inline bool LoadAnimationClip(const std::string &path, AnimationClip &clip)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+
+	if (!file)
+	{
+		std::cout << "ERROR::ANIMATION::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+		return false;
+	}
+
+	return LoadAnimationClip(file, clip);
+}
@@ -0,0 +1,514 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <map>
+#include <utility>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "Frustum.h"
+
+using namespace std;
+
+// Layout read by glMultiDrawElementsIndirect, it must match the GL specification exactly
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// First vertex attribute used by the per instance model matrix (takes locations 3, 4, 5 and 6)
+const GLuint INSTANCE_MATRIX_ATTRIBUTE = 3;
+
+// Collects the whole scene every frame and submits it with one multi-draw call per shader/material bucket.
+// All the registered models share a single vertex/element buffer, and the model matrices travel in a
+// per-instance attribute (see Shader/batched.vs), so the number of draw calls doesn't depend on the
+// number of objects. Needs GL 4.3 or ARB_multi_draw_indirect, plus GL 4.2 or ARB_base_instance since every
+// command starts at its own instance; without them every instance becomes one
+// glMultiDrawElementsBaseVertex call with its matrix set as a constant attribute.
+class BatchRenderer
+{
+public:
+	// Must be constructed once GLEW has been initialized
+	BatchRenderer() : VAO(0), VBO(0), EBO(0), instanceVBO(0), indirectBuffer(0), geometryDirty(false), drawCalls(0), poolVertexCount(0), poolIndexCount(0)
+	{
+		// A baseInstance other than 0 is only honoured with base instance support
+		this->useIndirect = ((GLEW_ARB_multi_draw_indirect || GLEW_VERSION_4_3) && (GLEW_ARB_base_instance || GLEW_VERSION_4_2)) ? true : false;
+	}
+
+	// Destroy() must have run while the context was current
+	~BatchRenderer()
+	{
+		this->Destroy();
+	}
+
+	// Frees the shared buffers. On the context's thread, before the context is destroyed.
+	void Destroy()
+	{
+		if (this->VAO)
+		{
+			glDeleteVertexArrays(1, &this->VAO);
+			glDeleteBuffers(1, &this->VBO);
+			glDeleteBuffers(1, &this->EBO);
+			glDeleteBuffers(1, &this->instanceVBO);
+			glDeleteBuffers(1, &this->indirectBuffer);
+			this->VAO = this->VBO = this->EBO = this->instanceVBO = this->indirectBuffer = 0;
+			GetMemoryTracker().Set(MEMORY_RENDERER, "BatchRenderer", 0, 0);
+		}
+	}
+
+	// Adds the geometry of every mesh of the model to the shared buffers. The model must outlive the renderer,
+	// the buffers are refilled from its meshes whenever another model is added.
+	void AddModel(Model &model)
+	{
+		if (this->entries.count(&model))
+		{
+			return;
+		}
+
+		vector<PoolEntry> &modelEntries = this->entries[&model];
+		vector<Mesh> &meshes = model.GetMeshes();
+
+		for (GLuint i = 0; i < meshes.size(); i++)
+		{
+			Mesh &mesh = meshes[i];
+			PoolEntry entry;
+
+			entry.mesh = &mesh;
+			entry.firstIndex = this->poolIndexCount;
+			entry.indexCount = (GLuint)mesh.indices.size();
+			entry.baseVertex = (GLint)this->poolVertexCount;
+			entry.material = this->findMaterial(mesh.textures);
+
+			this->poolVertexCount += (GLuint)mesh.vertices.size();
+			this->poolIndexCount += (GLuint)mesh.indices.size();
+			this->pooledMeshes.push_back(&mesh);
+			modelEntries.push_back(entry);
+		}
+
+		this->geometryDirty = true;
+	}
+
+	// Starts a new frame, forgetting the previous submissions
+	void Begin()
+	{
+		for (GLuint i = 0; i < this->buckets.size(); i++)
+		{
+			this->buckets[i].commands.clear();
+		}
+
+		this->instances.clear();
+	}
+
+	// Queues one copy of the model
+	void Submit(const Shader &shader, Model &model, const glm::mat4 &transform)
+	{
+		this->Submit(shader, model, &transform, 1);
+	}
+
+	// Queues several copies of the model, they become a single instanced command per mesh
+	void Submit(const Shader &shader, Model &model, const glm::mat4 *transforms, GLuint count)
+	{
+		const vector<PoolEntry> *modelEntries = this->findEntries(model);
+
+		if (!modelEntries || 0 == count)
+		{
+			return;
+		}
+
+		GLuint baseInstance = (GLuint)this->instances.size();
+		this->instances.insert(this->instances.end(), transforms, transforms + count);
+
+		for (GLuint i = 0; i < modelEntries->size(); i++)
+		{
+			const PoolEntry &entry = (*modelEntries)[i];
+			DrawElementsIndirectCommand command;
+
+			command.count = entry.indexCount;
+			command.instanceCount = count;
+			command.firstIndex = entry.firstIndex;
+			command.baseVertex = entry.baseVertex;
+			command.baseInstance = baseInstance;
+
+			this->findBucket(shader.Program, entry.material).commands.push_back(command);
+		}
+	}
+
+	// Queues the model emitting one command per range of meshlets that survives the frustum and cone tests
+	void SubmitCulled(const Shader &shader, Model &model, const glm::mat4 &transform, const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition, bool backfaceCulling = true, MeshletCullStats *stats = nullptr)
+	{
+		const vector<PoolEntry> *modelEntries = this->findEntries(model);
+
+		if (!modelEntries)
+		{
+			return;
+		}
+
+		Frustum frustum(viewProjection * transform);
+		glm::vec3 localCamera = glm::vec3(glm::inverse(transform) * glm::vec4(cameraPosition, 1.0f));
+		GLuint baseInstance = (GLuint)this->instances.size();
+		bool used = false;
+
+		for (GLuint i = 0; i < modelEntries->size(); i++)
+		{
+			const PoolEntry &entry = (*modelEntries)[i];
+			GLuint ranges = entry.mesh->CullMeshlets(frustum, localCamera, backfaceCulling, stats);
+
+			if (0 == ranges)
+			{
+				continue;
+			}
+
+			Bucket &bucket = this->findBucket(shader.Program, entry.material);
+
+			for (GLuint r = 0; r < ranges; r++)
+			{
+				DrawElementsIndirectCommand command;
+
+				command.count = (GLuint)entry.mesh->visibleCount[r];
+				command.instanceCount = 1;
+				command.firstIndex = entry.firstIndex + entry.mesh->visibleFirst[r];
+				command.baseVertex = entry.baseVertex;
+				command.baseInstance = baseInstance;
+
+				bucket.commands.push_back(command);
+			}
+
+			used = true;
+		}
+
+		if (used)
+		{
+			this->instances.push_back(transform);
+		}
+	}
+
+	// Uploads the frame data and draws every bucket. Returns the number of draw calls issued.
+	GLuint Flush()
+	{
+		this->drawCalls = 0;
+
+		if (this->geometryDirty)
+		{
+			this->uploadGeometry();
+		}
+
+		if (this->instances.empty() || !this->VAO)
+		{
+			return 0;
+		}
+
+		// Orphan and refill the instance buffer, the driver can keep the previous frame's copy alive
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, this->instances.size() * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, this->instances.size() * sizeof(glm::mat4), &this->instances[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glBindVertexArray(this->VAO);
+
+		if (this->useIndirect)
+		{
+			this->flushIndirect();
+		}
+		else
+		{
+			this->flushBaseVertex();
+		}
+
+		glBindVertexArray(0);
+
+		return this->drawCalls;
+	}
+
+	GLuint GetDrawCalls()
+	{
+		return this->drawCalls;
+	}
+
+	bool UsesIndirect()
+	{
+		return this->useIndirect;
+	}
+
+private:
+	// Where a mesh lives inside the shared buffers
+	struct PoolEntry
+	{
+		Mesh *mesh;
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLint baseVertex;
+		GLuint material;
+	};
+
+	// Commands sharing a program and a set of textures
+	struct Bucket
+	{
+		GLuint program;
+		GLuint material;
+		vector<DrawElementsIndirectCommand> commands;
+	};
+
+	/*  Render data  */
+	GLuint VAO, VBO, EBO, instanceVBO, indirectBuffer;
+	bool useIndirect;
+	bool geometryDirty;
+	GLuint drawCalls;
+
+	/*  Scene data  */
+	vector<const Mesh *> pooledMeshes;	// In the order they sit in the shared buffers
+	GLuint poolVertexCount, poolIndexCount;
+	map<const Model *, vector<PoolEntry> > entries;
+	vector<vector<Texture> > materials;
+	vector<Bucket> buckets;
+	map<pair<GLuint, GLuint>, GLuint> bucketLookup;
+	vector<glm::mat4> instances;
+	vector<DrawElementsIndirectCommand> frameCommands;
+
+	// Fallback scratch arrays
+	vector<GLsizei> counts;
+	vector<const GLvoid *> offsets;
+	vector<GLint> baseVertices;
+
+	/*  Functions    */
+	const vector<PoolEntry> *findEntries(Model &model)
+	{
+		map<const Model *, vector<PoolEntry> >::iterator it = this->entries.find(&model);
+
+		if (it == this->entries.end())
+		{
+			cout << "ERROR::BATCH_RENDERER::MODEL_NOT_ADDED" << endl;
+			return nullptr;
+		}
+
+		return &it->second;
+	}
+
+	// Meshes using the same textures in the same order share a material
+	GLuint findMaterial(const vector<Texture> &textures)
+	{
+		for (GLuint i = 0; i < this->materials.size(); i++)
+		{
+			const vector<Texture> &other = this->materials[i];
+			bool same = other.size() == textures.size();
+
+			for (GLuint j = 0; same && j < textures.size(); j++)
+			{
+				same = other[j].id == textures[j].id && other[j].type == textures[j].type;
+			}
+
+			if (same)
+			{
+				return i;
+			}
+		}
+
+		this->materials.push_back(textures);
+
+		return (GLuint)this->materials.size() - 1;
+	}
+
+	Bucket &findBucket(GLuint program, GLuint material)
+	{
+		pair<GLuint, GLuint> key(program, material);
+		map<pair<GLuint, GLuint>, GLuint>::iterator it = this->bucketLookup.find(key);
+
+		if (it != this->bucketLookup.end())
+		{
+			return this->buckets[it->second];
+		}
+
+		Bucket bucket;
+		bucket.program = program;
+		bucket.material = material;
+
+		this->bucketLookup[key] = (GLuint)this->buckets.size();
+		this->buckets.push_back(bucket);
+
+		return this->buckets.back();
+	}
+
+	// Creates (or recreates) the shared buffers with every registered mesh
+	void uploadGeometry()
+	{
+		this->geometryDirty = false;
+
+		if (0 == this->poolVertexCount || 0 == this->poolIndexCount)
+		{
+			return;
+		}
+
+		// Gathered only for the upload, the meshes keep their own copy on the CPU
+		vector<Vertex> poolVertices;
+		vector<GLuint> poolIndices;
+		poolVertices.reserve(this->poolVertexCount);
+		poolIndices.reserve(this->poolIndexCount);
+
+		for (GLuint i = 0; i < this->pooledMeshes.size(); i++)
+		{
+			poolVertices.insert(poolVertices.end(), this->pooledMeshes[i]->vertices.begin(), this->pooledMeshes[i]->vertices.end());
+			poolIndices.insert(poolIndices.end(), this->pooledMeshes[i]->indices.begin(), this->pooledMeshes[i]->indices.end());
+		}
+
+		if (!this->VAO)
+		{
+			glGenVertexArrays(1, &this->VAO);
+			glGenBuffers(1, &this->VBO);
+			glGenBuffers(1, &this->EBO);
+			glGenBuffers(1, &this->instanceVBO);
+			glGenBuffers(1, &this->indirectBuffer);
+		}
+
+		glBindVertexArray(this->VAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+		glBufferData(GL_ARRAY_BUFFER, poolVertices.size() * sizeof(Vertex), &poolVertices[0], GL_STATIC_DRAW);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, poolIndices.size() * sizeof(GLuint), &poolIndices[0], GL_STATIC_DRAW);
+
+		// Same layout as Mesh::setupMesh
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, Normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, TexCoords));
+
+		// Model matrix, one column per attribute, advancing once per instance
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+
+		for (GLuint i = 0; i < 4; i++)
+		{
+			glEnableVertexAttribArray(INSTANCE_MATRIX_ATTRIBUTE + i);
+			glVertexAttribPointer(INSTANCE_MATRIX_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (GLvoid *)(i * sizeof(glm::vec4)));
+			glVertexAttribDivisor(INSTANCE_MATRIX_ATTRIBUTE + i, 1);
+		}
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		GetMemoryTracker().Set(MEMORY_RENDERER, "BatchRenderer", 0,
+			poolVertices.size() * sizeof(Vertex) + poolIndices.size() * sizeof(GLuint));
+	}
+
+	// One indirect buffer for the whole frame, one glMultiDrawElementsIndirect per bucket
+	void flushIndirect()
+	{
+		this->frameCommands.clear();
+
+		for (GLuint i = 0; i < this->buckets.size(); i++)
+		{
+			this->frameCommands.insert(this->frameCommands.end(), this->buckets[i].commands.begin(), this->buckets[i].commands.end());
+		}
+
+		if (this->frameCommands.empty())
+		{
+			return;
+		}
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, this->frameCommands.size() * sizeof(DrawElementsIndirectCommand), &this->frameCommands[0], GL_STREAM_DRAW);
+
+		size_t offset = 0;
+
+		for (GLuint i = 0; i < this->buckets.size(); i++)
+		{
+			Bucket &bucket = this->buckets[i];
+
+			if (bucket.commands.empty())
+			{
+				continue;
+			}
+
+			glUseProgram(bucket.program);
+			BindMeshTextures(bucket.program, this->materials[bucket.material]);
+
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const GLvoid *)(offset * sizeof(DrawElementsIndirectCommand)), (GLsizei)bucket.commands.size(), 0);
+			this->drawCalls++;
+
+			UnbindMeshTextures(this->materials[bucket.material]);
+			offset += bucket.commands.size();
+		}
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	// Without base instance support the matrix can't be fetched per command: consecutive commands that
+	// share an instance range are drawn together, once per instance, with the matrix as a constant attribute
+	void flushBaseVertex()
+	{
+		for (GLuint i = 0; i < 4; i++)
+		{
+			glDisableVertexAttribArray(INSTANCE_MATRIX_ATTRIBUTE + i);
+		}
+
+		for (GLuint i = 0; i < this->buckets.size(); i++)
+		{
+			Bucket &bucket = this->buckets[i];
+
+			if (bucket.commands.empty())
+			{
+				continue;
+			}
+
+			glUseProgram(bucket.program);
+			BindMeshTextures(bucket.program, this->materials[bucket.material]);
+
+			GLuint first = 0;
+
+			while (first < bucket.commands.size())
+			{
+				GLuint baseInstance = bucket.commands[first].baseInstance;
+				GLuint instanceCount = bucket.commands[first].instanceCount;
+				GLuint last = first;
+
+				this->counts.clear();
+				this->offsets.clear();
+				this->baseVertices.clear();
+
+				while (last < bucket.commands.size() && bucket.commands[last].baseInstance == baseInstance && bucket.commands[last].instanceCount == instanceCount)
+				{
+					const DrawElementsIndirectCommand &command = bucket.commands[last];
+
+					this->counts.push_back((GLsizei)command.count);
+					this->offsets.push_back((const GLvoid *)(command.firstIndex * sizeof(GLuint)));
+					this->baseVertices.push_back(command.baseVertex);
+					last++;
+				}
+
+				for (GLuint instance = baseInstance; instance < baseInstance + instanceCount; instance++)
+				{
+					const glm::mat4 &matrix = this->instances[instance];
+
+					for (GLuint c = 0; c < 4; c++)
+					{
+						glVertexAttrib4f(INSTANCE_MATRIX_ATTRIBUTE + c, matrix[c].x, matrix[c].y, matrix[c].z, matrix[c].w);
+					}
+
+					glMultiDrawElementsBaseVertex(GL_TRIANGLES, &this->counts[0], GL_UNSIGNED_INT, &this->offsets[0], (GLsizei)this->counts.size(), &this->baseVertices[0]);
+					this->drawCalls++;
+				}
+
+				first = last;
+			}
+
+			UnbindMeshTextures(this->materials[bucket.material]);
+		}
+
+		for (GLuint i = 0; i < 4; i++)
+		{
+			glEnableVertexAttribArray(INSTANCE_MATRIX_ATTRIBUTE + i);
+		}
+	}
+};
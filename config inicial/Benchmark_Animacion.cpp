@@ -0,0 +1,95 @@
+// ===============================
+// Benchmark_Animacion.cpp - Costo por instancia de la animación en lote (SoA)
+// ===============================
+
+// Std
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Animación
+#include "Animation.h"
+#include "AnimationBatch.h"
+
+// Variables del perro, las mismas que anima Maquina de estados / KeyFrames
+float dogPosX = 0.0f, dogPosY = 0.0f, dogPosZ = 0.0f;
+float rotDog = 0.0f, head = 0.0f, tail = 0.0f, FLegs = 0.0f, RLegs = 0.0f;
+
+const char *kernelNames[] = { "escalar", "AVX2 (8)", "AVX-512 (16)" };
+
+// Construye un ciclo de caminata de 4 poses con todos los canales
+void buildClip(AnimationClip &clip) {
+    clip.AddChannel("dogPosX", &dogPosX);
+    clip.AddChannel("dogPosY", &dogPosY);
+    clip.AddChannel("dogPosZ", &dogPosZ);
+    clip.AddChannel("rotDog", &rotDog);
+    clip.AddChannel("head", &head);
+    clip.AddChannel("tail", &tail);
+    clip.AddChannel("FLegs", &FLegs);
+    clip.AddChannel("RLegs", &RLegs);
+
+    for (int pose = 0; pose <= 4; pose++) {
+        float side = (pose % 2) ? 1.0f : -1.0f;
+        dogPosZ = pose * 0.5f;
+        rotDog = pose * 10.0f;
+        head = 15.0f * side;
+        tail = -30.0f * side;
+        FLegs = 20.0f * side;
+        RLegs = -20.0f * side;
+        clip.Capture(pose * 0.5f);
+    }
+}
+
+// Nanosegundos por instancia y por frame
+double measure(AnimationBatch &batch, JobSystem *jobs, int frames) {
+    const float dt = 1.0f / 60.0f;
+
+    batch.Update(dt, jobs); // Calentamiento
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int f = 0; f < frames; f++)
+        batch.Update(dt, jobs);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / ((double)frames * batch.GetInstanceCount());
+}
+
+int main() {
+    AnimationClip clip;
+    buildClip(clip);
+
+    const unsigned int counts[] = { 1, 1000, 100000 };
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    JobSystem jobs(hardwareThreads);
+
+    printf("%d canales, %u hilos disponibles\n", clip.GetChannelCount(), hardwareThreads);
+    printf("%-10s %-14s %-6s %12s\n", "instancias", "kernel", "hilos", "ns/instancia");
+
+    for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        AnimationBatch batch(clip);
+
+        // Cada perro arranca en otro punto del ciclo y camina a otra velocidad
+        for (unsigned int i = 0; i < counts[c]; i++)
+            batch.AddInstance((i % 97) * 0.021f, 0.75f + (i % 13) * 0.05f);
+
+        // Menos frames con muchas instancias para que cada caso tarde parecido
+        int frames = counts[c] >= 100000 ? 200 : (counts[c] >= 1000 ? 20000 : 200000);
+        AnimationKernel best = batch.GetKernel();
+
+        for (int k = ANIMATION_KERNEL_SCALAR; k <= best; k++) {
+            batch.SetKernel((AnimationKernel)k);
+            printf("%-10u %-14s %-6u %12.2f\n", counts[c], kernelNames[k], 1u, measure(batch, nullptr, frames));
+        }
+
+        // Hilos solo cuando hay trabajo suficiente para repartir
+        if (counts[c] >= 1000 && hardwareThreads > 1) {
+            batch.SetKernel(best);
+            printf("%-10u %-14s %-6u %12.2f\n", counts[c], kernelNames[best], hardwareThreads, measure(batch, &jobs, frames / 10));
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+// ===============================
+// Benchmark_DXT.cpp - Compresión DXT: SOIL2 contra DXTCompressor (escalar, SSE2, AVX2, hilos)
+// ===============================
+
+// Std
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <functional>
+
+// Compresión
+#include "DXTCompressor.h"
+#include "SOIL2/SOIL2.h"
+extern "C"
+{
+#include "SOIL2/image_DXT.h"
+}
+
+const char *kernelNames[] = { "escalar", "SSE2 (4)", "AVX2 (8)" };
+
+// Las texturas que cargan las escenas
+const char *textures[] = { "Models/grass.jpg", "Models/Texture_albedo.jpg", "Models/ball.png", "Models/catto_texture.png" };
+
+// Color 565 a 888, igual que rgb_888_from_565
+void from565(unsigned int c, int rgb[3]) {
+    rgb[0] = (((c >> 11) & 31) * 255 + 15) / 31;
+    rgb[1] = (((c >> 5) & 63) * 255 + 31) / 63;
+    rgb[2] = ((c & 31) * 255 + 15) / 31;
+}
+
+// Descomprime un bloque de 4x4 (DXT1, o DXT5 si alpha) a RGBA
+void decodeBlock(const unsigned char *block, bool alpha, unsigned char texels[16][4]) {
+    if (alpha) {
+        int a[8] = { block[0], block[1] };
+        for (int i = 2; i < 8; i++)
+            a[i] = a[0] > a[1] ? ((8 - i) * a[0] + (i - 1) * a[1]) / 7 : (i < 6 ? ((6 - i) * a[0] + (i - 1) * a[1]) / 5 : (i == 6 ? 0 : 255));
+
+        unsigned long long bits = 0;
+        for (int i = 0; i < 6; i++)
+            bits |= (unsigned long long)block[2 + i] << (8 * i);
+        for (int t = 0; t < 16; t++)
+            texels[t][3] = (unsigned char)a[(bits >> (3 * t)) & 7];
+
+        block += 8;
+    } else {
+        for (int t = 0; t < 16; t++)
+            texels[t][3] = 255;
+    }
+
+    unsigned int c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+    int palette[4][3];
+    from565(c0, palette[0]);
+    from565(c1, palette[1]);
+    for (int k = 0; k < 3; k++) {
+        if (c0 > c1 || alpha) {
+            palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+            palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+        } else {
+            palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+            palette[3][k] = 0;
+        }
+    }
+
+    unsigned int bits = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+    for (int t = 0; t < 16; t++)
+        for (int k = 0; k < 3; k++)
+            texels[t][k] = (unsigned char)palette[(bits >> (2 * t)) & 3][k];
+}
+
+// PSNR en dB de los bloques contra la imagen original, sobre RGB (y alpha si la imagen lo tiene)
+double psnr(const unsigned char *pixels, int width, int height, int channels, const unsigned char *blocks, bool alpha) {
+    int columns = (width + 3) / 4, compared = channels == 4 ? 4 : 3;
+    double error = 0.0;
+
+    for (int by = 0; by < (height + 3) / 4; by++) {
+        for (int bx = 0; bx < columns; bx++) {
+            unsigned char texels[16][4];
+            decodeBlock(blocks + (by * columns + bx) * (alpha ? 16 : 8), alpha, texels);
+
+            for (int t = 0; t < 16; t++) {
+                int x = bx * 4 + t % 4, y = by * 4 + t / 4;
+                if (x >= width || y >= height)
+                    continue;
+
+                const unsigned char *source = pixels + ((size_t)y * width + x) * channels;
+                for (int k = 0; k < compared; k++) {
+                    double d = (double)source[k] - texels[t][k];
+                    error += d * d;
+                }
+            }
+        }
+    }
+
+    double mse = error / ((double)width * height * compared);
+    return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+// Milisegundos de la mejor de varias pasadas
+double measure(const std::function<void()> &compress, int passes) {
+    double best = 1e30;
+
+    for (int p = 0; p < passes; p++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        compress();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    return best;
+}
+
+int main() {
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    JobSystem jobs(hardwareThreads);
+    const int passes = 5;
+
+    printf("%u hilos disponibles\n", hardwareThreads);
+    printf("%-28s %-5s %-14s %-6s %10s %10s %9s\n", "textura", "tipo", "codificador", "hilos", "ms", "Mpx/s", "PSNR dB");
+
+    for (unsigned int i = 0; i < sizeof(textures) / sizeof(textures[0]); i++) {
+        int width, height, channels;
+        unsigned char *pixels = SOIL_load_image(textures[i], &width, &height, &channels, SOIL_LOAD_AUTO);
+
+        if (!pixels) {
+            printf("%-28s no se pudo cargar\n", textures[i]);
+            continue;
+        }
+
+        // Como en TextureCache: DXT5 si la imagen tiene alpha
+        bool alpha = channels == 4;
+        const char *type = alpha ? "DXT5" : "DXT1";
+        double megapixels = (double)width * height / 1e6;
+        std::string name = std::string(textures[i]) + " " + std::to_string(width) + "x" + std::to_string(height);
+
+        // SOIL2, el codificador de referencia
+        int size = 0;
+        unsigned char *reference = nullptr;
+        double ms = measure([&] {
+            free(reference);
+            reference = alpha ? convert_image_to_DXT5(pixels, width, height, channels, &size) : convert_image_to_DXT1(pixels, width, height, channels, &size);
+        }, passes);
+        double referencePsnr = psnr(pixels, width, height, channels, reference, alpha);
+        printf("%-28s %-5s %-14s %-6u %10.2f %10.1f %9.2f\n", name.c_str(), type, "SOIL2", 1u, ms, megapixels / (ms / 1000.0), referencePsnr);
+
+        std::vector<unsigned char> blocks(DXTCompressor::GetCompressedSize(width, height, alpha));
+        DXTCompressor single, threaded(&jobs);
+        DXTKernel best = single.GetKernel();
+
+        for (int k = DXT_KERNEL_SCALAR; k <= best; k++) {
+            single.SetKernel((DXTKernel)k);
+            ms = measure([&] { single.Compress(pixels, width, height, channels, alpha, &blocks[0]); }, passes);
+            printf("%-28s %-5s %-14s %-6u %10.2f %10.1f %9.2f\n", "", type, kernelNames[k], 1u, ms, megapixels / (ms / 1000.0), psnr(pixels, width, height, channels, &blocks[0], alpha));
+        }
+
+        // Filas de bloques repartidas entre los hilos
+        if (hardwareThreads > 1) {
+            ms = measure([&] { threaded.Compress(pixels, width, height, channels, alpha, &blocks[0]); }, passes);
+            printf("%-28s %-5s %-14s %-6u %10.2f %10.1f %9.2f\n", "", type, kernelNames[best], hardwareThreads, ms, megapixels / (ms / 1000.0), psnr(pixels, width, height, channels, &blocks[0], alpha));
+        }
+
+        // Bloques que difieren de los de SOIL2 (redondeos de coma flotante en casos límite)
+        size_t different = 0;
+        for (size_t b = 0; b < blocks.size(); b += alpha ? 16 : 8)
+            different += memcmp(&blocks[b], reference + b, alpha ? 16 : 8) != 0;
+        printf("%-28s %zu de %zu bloques distintos de SOIL2\n", "", different, blocks.size() / (alpha ? 16 : 8));
+
+        free(reference);
+        SOIL_free_image_data(pixels);
+    }
+
+    return 0;
+}
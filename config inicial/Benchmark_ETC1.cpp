@@ -0,0 +1,114 @@
+// ===============================
+// Benchmark_ETC1.cpp - Compresión ETC1: SOIL2 contra ETC1Compressor (búsquedas, kernels, hilos)
+// ===============================
+
+// Std
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <functional>
+
+// Compresión
+#include "ETC1Compressor.h"
+#include "SOIL2/SOIL2.h"
+#include "SOIL2/etc1_utils.h"
+
+const char *kernelNames[] = { "escalar", "SSE2 (4)", "AVX2 (8)" };
+const char *searchNames[] = { "rápida", "media", "exhaustiva" };
+
+// Las texturas que cargan las escenas
+const char *textures[] = { "Models/grass.jpg", "Models/Texture_albedo.jpg", "Models/ball.png", "Models/catto_texture.png" };
+
+// PSNR en dB de los bloques contra la imagen RGB original
+double psnr(const unsigned char *pixels, int width, int height, const unsigned char *blocks) {
+    std::vector<unsigned char> decoded((size_t)width * height * 3);
+    etc1_decode_image(blocks, &decoded[0], width, height, 3, width * 3);
+
+    double error = 0.0;
+    for (size_t i = 0; i < decoded.size(); i++) {
+        double d = (double)pixels[i] - decoded[i];
+        error += d * d;
+    }
+
+    double mse = error / decoded.size();
+    return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+// Milisegundos de la mejor de varias pasadas
+double measure(const std::function<void()> &compress, int passes) {
+    double best = 1e30;
+
+    for (int p = 0; p < passes; p++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        compress();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    return best;
+}
+
+void printRow(const std::string &name, const char *encoder, const char *search, unsigned int threads, double ms, double megapixels, double quality) {
+    printf("%-28s %-12s %-11s %-6u %10.1f %10.1f %9.2f\n", name.c_str(), encoder, search, threads, ms, megapixels / (ms / 1000.0), quality);
+}
+
+int main() {
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    JobSystem jobs(hardwareThreads);
+
+    printf("%u hilos disponibles\n", hardwareThreads);
+    printf("%-28s %-12s %-11s %-6s %10s %10s %9s\n", "textura", "codificador", "búsqueda", "hilos", "ms", "Mpx/s", "PSNR dB");
+
+    for (unsigned int i = 0; i < sizeof(textures) / sizeof(textures[0]); i++) {
+        int width, height, channels;
+        unsigned char *pixels = SOIL_load_image(textures[i], &width, &height, &channels, SOIL_LOAD_RGB);
+
+        if (!pixels) {
+            printf("%-28s no se pudo cargar\n", textures[i]);
+            continue;
+        }
+
+        double megapixels = (double)width * height / 1e6;
+        std::string name = std::string(textures[i]) + " " + std::to_string(width) + "x" + std::to_string(height);
+        std::vector<unsigned char> reference(etc1_get_encoded_data_size(width, height)), blocks(ETC1Compressor::GetCompressedSize(width, height));
+
+        // SOIL2, el codificador de referencia (misma búsqueda que la media)
+        double ms = measure([&] { etc1_encode_image(pixels, width, height, 3, width * 3, &reference[0]); }, 3);
+        printRow(name, "SOIL2", searchNames[ETC1_SEARCH_MEDIUM], 1, ms, megapixels, psnr(pixels, width, height, &reference[0]));
+
+        ETC1Compressor single, threaded(&jobs);
+        ETC1Kernel best = single.GetKernel();
+
+        for (int s = ETC1_SEARCH_FAST; s <= ETC1_SEARCH_EXHAUSTIVE; s++) {
+            // La exhaustiva solo con el mejor kernel, es la lenta
+            int passes = s == ETC1_SEARCH_EXHAUSTIVE ? 1 : 3;
+            single.SetSearch((ETC1Search)s);
+
+            for (int k = s == ETC1_SEARCH_EXHAUSTIVE ? best : ETC1_KERNEL_SCALAR; k <= best; k++) {
+                single.SetKernel((ETC1Kernel)k);
+                ms = measure([&] { single.Compress(pixels, width, height, 3, &blocks[0]); }, passes);
+                printRow("", kernelNames[k], searchNames[s], 1, ms, megapixels, psnr(pixels, width, height, &blocks[0]));
+
+                // La búsqueda media escribe los mismos bloques que SOIL2
+                if (s == ETC1_SEARCH_MEDIUM && blocks != reference)
+                    printf("%-28s los bloques difieren de SOIL2\n", "");
+            }
+
+            // Filas de bloques repartidas entre los hilos
+            if (hardwareThreads > 1) {
+                threaded.SetSearch((ETC1Search)s);
+                ms = measure([&] { threaded.Compress(pixels, width, height, 3, &blocks[0]); }, passes);
+                printRow("", kernelNames[best], searchNames[s], hardwareThreads, ms, megapixels, psnr(pixels, width, height, &blocks[0]));
+            }
+        }
+
+        SOIL_free_image_data(pixels);
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+// ===============================
+// Benchmark_Jerarquia.cpp - Actualización de jerarquías grandes en paralelo
+// ===============================
+
+// Std
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// GLM
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Jerarquía
+#include "SceneGraph.h"
+#include "JobSystem.h"
+
+// Presupuesto de un frame a 60 FPS
+const double FRAME_BUDGET_MS = 1000.0 / 60.0;
+
+// Las mismas articulaciones del brazo de Modelado_Jerarquico: antes, eje, después
+struct Articulacion {
+    glm::vec3 antes, eje, despues;
+};
+
+const Articulacion brazo[] = {
+    { glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.5f, 0.0f, 0.0f) },     // Hombro
+    { glm::vec3(1.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f) }, // Codo
+    { glm::vec3(0.75f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f) }, // Muñeca
+    { glm::vec3(0.01f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.2f, 0.2f) }, // Falange
+    { glm::vec3(0.01f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f) }, // Dedo
+    { glm::vec3(0.01f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.2f, 0.2f) }, // Falange2
+    { glm::vec3(0.01f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f) }, // Dedo2
+};
+const unsigned int PIEZAS = sizeof(brazo) / sizeof(brazo[0]);
+
+glm::mat4 articulacion(const Articulacion &a, float angulo) {
+    glm::mat4 local = glm::translate(glm::mat4(1.0f), a.antes);
+    local = glm::rotate(local, glm::radians(angulo), a.eje);
+    return glm::translate(local, a.despues);
+}
+
+// Muchos brazos colgando de una raíz por fila, ~100k nodos en total
+void buildScene(SceneGraph &scene, unsigned int nodes) {
+    unsigned int arms = nodes / PIEZAS;
+    GLint row = SCENE_ROOT;
+
+    for (unsigned int i = 0; i < arms; i++) {
+        if (i % 100 == 0)
+            row = (GLint)scene.AddNode(SCENE_ROOT, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -(float)(i / 100))));
+
+        GLint parent = row;
+        for (unsigned int p = 0; p < PIEZAS; p++)
+            parent = (GLint)scene.AddNode(parent, articulacion(brazo[p], 0.0f));
+    }
+}
+
+// Mueve todas las articulaciones, como si cada brazo estuviera animado
+void animate(SceneGraph &scene, float t) {
+    unsigned int count = scene.GetNodeCount();
+    unsigned int piece = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (scene.GetParent(i) == SCENE_ROOT) {
+            piece = 0;
+            continue;
+        }
+        scene.SetLocal(i, articulacion(brazo[piece], 20.0f * sinf(t + i * 0.001f)));
+        piece = (piece + 1) % PIEZAS;
+    }
+}
+
+int main() {
+    const unsigned int NODES = 100000;
+    const int FRAMES = 60;
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    SceneGraph scene;
+    buildScene(scene, NODES);
+    scene.Update();
+    printf("%u nodos, %u hilos disponibles\n", scene.GetNodeCount(), hardwareThreads);
+
+    // Referencia en un solo hilo
+    double serialMs = 0.0;
+    for (int f = 0; f < FRAMES; f++) {
+        animate(scene, f * 0.016f);
+        auto start = std::chrono::high_resolution_clock::now();
+        scene.Update();
+        serialMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    serialMs /= FRAMES;
+    printf("%-6s %10s %10s %12s %12s\n", "hilos", "ms/frame", "speedup", "eficiencia", "ocupacion");
+    printf("%-6u %10.3f %10.2f %12.2f %12s\n", 1u, serialMs, 1.0, 1.0, "-");
+
+    for (unsigned int threads = 2; threads <= hardwareThreads; threads *= 2) {
+        JobSystem jobs(threads);
+        SceneUpdateStats stats;
+        double parallelMs = 0.0, occupancy = 0.0;
+
+        for (int f = 0; f < FRAMES; f++) {
+            animate(scene, f * 0.016f);
+            scene.UpdateParallel(jobs, &stats);
+            parallelMs += stats.wallSeconds * 1000.0;
+            occupancy += stats.Efficiency();
+        }
+        parallelMs /= FRAMES;
+        occupancy /= FRAMES;
+
+        // Eficiencia = speedup / hilos; ocupación = tiempo útil / tiempo disponible de los hilos
+        double speedup = serialMs / parallelMs;
+        printf("%-6u %10.3f %10.2f %12.2f %12.2f\n", threads, parallelMs, speedup, speedup / threads, occupancy);
+    }
+
+    printf("presupuesto de frame: %.2f ms\n", FRAME_BUDGET_MS);
+    return 0;
+}
\ No newline at end of file
@@ -130,6 +130,15 @@ public:
 		return this->front;
 	}
 
+	// Places the camera directly, e.g. to follow a scripted path
+	void SetPose(glm::vec3 position, GLfloat yaw, GLfloat pitch)
+	{
+		this->position = position;
+		this->yaw = yaw;
+		this->pitch = pitch;
+		this->updateCameraVectors();
+	}
+
 private:
 	// Camera Attributes
 	glm::vec3 position;
@@ -13,8 +13,14 @@
 
 // Shaders, Cmara y Modelo (tus headers)
 #include "Shader.h"
+#include "RenderContext.h"
+#include "FrameBenchmark.h"
+#include "Profiler.h"
+#include "GpuTimer.h"
 #include "Camera.h"
 #include "Model.h"
+#include "BatchRenderer.h"
+#include "GpuCulling.h"
 
 // GLM
 #include <glm/glm.hpp>
@@ -45,39 +51,43 @@ glm::vec3 g_catPosition = glm::vec3(1.0f, 0.0f, 0.0f);
 GLfloat deltaTime = 0.0f;
 GLfloat lastFrame = 0.0f;
 
-int main() {
-    // -------------------- GLFW --------------------
-    if (!glfwInit()) {
-        std::cout << "Failed to init GLFW\n";
-        return EXIT_FAILURE;
-    }
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-    glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-
-    GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Control por Teclado", nullptr, nullptr);
-    if (!window) {
-        std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
-        return EXIT_FAILURE;
-    }
-    glfwMakeContextCurrent(window);
-    glfwGetFramebufferSize(window, &SCREEN_WIDTH, &SCREEN_HEIGHT);
-
-    // Callbacks
-    glfwSetKeyCallback(window, KeyCallback);
-    glfwSetCursorPosCallback(window, MouseCallback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    // -------------------- GLEW --------------------
-    glewExperimental = GL_TRUE;
-    if (GLEW_OK != glewInit()) {
-        std::cout << "Failed to initialize GLEW\n";
+int main(int argc, char **argv) {
+    // Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+    // --benchmark archivo.json [--warmup N] [--measure N] recorre una ruta de cmara fija y mide cada frame
+    RenderContextOptions options = ParseRenderContextOptions(argc, argv);
+    FrameBenchmark benchmark("carga_de_modelos", ParseFrameBenchmarkOptions(argc, argv));
+    benchmark.Configure(options);
+
+    // --trace archivo.json guarda las zonas medidas para chrome://tracing o Perfetto
+    ProfilerOptions traza = ParseProfilerOptions(argc, argv);
+    PROFILE_THREAD("Principal");
+
+    // Las texturas se guardan comprimidas (BC1) en TextureCache/; --no-texture-cache las decodifica siempre
+    GetTextureCacheOptions() = ParseTextureCacheOptions(argc, argv);
+
+    // --glstats muestra al cerrar las llamadas a GL y los bytes subidos por frame
+    GLStatsOptions estadisticas = ParseGLStatsOptions(argc, argv);
+    // --memory muestra la memoria de CPU y GPU por subsistema cuando cambia y, al cerrar, por recurso
+    MemoryTrackerOptions memoria = ParseMemoryTrackerOptions(argc, argv);
+    GLStats glStats("carga_de_modelos");
+    GpuTimer gpuTimer;
+    // El benchmark toma el tiempo de GPU de cada frame de la zona "Frame" del temporizador
+    benchmark.SetGpuTimer(gpuTimer);
+
+    RenderContext context;
+    if (!context.Create(WIDTH, HEIGHT, "Control por Teclado", options))
         return EXIT_FAILURE;
+
+    GLFWwindow* window = context.GetWindow();
+    SCREEN_WIDTH = context.GetWidth();
+    SCREEN_HEIGHT = context.GetHeight();
+
+    // Sin ventana no hay eventos de entrada
+    if (window) {
+        // Callbacks
+        glfwSetKeyCallback(window, KeyCallback);
+        glfwSetCursorPosCallback(window, MouseCallback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     }
 
     // -------------------- Viewport / estado GL --------------------
@@ -85,11 +95,43 @@ int main() {
     glEnable(GL_DEPTH_TEST);
 
     // -------------------- Shaders --------------------
-    Shader shader("Shader/modelLoading.vs", "Shader/modelLoading.frag");
+    // batched.vs lee la matriz model por instancia en lugar de un uniform
+    Shader shader("Shader/batched.vs", "Shader/modelLoading.frag");
 
     // -------------------- Modelos --------------------
-    Model dog((char*)"Models/RedDog.obj");
-    Model cat((char*)"Models/miGato.obj");
+    // Las mallas se convierten en paralelo; las texturas se decodifican en segundo plano y se suben en el loop
+    JobSystem jobs;
+    TextureLoader texturas(jobs);
+    Model dog((char*)"Models/RedDog.obj", &jobs, &texturas);
+    Model cat((char*)"Models/miGato.obj", &jobs, &texturas);
+
+    // Con --benchmark todos los frames medidos tienen ya las texturas definitivas
+    if (benchmark.IsEnabled()) {
+        texturas.Finish();
+    }
+
+    // -------------------- Batch (un multi-draw por material) --------------------
+    BatchRenderer batch;
+    batch.AddModel(dog);
+    batch.AddModel(cat);
+
+    // -------------------- Multitud de perros (culling en GPU) --------------------
+    // El frustum culling de cada perro lo hace la GPU con transform feedback, la CPU no los recorre por frame
+    const GLuint CROWD_SIDE = 40;
+    Shader cullShader("Shader/cull.vs", "Shader/cull.gs", GPU_CULLING_VARYINGS, GPU_CULLING_VARYING_COUNT);
+    GpuCuller crowd(dog, CROWD_SIDE * CROWD_SIDE);
+    {
+        std::vector<glm::mat4> crowdModels;
+        for (GLuint i = 0; i < CROWD_SIDE; i++) {
+            for (GLuint j = 0; j < CROWD_SIDE; j++) {
+                glm::mat4 model = glm::mat4(1.0f);
+                model = glm::translate(model, glm::vec3(-40.0f + i * 2.0f, -1.0f, -6.0f - j * 2.0f));
+                model = glm::rotate(model, glm::radians((GLfloat)((i * 37 + j * 53) % 360)), glm::vec3(0.0f, 1.0f, 0.0f));
+                crowdModels.push_back(glm::scale(model, glm::vec3(0.40f)));
+            }
+        }
+        crowd.SetInstances(&crowdModels[0], (GLuint)crowdModels.size());
+    }
 
     // -------------------- Matriz de proyeccin (fija) --------------------
     glm::mat4 projection = glm::perspective(
@@ -102,19 +144,37 @@ int main() {
     shader.Use();
     GLint uProj = glGetUniformLocation(shader.Program, "projection");
     GLint uView = glGetUniformLocation(shader.Program, "view");
-    GLint uModel = glGetUniformLocation(shader.Program, "model");
     glUniformMatrix4fv(uProj, 1, GL_FALSE, glm::value_ptr(projection));
 
+    // -------------------- Ruta de cmara (--benchmark) --------------------
+    // Recorre la multitud de frente a fondo para que el culling vea de todo a casi nada
+    CameraPath &ruta = benchmark.GetCameraPath();
+    ruta.AddKey(0.0f, glm::vec3(0.0f, 1.0f, 3.0f), -90.0f, -5.0f);
+    ruta.AddKey(4.0f, glm::vec3(-20.0f, 4.0f, 8.0f), -100.0f, -15.0f);
+    ruta.AddKey(8.0f, glm::vec3(-45.0f, 3.0f, -40.0f), -20.0f, -10.0f);
+    ruta.AddKey(12.0f, glm::vec3(0.0f, 1.0f, 3.0f), -90.0f, -5.0f);
+
     // -------------------- Loop principal --------------------
-    while (!glfwWindowShouldClose(window)) {
+    while (!context.ShouldClose() && !benchmark.IsFinished()) {
+        PROFILE_ZONE("Frame");
+        benchmark.BeginFrame();
+        glStats.BeginFrame();
+        texturas.Update();
+        benchmark.BeginStage(FRAME_STAGE_UPDATE);
+
         // Tiempo
-        GLfloat t = (GLfloat)glfwGetTime();
+        GLfloat t = benchmark.GetTime((GLfloat)context.GetTime());
         deltaTime = t - lastFrame;
         lastFrame = t;
 
         // Entrada
-        glfwPollEvents();
+        context.PollEvents();
         DoMovement();
+        benchmark.UpdateCamera(camera, t);
+
+        benchmark.EndStage(FRAME_STAGE_UPDATE);
+
+        gpuTimer.BeginFrame();
 
         // Clear
         glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
@@ -126,16 +186,25 @@ int main() {
         glm::mat4 view = camera.GetViewMatrix();
         glUniformMatrix4fv(uView, 1, GL_FALSE, glm::value_ptr(view));
 
+        benchmark.BeginStage(FRAME_STAGE_CULL);
+        {
+            GPU_ZONE(gpuTimer, "Cull");
+            crowd.Cull(cullShader, projection * view);
+        }
+        benchmark.EndStage(FRAME_STAGE_CULL);
+
+        benchmark.BeginStage(FRAME_STAGE_SUBMIT);
+        batch.Begin();
+
         // ======================================================
         //      PERRO #1
         // ======================================================
+        glm::mat4 dogs[2];
         {
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::translate(model, glm::vec3(-1.5f, 0.0f, -0.5f));
             model = glm::rotate(model, glm::radians(fmod(t * 45.0f, 360.0f)), glm::vec3(0.0f, 1.0f, 0.0f));
-            model = glm::scale(model, glm::vec3(0.60f));
-            glUniformMatrix4fv(uModel, 1, GL_FALSE, glm::value_ptr(model));
-            dog.Draw(shader);
+            dogs[0] = glm::scale(model, glm::vec3(0.60f));
         }
 
         // ======================================================
@@ -145,11 +214,12 @@ int main() {
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::translate(model, glm::vec3(-3.0f, 0.0f, -2.0f));
             model = glm::rotate(model, glm::radians(fmod(-t * 70.0f, 360.0f)), glm::vec3(0.0f, 1.0f, 0.0f));
-            model = glm::scale(model, glm::vec3(0.60f));
-            glUniformMatrix4fv(uModel, 1, GL_FALSE, glm::value_ptr(model));
-            dog.Draw(shader);
+            dogs[1] = glm::scale(model, glm::vec3(0.60f));
         }
 
+        // Los dos perros comparten geometria: un solo comando instanciado por malla
+        batch.Submit(shader, dog, dogs, 2);
+
         // ======================================================
         //      GATO (Controlado por Teclado y ms pequeo)
         // ======================================================
@@ -162,15 +232,44 @@ int main() {
             // --- AQU EST EL CAMBIO! ---
             model = glm::scale(model, glm::vec3(0.15f)); // Ahora es ms pequeo
 
-            glUniformMatrix4fv(uModel, 1, GL_FALSE, glm::value_ptr(model));
-            cat.Draw(shader);
+            batch.Submit(shader, cat, model);
+        }
+
+        // Todo lo enviado se dibuja aqui, el numero de draw calls ya no depende del numero de objetos
+        {
+            GPU_ZONE(gpuTimer, "Lote");
+            batch.Flush();
+        }
+
+        // Solo los perros visibles de la multitud, en un draw instanciado por malla
+        {
+            GPU_ZONE(gpuTimer, "Multitud");
+            crowd.Draw(shader);
         }
+        gpuTimer.EndFrame();
+        benchmark.EndStage(FRAME_STAGE_SUBMIT);
 
         // Swap
-        glfwSwapBuffers(window);
+        context.SwapBuffers();
+        glStats.EndFrame();
+        if (memoria.report) GetMemoryTracker().WriteFrameSummary(std::cout);
+        benchmark.EndFrame();
     }
 
-    glfwTerminate();
+    // Los tiempos de GPU que faltan se leen antes de exportar la traza
+    gpuTimer.Destroy();
+    if (estadisticas.report) glStats.Report(std::cout);
+    if (memoria.report) GetMemoryTracker().Report(std::cout);
+    if (!traza.tracePath.empty()) GetProfiler().ExportChromeTrace(traza.tracePath);
+
+    // El anillo de subida de texturas se libera con el contexto an activo
+    texturas.Destroy();
+
+    // Igual los buffers del lote y los de la multitud
+    batch.Destroy();
+    crowd.Destroy();
+
+    context.Destroy();
     return 0;
 }
 
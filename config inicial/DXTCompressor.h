@@ -0,0 +1,445 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <algorithm>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include "JobSystem.h"
+#include "SIMDLanes.h"
+
+// Compression kernels, the best one compiled in is used by default (SSE2 is always there on x64, AVX2
+// needs /arch:AVX2 in MSVC)
+enum DXTKernel
+{
+	DXT_KERNEL_SCALAR = 0,
+	DXT_KERNEL_SSE2,
+	DXT_KERNEL_AVX2
+};
+
+// Blocks compressed together by the widest kernel
+const GLuint DXT_COMPRESSOR_MAX_LANES = 8;
+
+// Rows of 4x4 blocks per job when the image is split over a job system (32 pixel rows)
+const GLuint DXT_COMPRESSOR_JOB_ROWS = 8;
+
+// BC1 (DXT1) and BC3 (DXT5) encoder producing the same blocks as SOIL2's image_DXT.c: endpoints from
+// the principal axis of the block's colors (covariance matrix, power method), indices by projecting
+// every texel on the line between them, alpha endpoints from the block's range.
+// image_DXT.c does that one block at a time with scalar code. Here rows of blocks are loaded as structure
+// of arrays, one block per lane, so every instruction works on 4 (SSE2) or 8 (AVX2) blocks; with a job
+// system the rows of blocks are also spread over its threads.
+// Texels past the right or bottom edge repeat the last column or row.
+class DXTCompressor
+{
+public:
+	// Without a job system every row is compressed on the calling thread
+	explicit DXTCompressor(JobSystem *jobs = nullptr) : jobs(jobs)
+	{
+#if defined(__AVX2__)
+		this->kernel = DXT_KERNEL_AVX2;
+#elif defined(SIMD_LANES_SSE2)
+		this->kernel = DXT_KERNEL_SSE2;
+#else
+		this->kernel = DXT_KERNEL_SCALAR;
+#endif
+	}
+
+	// Selects a kernel, falling back to the best one that was compiled in
+	void SetKernel(DXTKernel requested)
+	{
+#if defined(__AVX2__)
+		this->kernel = requested;
+#elif defined(SIMD_LANES_SSE2)
+		this->kernel = std::min(requested, DXT_KERNEL_SSE2);
+#else
+		this->kernel = DXT_KERNEL_SCALAR;
+		(void)requested;
+#endif
+	}
+
+	DXTKernel GetKernel() const
+	{
+		return this->kernel;
+	}
+
+	// Bytes of the blocks of a width x height image: 8 per 4x4 block in DXT1, 16 in DXT5
+	static size_t GetCompressedSize(int width, int height, bool alpha)
+	{
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * (alpha ? 16 : 8);
+	}
+
+	// Compresses the image into blocks, GetCompressedSize bytes. With alpha it writes DXT5, an alpha
+	// block before every color block; images without an alpha channel (1 or 3 channels) get 255 there.
+	// As in SOIL, 1 and 2 channel images are grey.
+	bool Compress(const unsigned char *pixels, int width, int height, int channels, bool alpha, unsigned char *blocks)
+	{
+		if (!pixels || !blocks || width < 1 || height < 1 || channels < 1 || channels > 4)
+		{
+			return false;
+		}
+
+		Image image = { pixels, width, height, channels, alpha, blocks };
+		GLuint rows = (GLuint)((height + 3) / 4);
+
+		if (this->jobs)
+		{
+			this->jobs->ParallelFor(rows, DXT_COMPRESSOR_JOB_ROWS, [this, &image](GLuint begin, GLuint end, GLuint)
+			{
+				this->compressRows(image, begin, end);
+			});
+		}
+		else
+		{
+			this->compressRows(image, 0, rows);
+		}
+
+		return true;
+	}
+
+	bool CompressDXT1(const unsigned char *pixels, int width, int height, int channels, unsigned char *blocks)
+	{
+		return this->Compress(pixels, width, height, channels, false, blocks);
+	}
+
+	bool CompressDXT5(const unsigned char *pixels, int width, int height, int channels, unsigned char *blocks)
+	{
+		return this->Compress(pixels, width, height, channels, true, blocks);
+	}
+
+private:
+	struct Image
+	{
+		const unsigned char *pixels;
+		int width, height, channels;
+		bool alpha;
+		unsigned char *blocks;
+	};
+
+	// What the kernels write per lane, packed into bytes afterwards
+	enum Result
+	{
+		RESULT_COLOR0 = 0,	// 565 endpoints, color0 > color1 as DXT1's four color mode needs
+		RESULT_COLOR1,
+		RESULT_COLOR_BITS_LOW,	// 2 bit indices of texels 0-7
+		RESULT_COLOR_BITS_HIGH,	// and 8-15
+		RESULT_ALPHA0,
+		RESULT_ALPHA1,
+		RESULT_ALPHA_BITS_LOW,	// 3 bit indices of texels 0-7 (24 bits, still exact in a float)
+		RESULT_ALPHA_BITS_HIGH,
+		RESULT_COUNT
+	};
+
+	JobSystem *jobs;
+	DXTKernel kernel;
+
+	void compressRows(const Image &image, GLuint begin, GLuint end)
+	{
+		for (GLuint row = begin; row < end; row++)
+		{
+			switch (this->kernel)
+			{
+#if defined(__AVX2__)
+			case DXT_KERNEL_AVX2:
+				compressRow<SIMDLanes8>(image, row);
+				break;
+#endif
+#if defined(SIMD_LANES_SSE2)
+			case DXT_KERNEL_SSE2:
+				compressRow<SIMDLanes4>(image, row);
+				break;
+#endif
+			default:
+				compressRow<SIMDLanes1>(image, row);
+				break;
+			}
+		}
+	}
+
+	// Compresses one row of blocks, V::LANES blocks at a time. The last group repeats its last block in
+	// the lanes past the end of the row, their results are dropped.
+	template <class V>
+	static void compressRow(const Image &image, GLuint row)
+	{
+		const GLuint L = V::LANES;
+		alignas(32) unsigned char bytes[4 * 16 * DXT_COMPRESSOR_MAX_LANES];	// [channel][texel][lane]
+		alignas(32) GLfloat texels[4 * 16 * DXT_COMPRESSOR_MAX_LANES];
+		alignas(32) GLfloat results[RESULT_COUNT * DXT_COMPRESSOR_MAX_LANES];	// [result][lane]
+
+		GLuint columns = (GLuint)((image.width + 3) / 4);
+		GLuint blockBytes = image.alpha ? 16 : 8;
+		int step = image.channels < 3 ? 0 : 1;
+		bool sourceAlpha = 0 == (image.channels & 1);
+		unsigned char *output = image.blocks + (size_t)row * columns * blockBytes;
+
+		for (GLuint first = 0; first < columns; first += L)
+		{
+			// Most groups lie inside the image, those of RGB and RGBA images are read without any clamping
+			bool inside = (int)((first + L) * 4) <= image.width && (int)(row * 4 + 4) <= image.height;
+
+			if (inside && 3 == image.channels)
+			{
+				gatherInside<L, 3>(image, row, first, bytes);
+			}
+			else if (inside && 4 == image.channels)
+			{
+				gatherInside<L, 4>(image, row, first, bytes);
+			}
+			else
+			{
+				for (GLuint lane = 0; lane < L; lane++)
+				{
+					GLuint column = std::min(first + lane, columns - 1);
+
+					for (GLuint y = 0; y < 4; y++)
+					{
+						const unsigned char *line = image.pixels + (size_t)std::min((int)(row * 4 + y), image.height - 1) * image.width * image.channels;
+
+						for (GLuint x = 0; x < 4; x++)
+						{
+							const unsigned char *texel = line + std::min((int)(column * 4 + x), image.width - 1) * image.channels;
+							unsigned char *target = bytes + (y * 4 + x) * L + lane;
+
+							target[0 * 16 * L] = texel[0];
+							target[1 * 16 * L] = texel[step];
+							target[2 * 16 * L] = texel[step + step];
+							target[3 * 16 * L] = sourceAlpha ? texel[image.channels - 1] : 255;
+						}
+					}
+				}
+			}
+
+			// Gathered as bytes, converted L at a time
+			for (GLuint i = 0; i < 4 * 16; i++)
+			{
+				V::LoadBytes(bytes + i * L).Store(texels + i * L);
+			}
+
+			compressColorBlocks<V>(texels, results);
+
+			if (image.alpha)
+			{
+				compressAlphaBlocks<V>(texels + 3 * 16 * L, results);
+			}
+
+			for (GLuint lane = 0; lane < L && first + lane < columns; lane++)
+			{
+				unsigned char *block = output + (size_t)(first + lane) * blockBytes;
+
+				if (image.alpha)
+				{
+					GLuint low = (GLuint)results[RESULT_ALPHA_BITS_LOW * L + lane];
+					GLuint high = (GLuint)results[RESULT_ALPHA_BITS_HIGH * L + lane];
+
+					block[0] = (unsigned char)results[RESULT_ALPHA0 * L + lane];
+					block[1] = (unsigned char)results[RESULT_ALPHA1 * L + lane];
+					block[2] = low & 255;
+					block[3] = (low >> 8) & 255;
+					block[4] = (low >> 16) & 255;
+					block[5] = high & 255;
+					block[6] = (high >> 8) & 255;
+					block[7] = (high >> 16) & 255;
+					block += 8;
+				}
+
+				GLuint color0 = (GLuint)results[RESULT_COLOR0 * L + lane];
+				GLuint color1 = (GLuint)results[RESULT_COLOR1 * L + lane];
+				GLuint low = (GLuint)results[RESULT_COLOR_BITS_LOW * L + lane];
+				GLuint high = (GLuint)results[RESULT_COLOR_BITS_HIGH * L + lane];
+
+				block[0] = color0 & 255;
+				block[1] = color0 >> 8;
+				block[2] = color1 & 255;
+				block[3] = color1 >> 8;
+				block[4] = low & 255;
+				block[5] = low >> 8;
+				block[6] = high & 255;
+				block[7] = high >> 8;
+			}
+		}
+	}
+
+	// Texels of L whole blocks starting at column first, C channels, into [channel][texel][lane] bytes
+	template <GLuint L, GLuint C>
+	static void gatherInside(const Image &image, GLuint row, GLuint first, unsigned char *bytes)
+	{
+		for (GLuint y = 0; y < 4; y++)
+		{
+			const unsigned char *line = image.pixels + ((size_t)(row * 4 + y) * image.width + first * 4) * C;
+
+			for (GLuint lane = 0; lane < L; lane++)
+			{
+				for (GLuint x = 0; x < 4; x++)
+				{
+					const unsigned char *texel = line + (lane * 4 + x) * C;
+					unsigned char *target = bytes + (y * 4 + x) * L + lane;
+
+					target[0 * 16 * L] = texel[0];
+					target[1 * 16 * L] = texel[1];
+					target[2 * 16 * L] = texel[2];
+					target[3 * 16 * L] = 4 == C ? texel[3] : 255;
+				}
+			}
+		}
+	}
+
+	// Color half of V::LANES blocks, see compress_DDS_color_block and LSE_master_colors_max_min
+	template <class V>
+	static void compressColorBlocks(const GLfloat *texels, GLfloat *results)
+	{
+		const GLuint L = V::LANES;
+		const GLfloat *red = texels, *green = texels + 16 * L, *blue = texels + 32 * L;
+
+		// Mean and covariance
+		V meanR(0.0f), meanG(0.0f), meanB(0.0f);
+
+		for (GLuint t = 0; t < 16; t++)
+		{
+			meanR = meanR + V::Load(red + t * L);
+			meanG = meanG + V::Load(green + t * L);
+			meanB = meanB + V::Load(blue + t * L);
+		}
+
+		meanR = meanR * (1.0f / 16.0f);
+		meanG = meanG * (1.0f / 16.0f);
+		meanB = meanB * (1.0f / 16.0f);
+
+		V rr(0.0f), gg(0.0f), bb(0.0f), rg(0.0f), rb(0.0f), gb(0.0f);
+
+		for (GLuint t = 0; t < 16; t++)
+		{
+			V r = V::Load(red + t * L) - meanR, g = V::Load(green + t * L) - meanG, b = V::Load(blue + t * L) - meanB;
+
+			rr = rr + r * r;
+			gg = gg + g * g;
+			bb = bb + b * b;
+			rg = rg + r * g;
+			rb = rb + r * b;
+			gb = gb + g * b;
+		}
+
+		// Largest eigenvector by three steps of the power method, from the same odd start as image_DXT.c
+		// (not all ones, that can land on a zero vector). Scaled after every step to keep it in range.
+		V axisR(1.0f), axisG(2.718281828f), axisB(3.141592654f);
+
+		for (GLuint i = 0; i < 3; i++)
+		{
+			V r = axisR * rr + axisG * rg + axisB * rb;
+			V g = axisR * rg + axisG * gg + axisB * gb;
+			V b = axisR * rb + axisG * gb + axisB * bb;
+			V largest = Max(Max(Max(r, V(0.0f) - r), Max(g, V(0.0f) - g)), Max(b, V(0.0f) - b));
+			V scale = V(1.0f) / Max(largest, V(1e-20f));
+
+			axisR = r * scale;
+			axisG = g * scale;
+			axisB = b * scale;
+		}
+
+		// Extremes of the texels projected on the axis
+		V minDot(1e30f), maxDot(-1e30f);
+
+		for (GLuint t = 0; t < 16; t++)
+		{
+			V dot = axisR * V::Load(red + t * L) + axisG * V::Load(green + t * L) + axisB * V::Load(blue + t * L);
+
+			minDot = Min(minDot, dot);
+			maxDot = Max(maxDot, dot);
+		}
+
+		V center = axisR * meanR + axisG * meanG + axisB * meanB;
+		V inverseLength = V(1.0f) / (V(0.00001f) + axisR * axisR + axisG * axisG + axisB * axisB);
+		V maxT = (maxDot - center) * inverseLength, minT = (minDot - center) * inverseLength;
+
+		// Endpoints on the axis, to 565 (rounded, as convert_bit_range) and back to 888
+		V r0 = quantize(meanR + axisR * maxT, 31.0f), g0 = quantize(meanG + axisG * maxT, 63.0f), b0 = quantize(meanB + axisB * maxT, 31.0f);
+		V r1 = quantize(meanR + axisR * minT, 31.0f), g1 = quantize(meanG + axisG * minT, 63.0f), b1 = quantize(meanB + axisB * minT, 31.0f);
+		V color0 = r0 * 2048.0f + g0 * 32.0f + b0, color1 = r1 * 2048.0f + g1 * 32.0f + b1;
+
+		// The larger one goes first
+		V swap = Less(color0, color1);
+		V maxR = Select(swap, r1, r0), maxG = Select(swap, g1, g0), maxB = Select(swap, b1, b0);
+		V minR = Select(swap, r0, r1), minG = Select(swap, g0, g1), minB = Select(swap, b0, b1);
+		Max(color0, color1).Store(results + RESULT_COLOR0 * L);
+		Min(color0, color1).Store(results + RESULT_COLOR1 * L);
+
+		V c0R = expand(maxR, 31.0f), c0G = expand(maxG, 63.0f), c0B = expand(maxB, 31.0f);
+		V lineR = expand(minR, 31.0f) - c0R, lineG = expand(minG, 63.0f) - c0G, lineB = expand(minB, 31.0f) - c0B;
+
+		// Both endpoints equal: the line is empty, every texel gets index 0
+		V lengthSquared = lineR * lineR + lineG * lineG + lineB * lineB;
+		V inverse = V(1.0f) / Max(lengthSquared, V(1.0f));
+
+		lineR = lineR * inverse;
+		lineG = lineG * inverse;
+		lineB = lineB * inverse;
+
+		V offset = lineR * c0R + lineG * c0G + lineB * c0B;
+
+		// Position on the line rounded to [0, 3], then in DXT order (0 and 1 the endpoints, 2 and 3 between)
+		V bits[2] = { V(0.0f), V(0.0f) };
+
+		for (GLint t = 15; t >= 0; t--)
+		{
+			V dot = lineR * V::Load(red + t * L) + lineG * V::Load(green + t * L) + lineB * V::Load(blue + t * L) - offset;
+			V value = Min(Max(Truncate(dot * 3.0f + 0.5f), V(0.0f)), V(3.0f));
+			V index = Select(Equal(value, V(0.0f)), V(0.0f), Select(Equal(value, V(3.0f)), V(1.0f), value + 1.0f));
+
+			bits[t / 8] = bits[t / 8] * 4.0f + index;
+		}
+
+		bits[0].Store(results + RESULT_COLOR_BITS_LOW * L);
+		bits[1].Store(results + RESULT_COLOR_BITS_HIGH * L);
+	}
+
+	// Alpha half of V::LANES DXT5 blocks, see compress_DDS_alpha_block
+	template <class V>
+	static void compressAlphaBlocks(const GLfloat *alpha, GLfloat *results)
+	{
+		const GLuint L = V::LANES;
+		V alpha0 = V::Load(alpha), alpha1 = alpha0;
+
+		for (GLuint t = 1; t < 16; t++)
+		{
+			V a = V::Load(alpha + t * L);
+
+			alpha0 = Max(alpha0, a);
+			alpha1 = Min(alpha1, a);
+		}
+
+		alpha0.Store(results + RESULT_ALPHA0 * L);
+		alpha1.Store(results + RESULT_ALPHA1 * L);
+
+		// 8 levels from alpha1 to alpha0, in DXT order: 0 and 1 the endpoints, 2-7 from alpha0 down
+		V scale = V(7.9999f) / Max(alpha0 - alpha1, V(1.0f));
+		V bits[2] = { V(0.0f), V(0.0f) };
+
+		for (GLint t = 15; t >= 0; t--)
+		{
+			V value = Truncate((V::Load(alpha + t * L) - alpha1) * scale);
+			V index = Select(Equal(value, V(0.0f)), V(1.0f), Select(Equal(value, V(7.0f)), V(0.0f), V(8.0f) - value));
+
+			bits[t / 8] = bits[t / 8] * 8.0f + index;
+		}
+
+		bits[0].Store(results + RESULT_ALPHA_BITS_LOW * L);
+		bits[1].Store(results + RESULT_ALPHA_BITS_HIGH * L);
+	}
+
+	// 0-255 channel to 5 or 6 bits, rounding to nearest (there are never ties)
+	template <class V>
+	static V quantize(V channel, GLfloat levels)
+	{
+		V clamped = Min(Max(Truncate(channel + 0.5f), V(0.0f)), V(255.0f));
+
+		return Truncate(clamped * (levels / 255.0f) + 0.5f);
+	}
+
+	// And back to 0-255
+	template <class V>
+	static V expand(V quantized, GLfloat levels)
+	{
+		return Truncate(quantized * (255.0f / levels) + 0.5f);
+	}
+};
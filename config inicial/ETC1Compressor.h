@@ -0,0 +1,601 @@
+#pragma once
+
+// Std. Includes
+#include <algorithm>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include "JobSystem.h"
+#include "SIMDLanes.h"
+
+// Error evaluation kernels, the best one compiled in is used by default
+enum ETC1Kernel
+{
+	ETC1_KERNEL_SCALAR = 0,
+	ETC1_KERNEL_SSE2,
+	ETC1_KERNEL_AVX2
+};
+
+// How much of the block encodings is searched
+enum ETC1Search
+{
+	ETC1_SEARCH_FAST = 0,	// One flip, chosen from how well the sub-block averages fit; tables tried upwards until the error grows
+	ETC1_SEARCH_MEDIUM,		// Both flips, every table, base colors from the sub-block averages: the blocks etc1_encode_block writes
+	ETC1_SEARCH_EXHAUSTIVE	// Also both base color modes, and every base color one quantization step around the averages
+};
+
+// Rows of 4x4 blocks per job when the image is split over a job system (32 pixel rows)
+const GLuint ETC1_COMPRESSOR_JOB_ROWS = 8;
+
+// Intensity modifiers of the 8 tables, in pixel index order (a, b, -a, -b), as in etc1_utils.c
+const GLint ETC1_MODIFIERS[8][4] =
+{
+	{ 2, 8, -2, -8 },
+	{ 5, 17, -5, -17 },
+	{ 9, 29, -9, -29 },
+	{ 13, 42, -13, -42 },
+	{ 18, 60, -18, -60 },
+	{ 24, 80, -24, -80 },
+	{ 33, 106, -33, -106 },
+	{ 47, 183, -47, -183 }
+};
+
+// ETC1 encoder for RGB images, writing the same block layout as SOIL2's etc1_encode_image. A block is two
+// 2x4 or 4x2 sub-blocks (the flip bit), each with a base color and a table of 4 intensity modifiers; every
+// texel picks the modifier closest to it, weighing the error 3:6:1 in R, G, B as etc1_utils.c does.
+// The candidates are scored with the 8 texels of a sub-block in SIMD lanes, 8 at a time with AVX2 and 4
+// with SSE2, and with a job system the rows of blocks are spread over its threads.
+// Texels past the right or bottom edge repeat the last column or row.
+class ETC1Compressor
+{
+public:
+	// Without a job system every row is compressed on the calling thread
+	explicit ETC1Compressor(JobSystem *jobs = nullptr, ETC1Search search = ETC1_SEARCH_MEDIUM) : jobs(jobs), search(search)
+	{
+#if defined(__AVX2__)
+		this->kernel = ETC1_KERNEL_AVX2;
+#elif defined(SIMD_LANES_SSE2)
+		this->kernel = ETC1_KERNEL_SSE2;
+#else
+		this->kernel = ETC1_KERNEL_SCALAR;
+#endif
+	}
+
+	// Selects a kernel, falling back to the best one that was compiled in
+	void SetKernel(ETC1Kernel requested)
+	{
+#if defined(__AVX2__)
+		this->kernel = requested;
+#elif defined(SIMD_LANES_SSE2)
+		this->kernel = std::min(requested, ETC1_KERNEL_SSE2);
+#else
+		this->kernel = ETC1_KERNEL_SCALAR;
+		(void)requested;
+#endif
+	}
+
+	ETC1Kernel GetKernel() const
+	{
+		return this->kernel;
+	}
+
+	void SetSearch(ETC1Search search)
+	{
+		this->search = search;
+	}
+
+	ETC1Search GetSearch() const
+	{
+		return this->search;
+	}
+
+	// Bytes of the blocks of a width x height image, 8 per 4x4 block
+	static size_t GetCompressedSize(int width, int height)
+	{
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+	}
+
+	// Compresses an RGB or RGBA image (alpha is dropped) into GetCompressedSize bytes of blocks
+	bool Compress(const unsigned char *pixels, int width, int height, int channels, unsigned char *blocks)
+	{
+		if (!pixels || !blocks || width < 1 || height < 1 || channels < 3 || channels > 4)
+		{
+			return false;
+		}
+
+		Image image = { pixels, width, height, channels, blocks };
+		GLuint rows = (GLuint)((height + 3) / 4);
+
+		if (this->jobs)
+		{
+			this->jobs->ParallelFor(rows, ETC1_COMPRESSOR_JOB_ROWS, [this, &image](GLuint begin, GLuint end, GLuint)
+			{
+				this->compressRows(image, begin, end);
+			});
+		}
+		else
+		{
+			this->compressRows(image, 0, rows);
+		}
+
+		return true;
+	}
+
+private:
+	struct Image
+	{
+		const unsigned char *pixels;
+		int width, height, channels;
+		unsigned char *blocks;
+	};
+
+	// The 8 texels of one sub-block, and where each one's index bits go in the low word
+	struct Subblock
+	{
+		alignas(32) GLfloat red[8];
+		alignas(32) GLfloat green[8];
+		alignas(32) GLfloat blue[8];
+		GLuint bit[8];
+		GLint average[3];
+	};
+
+	// A sub-block encoded with one base color: its best table and that table's error
+	struct Choice
+	{
+		GLint base[3];		// Quantized, 5 bits in differential mode, 4 in individual mode
+		GLuint table;
+		GLfloat error;
+	};
+
+	JobSystem *jobs;
+	ETC1Search search;
+	ETC1Kernel kernel;
+
+	void compressRows(const Image &image, GLuint begin, GLuint end)
+	{
+		for (GLuint row = begin; row < end; row++)
+		{
+			switch (this->kernel)
+			{
+#if defined(__AVX2__)
+			case ETC1_KERNEL_AVX2:
+				compressRow<SIMDLanes8>(image, row, this->search);
+				break;
+#endif
+#if defined(SIMD_LANES_SSE2)
+			case ETC1_KERNEL_SSE2:
+				compressRow<SIMDLanes4>(image, row, this->search);
+				break;
+#endif
+			default:
+				compressRow<SIMDLanes1>(image, row, this->search);
+				break;
+			}
+		}
+	}
+
+	template <class V>
+	static void compressRow(const Image &image, GLuint row, ETC1Search search)
+	{
+		GLuint columns = (GLuint)((image.width + 3) / 4);
+		unsigned char *output = image.blocks + (size_t)row * columns * 8;
+
+		for (GLuint column = 0; column < columns; column++)
+		{
+			// Sub-blocks 0 and 1 are the left and right halves, 2 and 3 the top and bottom ones (flipped)
+			Subblock subblocks[4];
+			GLuint filled[4] = { 0, 0, 0, 0 };
+
+			for (GLuint y = 0; y < 4; y++)
+			{
+				const unsigned char *line = image.pixels + (size_t)std::min((int)(row * 4 + y), image.height - 1) * image.width * image.channels;
+
+				for (GLuint x = 0; x < 4; x++)
+				{
+					const unsigned char *texel = line + std::min((int)(column * 4 + x), image.width - 1) * image.channels;
+					GLuint halves[2] = { x / 2, 2 + y / 2 };
+
+					for (GLuint h = 0; h < 2; h++)
+					{
+						Subblock &subblock = subblocks[halves[h]];
+						GLuint i = filled[halves[h]]++;
+
+						subblock.red[i] = texel[0];
+						subblock.green[i] = texel[1];
+						subblock.blue[i] = texel[2];
+						subblock.bit[i] = y + x * 4;
+					}
+				}
+			}
+
+			for (GLuint s = 0; s < 4; s++)
+			{
+				GLint sum[3] = { 0, 0, 0 };
+
+				for (GLuint i = 0; i < 8; i++)
+				{
+					sum[0] += (GLint)subblocks[s].red[i];
+					sum[1] += (GLint)subblocks[s].green[i];
+					sum[2] += (GLint)subblocks[s].blue[i];
+				}
+
+				for (GLuint c = 0; c < 3; c++)
+				{
+					subblocks[s].average[c] = (sum[c] + 4) >> 3;
+				}
+			}
+
+			GLuint high, low;
+			encodeBlock<V>(subblocks, search, high, low);
+
+			unsigned char *block = output + (size_t)column * 8;
+			block[0] = (unsigned char)(high >> 24);
+			block[1] = (unsigned char)(high >> 16);
+			block[2] = (unsigned char)(high >> 8);
+			block[3] = (unsigned char)high;
+			block[4] = (unsigned char)(low >> 24);
+			block[5] = (unsigned char)(low >> 16);
+			block[6] = (unsigned char)(low >> 8);
+			block[7] = (unsigned char)low;
+		}
+	}
+
+	template <class V>
+	static void encodeBlock(const Subblock *subblocks, ETC1Search search, GLuint &high, GLuint &low)
+	{
+		GLuint flips[2] = { 0, 1 };
+		GLuint flipCount = 2;
+
+		// The flip whose halves are closest to their own averages
+		if (ETC1_SEARCH_FAST == search)
+		{
+			GLfloat spread[2];
+
+			for (GLuint flip = 0; flip < 2; flip++)
+			{
+				spread[flip] = 0.0f;
+
+				for (GLuint s = 0; s < 2; s++)
+				{
+					const Subblock &subblock = subblocks[flip * 2 + s];
+					GLfloat average[3] = { (GLfloat)subblock.average[0], (GLfloat)subblock.average[1], (GLfloat)subblock.average[2] };
+
+					spread[flip] += sumLanes<V>(subblock, average, [](V red, V green, V blue) { return red * red * 3.0f + green * green * 6.0f + blue * blue; });
+				}
+			}
+
+			flips[0] = spread[1] < spread[0] ? 1 : 0;
+			flipCount = 1;
+		}
+
+		GLfloat bestError = -1.0f;
+
+		for (GLuint f = 0; f < flipCount; f++)
+		{
+			GLuint flip = flips[f];
+			const Subblock *halves = subblocks + flip * 2;
+			Choice choices[2];
+			bool differential;
+
+			if (ETC1_SEARCH_EXHAUSTIVE == search)
+			{
+				Choice individual[2], paired[2];
+				bool canPair = searchDifferential<V>(halves, paired);
+
+				searchIndividual<V>(halves, individual);
+				differential = canPair && paired[0].error + paired[1].error <= individual[0].error + individual[1].error;
+				choices[0] = differential ? paired[0] : individual[0];
+				choices[1] = differential ? paired[1] : individual[1];
+			}
+			else
+			{
+				// As etc_encodeBaseColors: differential when the 5 bit averages are close enough
+				differential = true;
+
+				for (GLuint s = 0; s < 2; s++)
+				{
+					for (GLuint c = 0; c < 3; c++)
+					{
+						choices[s].base[c] = convert8To5(halves[s].average[c]);
+					}
+				}
+
+				for (GLuint c = 0; c < 3; c++)
+				{
+					GLint delta = choices[1].base[c] - choices[0].base[c];
+					differential = differential && delta >= -4 && delta <= 3;
+				}
+
+				for (GLuint s = 0; s < 2; s++)
+				{
+					for (GLuint c = 0; c < 3 && !differential; c++)
+					{
+						choices[s].base[c] = convert8To4(halves[s].average[c]);
+					}
+
+					chooseTable<V>(halves[s], choices[s], differential, ETC1_SEARCH_FAST == search);
+				}
+			}
+
+			GLfloat error = choices[0].error + choices[1].error;
+
+			// Ties keep the unflipped encoding, as take_best does
+			if (bestError < 0.0f || error < bestError)
+			{
+				bestError = error;
+				high = packHigh(choices, differential, flip);
+				low = packIndices<V>(halves[0], expand(choices[0].base, differential), choices[0].table) | packIndices<V>(halves[1], expand(choices[1].base, differential), choices[1].table);
+			}
+		}
+	}
+
+	// Best table for the choice's base color. Fast stops at the first table that does worse than the one
+	// before: the error drops while the modifiers grow towards the sub-block's spread, then rises.
+	template <class V>
+	static void chooseTable(const Subblock &subblock, Choice &choice, bool differential, bool fast)
+	{
+		Color base = expand(choice.base, differential);
+		choice.error = -1.0f;
+
+		for (GLuint table = 0; table < 8; table++)
+		{
+			GLfloat error = tableError<V>(subblock, base, table);
+
+			if (choice.error < 0.0f || error < choice.error)
+			{
+				choice.error = error;
+				choice.table = table;
+			}
+			else if (fast)
+			{
+				return;
+			}
+		}
+	}
+
+	// Exhaustive, individual mode: each half on its own, 4 bit base colors within a step of the average
+	template <class V>
+	static void searchIndividual(const Subblock *halves, Choice *choices)
+	{
+		for (GLuint s = 0; s < 2; s++)
+		{
+			choices[s].error = -1.0f;
+
+			for (GLuint n = 0; n < 27; n++)
+			{
+				Choice candidate;
+
+				if (!neighbour(halves[s].average, n, false, candidate.base))
+				{
+					continue;
+				}
+
+				chooseTable<V>(halves[s], candidate, false, false);
+
+				if (choices[s].error < 0.0f || candidate.error < choices[s].error)
+				{
+					choices[s] = candidate;
+				}
+			}
+		}
+	}
+
+	// Exhaustive, differential mode: 5 bit base colors within a step of the averages, the best pair whose
+	// difference fits in 3 bits per channel. False when no pair does.
+	template <class V>
+	static bool searchDifferential(const Subblock *halves, Choice *choices)
+	{
+		Choice candidates[2][27];
+		GLuint counts[2] = { 0, 0 };
+
+		for (GLuint s = 0; s < 2; s++)
+		{
+			for (GLuint n = 0; n < 27; n++)
+			{
+				Choice &candidate = candidates[s][counts[s]];
+
+				if (neighbour(halves[s].average, n, true, candidate.base))
+				{
+					chooseTable<V>(halves[s], candidate, true, false);
+					counts[s]++;
+				}
+			}
+		}
+
+		GLfloat best = -1.0f;
+
+		for (GLuint i = 0; i < counts[0]; i++)
+		{
+			for (GLuint j = 0; j < counts[1]; j++)
+			{
+				bool fits = true;
+
+				for (GLuint c = 0; c < 3; c++)
+				{
+					GLint delta = candidates[1][j].base[c] - candidates[0][i].base[c];
+					fits = fits && delta >= -4 && delta <= 3;
+				}
+
+				GLfloat error = candidates[0][i].error + candidates[1][j].error;
+
+				if (fits && (best < 0.0f || error < best))
+				{
+					best = error;
+					choices[0] = candidates[0][i];
+					choices[1] = candidates[1][j];
+				}
+			}
+		}
+
+		return best >= 0.0f;
+	}
+
+	// The n-th of the 27 quantized colors around the average (-1, 0, +1 per channel), false when out of range
+	static bool neighbour(const GLint *average, GLuint n, bool differential, GLint *base)
+	{
+		GLint levels = differential ? 31 : 15;
+
+		for (GLuint c = 0; c < 3; c++, n /= 3)
+		{
+			base[c] = (differential ? convert8To5(average[c]) : convert8To4(average[c])) + (GLint)(n % 3) - 1;
+
+			if (base[c] < 0 || base[c] > levels)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	struct Color
+	{
+		GLint rgb[3];
+	};
+
+	static Color expand(const GLint *base, bool differential)
+	{
+		Color color;
+
+		for (GLuint c = 0; c < 3; c++)
+		{
+			color.rgb[c] = differential ? (base[c] << 3) | (base[c] >> 2) : (base[c] << 4) | base[c];
+		}
+
+		return color;
+	}
+
+	// Sum over the sub-block's texels of metric(red, green, blue), the texels minus the given color
+	template <class V, class Metric>
+	static GLfloat sumLanes(const Subblock &subblock, const GLfloat *color, Metric metric)
+	{
+		const GLuint L = V::LANES;
+		alignas(32) GLfloat lanes[8];
+		V total(0.0f);
+
+		for (GLuint i = 0; i < 8; i += L)
+		{
+			total = total + metric(V::Load(subblock.red + i) - V(color[0]), V::Load(subblock.green + i) - V(color[1]), V::Load(subblock.blue + i) - V(color[2]));
+		}
+
+		total.Store(lanes);
+		GLfloat sum = 0.0f;
+
+		for (GLuint i = 0; i < L; i++)
+		{
+			sum += lanes[i];
+		}
+
+		return sum;
+	}
+
+	// Weighted squared error of every texel to its closest modifier of the table, and that modifier's index.
+	// Errors are whole numbers below 2^24, exact in floats.
+	template <class V>
+	static void closestModifiers(const Subblock &subblock, const Color &base, GLuint table, GLuint first, V &error, V &index)
+	{
+		V red = V::Load(subblock.red + first), green = V::Load(subblock.green + first), blue = V::Load(subblock.blue + first);
+
+		for (GLuint m = 0; m < 4; m++)
+		{
+			GLint modifier = ETC1_MODIFIERS[table][m];
+			V dr = V((GLfloat)clamp(base.rgb[0] + modifier)) - red;
+			V dg = V((GLfloat)clamp(base.rgb[1] + modifier)) - green;
+			V db = V((GLfloat)clamp(base.rgb[2] + modifier)) - blue;
+			V candidate = dr * dr * 3.0f + dg * dg * 6.0f + db * db;
+
+			if (0 == m)
+			{
+				error = candidate;
+				index = V(0.0f);
+			}
+			else
+			{
+				// Strictly smaller, so ties keep the first modifier as chooseModifier does
+				V closer = Less(candidate, error);
+				error = Select(closer, candidate, error);
+				index = Select(closer, V((GLfloat)m), index);
+			}
+		}
+	}
+
+	template <class V>
+	static GLfloat tableError(const Subblock &subblock, const Color &base, GLuint table)
+	{
+		alignas(32) GLfloat lanes[8];
+		V total(0.0f), error, index;
+
+		for (GLuint i = 0; i < 8; i += V::LANES)
+		{
+			closestModifiers<V>(subblock, base, table, i, error, index);
+			total = total + error;
+		}
+
+		total.Store(lanes);
+		GLfloat sum = 0.0f;
+
+		for (GLuint i = 0; i < V::LANES; i++)
+		{
+			sum += lanes[i];
+		}
+
+		return sum;
+	}
+
+	// Index bits of the sub-block: the low bit of texel k at bit k, the high one at bit k + 16
+	template <class V>
+	static GLuint packIndices(const Subblock &subblock, const Color &base, GLuint table)
+	{
+		alignas(32) GLfloat indices[8];
+		V error, index;
+
+		for (GLuint i = 0; i < 8; i += V::LANES)
+		{
+			closestModifiers<V>(subblock, base, table, i, error, index);
+			index.Store(indices + i);
+		}
+
+		GLuint bits = 0;
+
+		for (GLuint i = 0; i < 8; i++)
+		{
+			GLuint value = (GLuint)indices[i];
+			bits |= (((value >> 1) << 16) | (value & 1)) << subblock.bit[i];
+		}
+
+		return bits;
+	}
+
+	static GLuint packHigh(const Choice *choices, bool differential, GLuint flip)
+	{
+		GLuint high = (choices[0].table << 5) | (choices[1].table << 2) | flip;
+
+		if (differential)
+		{
+			GLint dr = choices[1].base[0] - choices[0].base[0], dg = choices[1].base[1] - choices[0].base[1], db = choices[1].base[2] - choices[0].base[2];
+
+			return high | (choices[0].base[0] << 27) | ((7 & dr) << 24) | (choices[0].base[1] << 19) | ((7 & dg) << 16) | (choices[0].base[2] << 11) | ((7 & db) << 8) | 2;
+		}
+
+		return high | (choices[0].base[0] << 28) | (choices[1].base[0] << 24) | (choices[0].base[1] << 20) | (choices[1].base[1] << 16) | (choices[0].base[2] << 12) | (choices[1].base[2] << 8);
+	}
+
+	static GLint clamp(GLint value)
+	{
+		return std::min(std::max(value, 0), 255);
+	}
+
+	// Rounded as divideBy255 in etc1_utils.c
+	static GLint convert8To5(GLint value)
+	{
+		GLint d = value * 31;
+		return (d + 128 + (d >> 8)) >> 8;
+	}
+
+	static GLint convert8To4(GLint value)
+	{
+		GLint d = value * 15;
+		return (d + 128 + (d >> 8)) >> 8;
+	}
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+// GL Includes
+#include <GL/glew.h>
+
+// Default simulation rate
+const GLfloat FIXED_TIMESTEP = 1.0f / 60.0f;
+
+// Most steps run for one frame. After a long stall (loading, a breakpoint) the rest of the time is
+// dropped instead of making the next frames even slower trying to catch up.
+const GLuint FIXED_TIMESTEP_MAX_STEPS = 8;
+
+// Accumulator that turns variable frame times into a whole number of fixed simulation steps.
+// Every frame: steps = Advance(deltaTime), simulate that many steps of GetStep() seconds, then render
+// blending the last two simulated states with GetAlpha().
+class FixedTimestep
+{
+public:
+	explicit FixedTimestep(GLfloat step = FIXED_TIMESTEP, GLuint maxSteps = FIXED_TIMESTEP_MAX_STEPS) : step(step), maxSteps(maxSteps), accumulator(0.0), stepCount(0)
+	{
+	}
+
+	// Adds the frame time and returns how many steps have to be simulated this frame
+	GLuint Advance(GLfloat frameTime)
+	{
+		if (frameTime > 0.0f)
+		{
+			this->accumulator += frameTime;
+		}
+
+		GLuint steps = (GLuint)(this->accumulator / this->step);
+
+		if (steps > this->maxSteps)
+		{
+			steps = this->maxSteps;
+			this->accumulator = this->step * steps;
+		}
+
+		this->accumulator -= (double)this->step * steps;
+		this->stepCount += steps;
+
+		return steps;
+	}
+
+	// How far the rendered frame is between the previous step (0) and the last one (1)
+	GLfloat GetAlpha() const
+	{
+		return (GLfloat)(this->accumulator / this->step);
+	}
+
+	GLfloat GetStep() const
+	{
+		return this->step;
+	}
+
+	// Simulated seconds so far, always a multiple of the step
+	double GetSimulationTime() const
+	{
+		return (double)this->step * this->stepCount;
+	}
+
+	unsigned long long GetStepCount() const
+	{
+		return this->stepCount;
+	}
+
+private:
+	GLfloat step;
+	GLuint maxSteps;
+	double accumulator;
+	unsigned long long stepCount;
+};
+
+// Value written once per simulation step and read for rendering between the last two steps.
+// Works with anything that can be added and scaled: floats, glm vectors.
+template <typename T>
+class Interpolated
+{
+public:
+	explicit Interpolated(const T &value = T()) : previous(value), current(value)
+	{
+	}
+
+	// New simulated value, the old one becomes the previous state
+	void Set(const T &value)
+	{
+		this->previous = this->current;
+		this->current = value;
+	}
+
+	// Jumps to a value without blending from the old one (teleports, the first frame)
+	void Reset(const T &value)
+	{
+		this->previous = value;
+		this->current = value;
+	}
+
+	const T &GetCurrent() const
+	{
+		return this->current;
+	}
+
+	T Get(GLfloat alpha) const
+	{
+		return this->previous + (this->current - this->previous) * alpha;
+	}
+
+private:
+	T previous, current;
+};
@@ -0,0 +1,439 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Camera.h"
+#include "FrameCounters.h"
+#include "GpuTimer.h"
+#include "RenderContext.h"
+
+// Frames run before measuring (shader compilation, first texture uploads, caches) and frames measured
+const GLuint FRAME_BENCHMARK_DEFAULT_WARMUP = 60;
+const GLuint FRAME_BENCHMARK_DEFAULT_FRAMES = 600;
+
+// Simulated seconds per frame while benchmarking, so every run animates and moves the camera the same way
+const GLfloat FRAME_BENCHMARK_STEP = 1.0f / 60.0f;
+
+// CPU work of a frame timed separately
+enum FrameStage
+{
+	FRAME_STAGE_UPDATE = 0,	// Input, animation, simulation
+	FRAME_STAGE_CULL,		// Visibility
+	FRAME_STAGE_SUBMIT,		// GL calls
+	FRAME_STAGE_COUNT
+};
+
+// Command line switches, added to the RenderContext ones:
+//   --benchmark file.json  run the scripted benchmark and write the report ("-" prints it)
+//   --warmup N             frames run before measuring
+//   --measure N            frames measured
+struct FrameBenchmarkOptions
+{
+	bool enabled = false;
+	GLuint warmupFrames = FRAME_BENCHMARK_DEFAULT_WARMUP;
+	GLuint measuredFrames = FRAME_BENCHMARK_DEFAULT_FRAMES;
+	std::string outputPath;
+};
+
+inline FrameBenchmarkOptions ParseFrameBenchmarkOptions(int argc, char **argv)
+{
+	FrameBenchmarkOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--benchmark") && i + 1 < argc)
+		{
+			options.enabled = true;
+			options.outputPath = argv[++i];
+		}
+		else if (0 == strcmp(argv[i], "--warmup") && i + 1 < argc)
+		{
+			options.warmupFrames = (GLuint)atoi(argv[++i]);
+		}
+		else if (0 == strcmp(argv[i], "--measure") && i + 1 < argc)
+		{
+			options.measuredFrames = (GLuint)atoi(argv[++i]);
+		}
+	}
+
+	return options;
+}
+
+// Camera positions and angles over time, linearly interpolated and looped
+class CameraPath
+{
+public:
+	// Keys must be added in time order, angles in degrees like Camera's
+	void AddKey(GLfloat time, glm::vec3 position, GLfloat yaw, GLfloat pitch)
+	{
+		Key key = { time, position, yaw, pitch };
+		this->keys.push_back(key);
+	}
+
+	bool IsEmpty() const
+	{
+		return this->keys.empty();
+	}
+
+	void Evaluate(GLfloat time, glm::vec3 &position, GLfloat &yaw, GLfloat &pitch) const
+	{
+		if (this->keys.empty())
+		{
+			return;
+		}
+
+		GLfloat duration = this->keys.back().time;
+
+		if (duration > 0.0f)
+		{
+			time = fmod(time, duration);
+		}
+
+		GLuint next = 0;
+
+		while (next < this->keys.size() && this->keys[next].time <= time)
+		{
+			next++;
+		}
+
+		if (0 == next || next == this->keys.size())
+		{
+			const Key &key = this->keys[next ? next - 1 : 0];
+			position = key.position;
+			yaw = key.yaw;
+			pitch = key.pitch;
+			return;
+		}
+
+		const Key &a = this->keys[next - 1];
+		const Key &b = this->keys[next];
+		GLfloat t = (time - a.time) / (b.time - a.time);
+
+		position = a.position + (b.position - a.position) * t;
+		yaw = a.yaw + (b.yaw - a.yaw) * t;
+		pitch = a.pitch + (b.pitch - a.pitch) * t;
+	}
+
+	// View matrix at the given time, for scenes without a Camera
+	glm::mat4 GetViewMatrix(GLfloat time) const
+	{
+		glm::vec3 position(0.0f);
+		GLfloat yaw = YAW, pitch = PITCH;
+		this->Evaluate(time, position, yaw, pitch);
+
+		glm::vec3 front(cos(glm::radians(yaw)) * cos(glm::radians(pitch)), sin(glm::radians(pitch)), sin(glm::radians(yaw)) * cos(glm::radians(pitch)));
+
+		return glm::lookAt(position, position + front, glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+
+private:
+	struct Key
+	{
+		GLfloat time;
+		glm::vec3 position;
+		GLfloat yaw, pitch;
+	};
+
+	std::vector<Key> keys;
+};
+
+// Reproducible per scene benchmark. Disabled (every call is a cheap no-op) unless --benchmark is given.
+// When enabled the scene runs warm-up plus measured frames on a fixed time step, the camera follows the
+// scripted path and the report has frame time percentiles, CPU time per stage, GPU time per frame and
+// the draw calls and state changes counted in FrameCounters. Usual loop:
+//   benchmark.BeginFrame();
+//   benchmark.BeginStage(FRAME_STAGE_UPDATE); ...; benchmark.EndStage(FRAME_STAGE_UPDATE);
+//   ...
+//   context.SwapBuffers();
+//   benchmark.EndFrame();
+// Stages may be timed on other threads (the update thread of a pipelined scene); they are added to the
+// frame that is being rendered when they finish. GPU time is the "Frame" scope of the GpuTimer given to
+// SetGpuTimer, which must begin a frame for every benchmark frame; without one the report has none.
+class FrameBenchmark
+{
+public:
+	FrameBenchmark(const std::string &scene, const FrameBenchmarkOptions &options) : scene(scene), options(options), frame(0), gpuTimer(nullptr)
+	{
+		for (GLuint i = 0; i < FRAME_STAGE_COUNT; i++)
+		{
+			this->stageNanoseconds[i] = 0;
+		}
+	}
+
+	bool IsEnabled() const
+	{
+		return this->options.enabled;
+	}
+
+	GLuint GetTotalFrames() const
+	{
+		return this->options.warmupFrames + this->options.measuredFrames;
+	}
+
+	// A headless run renders exactly the benchmark frames
+	void Configure(RenderContextOptions &contextOptions) const
+	{
+		if (this->options.enabled)
+		{
+			contextOptions.frames = this->GetTotalFrames();
+		}
+	}
+
+	// Scene time: the scripted clock while benchmarking, otherwise realTime unchanged
+	GLfloat GetTime(GLfloat realTime) const
+	{
+		return this->options.enabled ? this->frame * FRAME_BENCHMARK_STEP : realTime;
+	}
+
+	CameraPath &GetCameraPath()
+	{
+		return this->path;
+	}
+
+	// Scene view: the path's at the given scene time while benchmarking, otherwise view unchanged.
+	// For scenes without a Camera.
+	glm::mat4 GetViewMatrix(const glm::mat4 &view, GLfloat time) const
+	{
+		return this->options.enabled && !this->path.IsEmpty() ? this->path.GetViewMatrix(time) : view;
+	}
+
+	// Records the time of the timer's "Frame" scope as the GPU time of each measured frame
+	void SetGpuTimer(GpuTimer &timer)
+	{
+		if (!this->options.enabled)
+		{
+			return;
+		}
+
+		this->gpuTimer = &timer;
+		this->gpuTimer->SetFrameHandler([this](GLuint frame, double milliseconds)
+		{
+			if (this->isMeasured(frame))
+			{
+				this->gpuTimes.push_back(milliseconds);
+			}
+		});
+	}
+
+	// Places the camera on the path at the given scene time; does nothing unless benchmarking
+	void UpdateCamera(Camera &camera, GLfloat time) const
+	{
+		if (!this->options.enabled || this->path.IsEmpty())
+		{
+			return;
+		}
+
+		glm::vec3 position = camera.GetPosition();
+		GLfloat yaw = YAW, pitch = PITCH;
+		this->path.Evaluate(time, position, yaw, pitch);
+		camera.SetPose(position, yaw, pitch);
+	}
+
+	// True once every frame ran, the scene loop should stop
+	bool IsFinished() const
+	{
+		return this->options.enabled && this->frame >= this->GetTotalFrames();
+	}
+
+	void BeginFrame()
+	{
+		if (!this->options.enabled)
+		{
+			return;
+		}
+
+		GetFrameCounters() = FrameCounters();
+		this->frameStart = std::chrono::steady_clock::now();
+	}
+
+	void BeginStage(FrameStage stage)
+	{
+		if (this->options.enabled)
+		{
+			stageStart()[stage] = std::chrono::steady_clock::now();
+		}
+	}
+
+	void EndStage(FrameStage stage)
+	{
+		if (this->options.enabled)
+		{
+			this->stageNanoseconds[stage] += (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - stageStart()[stage]).count();
+		}
+	}
+
+	// Call after swapping buffers
+	void EndFrame()
+	{
+		if (!this->options.enabled)
+		{
+			return;
+		}
+
+		double frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->frameStart).count();
+
+		for (GLuint i = 0; i < FRAME_STAGE_COUNT; i++)
+		{
+			double stageTime = this->stageNanoseconds[i].exchange(0) / 1.0e6;
+
+			if (this->isMeasured(this->frame))
+			{
+				this->stageTimes[i].push_back(stageTime);
+			}
+		}
+
+		if (this->isMeasured(this->frame))
+		{
+			this->frameTimes.push_back(frameTime);
+			this->drawCalls.push_back(GetFrameCounters().drawCalls);
+			this->stateChanges.push_back(GetFrameCounters().stateChanges);
+			this->uniformCalls.push_back(GetFrameCounters().uniformCalls);
+			this->bytesUploaded.push_back((double)GetFrameCounters().bytesUploaded);
+		}
+
+		this->frame++;
+
+		if (this->IsFinished())
+		{
+			this->report();
+		}
+	}
+
+private:
+	std::string scene;
+	FrameBenchmarkOptions options;
+	CameraPath path;
+	std::atomic<GLuint> frame;	// Read by GetTime from other threads
+	std::chrono::steady_clock::time_point frameStart;
+	std::atomic<long long> stageNanoseconds[FRAME_STAGE_COUNT];
+
+	/*  Results of the measured frames, milliseconds  */
+	std::vector<double> frameTimes, gpuTimes;
+	std::vector<double> stageTimes[FRAME_STAGE_COUNT];
+	std::vector<double> drawCalls, stateChanges, uniformCalls, bytesUploaded;
+
+	GpuTimer *gpuTimer;	// Source of gpuTimes, null without one
+
+	static std::chrono::steady_clock::time_point *stageStart()
+	{
+		static thread_local std::chrono::steady_clock::time_point start[FRAME_STAGE_COUNT];
+		return start;
+	}
+
+	bool isMeasured(GLuint frame) const
+	{
+		return frame >= this->options.warmupFrames;
+	}
+
+	// Nearest rank percentile of sorted values
+	static double percentile(const std::vector<double> &sorted, double p)
+	{
+		if (sorted.empty())
+		{
+			return 0.0;
+		}
+
+		size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+
+		return sorted[std::min(sorted.size(), std::max((size_t)1, rank)) - 1];
+	}
+
+	static void writeSummary(std::ostream &out, std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+
+		double sum = 0.0;
+
+		for (GLuint i = 0; i < values.size(); i++)
+		{
+			sum += values[i];
+		}
+
+		out << "{ \"mean\": " << (values.empty() ? 0.0 : sum / values.size())
+			<< ", \"p50\": " << percentile(values, 50.0)
+			<< ", \"p95\": " << percentile(values, 95.0)
+			<< ", \"p99\": " << percentile(values, 99.0)
+			<< ", \"max\": " << (values.empty() ? 0.0 : values.back()) << " }";
+	}
+
+	void report()
+	{
+		// The last frame ran: collect the GPU times still in flight
+		bool gpuTimed = this->gpuTimer && this->gpuTimer->IsTiming();
+
+		if (gpuTimed)
+		{
+			this->gpuTimer->Finish();
+		}
+
+		const char *stageNames[FRAME_STAGE_COUNT] = { "update", "cull", "submit" };
+		std::ofstream file;
+		bool toStdout = this->options.outputPath == "-";
+
+		if (!toStdout)
+		{
+			file.open(this->options.outputPath.c_str());
+
+			if (!file)
+			{
+				std::cout << "ERROR::FRAME_BENCHMARK::CANNOT_WRITE " << this->options.outputPath << std::endl;
+				return;
+			}
+		}
+
+		std::ostream &out = toStdout ? std::cout : file;
+
+		out << "{\n";
+		out << "  \"scene\": \"" << this->scene << "\",\n";
+		out << "  \"warmupFrames\": " << this->options.warmupFrames << ",\n";
+		out << "  \"measuredFrames\": " << this->frameTimes.size() << ",\n";
+		out << "  \"frameTimeMs\": ";
+		writeSummary(out, this->frameTimes);
+		out << ",\n  \"cpuStageMs\": {\n";
+
+		for (GLuint i = 0; i < FRAME_STAGE_COUNT; i++)
+		{
+			out << "    \"" << stageNames[i] << "\": ";
+			writeSummary(out, this->stageTimes[i]);
+			out << (i + 1 < FRAME_STAGE_COUNT ? ",\n" : "\n");
+		}
+
+		out << "  },\n  \"gpuTimeMs\": ";
+
+		if (gpuTimed)
+		{
+			writeSummary(out, this->gpuTimes);
+			out << ",\n  \"gpuFramesDropped\": " << this->gpuTimer->GetDroppedFrames();
+		}
+		else
+		{
+			out << "null";
+		}
+
+		out << ",\n  \"drawCallsPerFrame\": ";
+		writeSummary(out, this->drawCalls);
+		out << ",\n  \"stateChangesPerFrame\": ";
+		writeSummary(out, this->stateChanges);
+		out << ",\n  \"uniformCallsPerFrame\": ";
+		writeSummary(out, this->uniformCalls);
+		out << ",\n  \"bytesUploadedPerFrame\": ";
+		writeSummary(out, this->bytesUploaded);
+		out << "\n}" << std::endl;
+	}
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+// GL Includes
+#include <GL/glew.h>
+
+// GL work issued during the current frame. The GLStats.h wrappers add to it on every call they intercept;
+// FrameBenchmark and GLStats clear it when a frame begins and read it when it ends.
+// Only touched from the thread that owns the GL context.
+struct FrameCounters
+{
+	GLuint drawCalls = 0;
+	GLuint stateChanges = 0;	// Program, vertex array, buffer and texture binds, enables and blend state
+	GLuint uniformCalls = 0;	// glUniform*
+	GLuint uniformLookups = 0;	// glGetUniformLocation
+	unsigned long long bytesUploaded = 0;	// Buffer and texture data sent with glBufferData, glBufferSubData and glTexImage2D/glCompressedTexImage2D
+};
+
+inline FrameCounters &GetFrameCounters()
+{
+	static FrameCounters counters;
+	return counters;
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+// Std. Includes
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+// GL Includes
+#include <GL/glew.h>
+
+// Snapshots in flight: one being rendered and one being built
+const GLuint FRAME_PIPELINE_BUFFERS = 2;
+
+// Seconds on the clock the pipeline measures latency with, for stamping input samples
+inline double FramePipelineTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Filled by FramePipeline::GetStats
+struct FramePipelineStats
+{
+	GLuint frames = 0;
+	double averageLatency = 0.0;	// Input sample to the end of the frame that showed it
+	double maxLatency = 0.0;
+	double updateWaitSeconds = 0.0;	// Time the update thread was blocked because render was behind
+	double renderWaitSeconds = 0.0;	// Time the render thread was blocked waiting for a snapshot
+};
+
+// Two thread frame loop: the update thread simulates frame N + 1 into one snapshot while the render
+// thread draws frame N from the other. A snapshot is only written between BeginUpdate/EndUpdate and only
+// read between BeginRender/EndRender, so the renderer always sees a complete, immutable frame.
+// With two buffers the update thread can be at most one frame ahead; it blocks instead of queueing
+// more, which bounds the latency the pipeline adds.
+// Snapshot must be default constructible; the update side overwrites it completely every frame.
+template <typename Snapshot>
+class FramePipeline
+{
+public:
+	FramePipeline() : published(0), stopping(false), latencySum(0.0)
+	{
+		for (GLuint i = 0; i < FRAME_PIPELINE_BUFFERS; i++)
+		{
+			this->slots[i].state = SLOT_FREE;
+			this->slots[i].frame = 0;
+			this->slots[i].inputTime = 0.0;
+		}
+	}
+
+	// Update thread: a free snapshot to fill, or nullptr once the pipeline is stopped
+	Snapshot *BeginUpdate()
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		double start = FramePipelineTime();
+
+		this->changed.wait(lock, [this] { return this->stopping || this->findSlot(SLOT_FREE) >= 0; });
+		this->stats.updateWaitSeconds += FramePipelineTime() - start;
+
+		if (this->stopping)
+		{
+			return nullptr;
+		}
+
+		Slot &slot = this->slots[this->findSlot(SLOT_FREE)];
+		slot.state = SLOT_WRITING;
+
+		return &slot.snapshot;
+	}
+
+	// Update thread: publishes the snapshot. inputTime is when the input it used was sampled (FramePipelineTime).
+	void EndUpdate(double inputTime)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			Slot &slot = this->slots[this->findSlot(SLOT_WRITING)];
+			slot.state = SLOT_READY;
+			slot.frame = ++this->published;
+			slot.inputTime = inputTime;
+		}
+
+		this->changed.notify_all();
+	}
+
+	// Render thread: the oldest published snapshot, or nullptr once the pipeline is stopped
+	const Snapshot *BeginRender()
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		double start = FramePipelineTime();
+
+		this->changed.wait(lock, [this] { return this->stopping || this->findSlot(SLOT_READY) >= 0; });
+		this->stats.renderWaitSeconds += FramePipelineTime() - start;
+
+		if (this->stopping)
+		{
+			return nullptr;
+		}
+
+		Slot &slot = this->slots[this->findSlot(SLOT_READY)];
+		slot.state = SLOT_READING;
+
+		return &slot.snapshot;
+	}
+
+	// Render thread: call after the frame was submitted (after swapping buffers). Records the latency
+	// and hands the snapshot back to the update thread.
+	void EndRender()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			Slot &slot = this->slots[this->findSlot(SLOT_READING)];
+			double latency = FramePipelineTime() - slot.inputTime;
+
+			this->stats.frames++;
+			this->latencySum += latency;
+			this->stats.maxLatency = std::max(this->stats.maxLatency, latency);
+			slot.state = SLOT_FREE;
+		}
+
+		this->changed.notify_all();
+	}
+
+	// Wakes both threads; every Begin call returns nullptr from now on
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+
+		this->changed.notify_all();
+	}
+
+	FramePipelineStats GetStats()
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		FramePipelineStats result = this->stats;
+		result.averageLatency = result.frames ? this->latencySum / result.frames : 0.0;
+
+		return result;
+	}
+
+private:
+	enum SlotState
+	{
+		SLOT_FREE,
+		SLOT_WRITING,
+		SLOT_READY,
+		SLOT_READING
+	};
+
+	struct Slot
+	{
+		Snapshot snapshot;
+		SlotState state;
+		unsigned long long frame;
+		double inputTime;
+	};
+
+	Slot slots[FRAME_PIPELINE_BUFFERS];
+	unsigned long long published;
+	bool stopping;
+	std::mutex mutex;
+	std::condition_variable changed;
+	FramePipelineStats stats;
+	double latencySum;
+
+	// Slot in the given state; for ready slots the oldest frame, so frames are drawn in order
+	GLint findSlot(SlotState state) const
+	{
+		GLint found = -1;
+
+		for (GLuint i = 0; i < FRAME_PIPELINE_BUFFERS; i++)
+		{
+			if (this->slots[i].state == state && (found < 0 || this->slots[i].frame < this->slots[found].frame))
+			{
+				found = (GLint)i;
+			}
+		}
+
+		return found;
+	}
+};
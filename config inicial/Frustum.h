@@ -0,0 +1,73 @@
+#pragma once
+
+// GL Includes
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// View frustum described by its six planes (ax + by + cz + d >= 0 means inside).
+// When built from projection * view * model the planes live in the model's object space,
+// which lets meshes test their local bounds without transforming them first.
+class Frustum
+{
+public:
+	enum Plane
+	{
+		LEFT_PLANE = 0,
+		RIGHT_PLANE,
+		BOTTOM_PLANE,
+		TOP_PLANE,
+		NEAR_PLANE,
+		FAR_PLANE,
+		PLANE_COUNT
+	};
+
+	glm::vec4 planes[PLANE_COUNT];
+
+	Frustum()
+	{
+	}
+
+	// Extracts the planes from a clip matrix (Gribb/Hartmann). GLM matrices are column major, so m[c][r].
+	explicit Frustum(const glm::mat4 &clip)
+	{
+		glm::vec4 row0(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+		glm::vec4 row1(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+		glm::vec4 row2(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+		glm::vec4 row3(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+		this->planes[LEFT_PLANE] = row3 + row0;
+		this->planes[RIGHT_PLANE] = row3 - row0;
+		this->planes[BOTTOM_PLANE] = row3 + row1;
+		this->planes[TOP_PLANE] = row3 - row1;
+		this->planes[NEAR_PLANE] = row3 + row2;
+		this->planes[FAR_PLANE] = row3 - row2;
+
+		// Normalize so the plane equation returns real distances, required for sphere tests
+		for (GLuint i = 0; i < PLANE_COUNT; i++)
+		{
+			GLfloat length = glm::length(glm::vec3(this->planes[i]));
+
+			if (length > 0.0f)
+			{
+				this->planes[i] = this->planes[i] * (1.0f / length);
+			}
+		}
+	}
+
+	// Returns false only when the sphere is completely outside one of the planes
+	bool IsSphereVisible(const glm::vec3 &center, GLfloat radius) const
+	{
+		for (GLuint i = 0; i < PLANE_COUNT; i++)
+		{
+			const glm::vec4 &p = this->planes[i];
+
+			if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
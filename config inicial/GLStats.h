@@ -0,0 +1,442 @@
+#pragma once
+
+// Std. Includes
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include "FrameCounters.h"
+
+// Command line switch, added to the RenderContext ones:
+//   --glstats  print the scene's GL call and upload totals when it closes
+struct GLStatsOptions
+{
+	bool report = false;
+};
+
+inline GLStatsOptions ParseGLStatsOptions(int argc, char **argv)
+{
+	GLStatsOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--glstats"))
+		{
+			options.report = true;
+		}
+	}
+
+	return options;
+}
+
+// Bytes per pixel of client pixel data, for the common formats and types
+inline GLuint GLStatsPixelSize(GLenum format, GLenum type)
+{
+	GLuint components = 4;
+
+	switch (format)
+	{
+	case GL_RED: case GL_GREEN: case GL_BLUE: case GL_ALPHA: case GL_LUMINANCE: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+		components = 1;
+		break;
+	case GL_RG: case GL_LUMINANCE_ALPHA: case GL_DEPTH_STENCIL:
+		components = 2;
+		break;
+	case GL_RGB: case GL_BGR:
+		components = 3;
+		break;
+	}
+
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE: case GL_BYTE:
+		return components;
+	case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+		return 2 * components;
+	case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+		return 4 * components;
+	case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+		return 2;
+	default:	// Packed 32 bit types
+		return 4;
+	}
+}
+
+// Pixel unpack buffer bound through the wrappers. While there is one, glTexImage2D reads from it and its
+// pixels argument is an offset: those bytes are counted when they are written into the buffer instead.
+inline GLuint &GLStatsUnpackBuffer()
+{
+	static GLuint buffer = 0;
+	return buffer;
+}
+
+// Wrappers around the GL entry points the scenes use. They are defined before the macros below, so the
+// calls inside them still reach GLEW's functions; everything included after this header goes through
+// them and adds to GetFrameCounters().
+inline void GLStatsDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	GetFrameCounters().drawCalls++;
+	glDrawArrays(mode, first, count);
+}
+
+inline void GLStatsDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices)
+{
+	GetFrameCounters().drawCalls++;
+	glDrawElements(mode, count, type, indices);
+}
+
+inline void GLStatsDrawElementsIndirect(GLenum mode, GLenum type, const GLvoid *indirect)
+{
+	GetFrameCounters().drawCalls++;
+	glDrawElementsIndirect(mode, type, indirect);
+}
+
+inline void GLStatsDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices, GLsizei instanceCount, GLint baseVertex)
+{
+	GetFrameCounters().drawCalls++;
+	glDrawElementsInstancedBaseVertex(mode, count, type, indices, instanceCount, baseVertex);
+}
+
+// The const-ness of the multi draw arrays changed between GLEW versions, these forward whatever they get
+template <typename... Arguments>
+inline void GLStatsMultiDrawElements(Arguments... arguments)
+{
+	GetFrameCounters().drawCalls++;
+	glMultiDrawElements(arguments...);
+}
+
+template <typename... Arguments>
+inline void GLStatsMultiDrawElementsBaseVertex(Arguments... arguments)
+{
+	GetFrameCounters().drawCalls++;
+	glMultiDrawElementsBaseVertex(arguments...);
+}
+
+inline void GLStatsMultiDrawElementsIndirect(GLenum mode, GLenum type, const GLvoid *indirect, GLsizei drawCount, GLsizei stride)
+{
+	GetFrameCounters().drawCalls++;
+	glMultiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+}
+
+inline void GLStatsUseProgram(GLuint program)
+{
+	GetFrameCounters().stateChanges++;
+	glUseProgram(program);
+}
+
+inline void GLStatsBindVertexArray(GLuint array)
+{
+	GetFrameCounters().stateChanges++;
+	glBindVertexArray(array);
+}
+
+inline void GLStatsBindBuffer(GLenum target, GLuint buffer)
+{
+	GetFrameCounters().stateChanges++;
+
+	if (GL_PIXEL_UNPACK_BUFFER == target)
+	{
+		GLStatsUnpackBuffer() = buffer;
+	}
+
+	glBindBuffer(target, buffer);
+}
+
+inline void GLStatsBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	GetFrameCounters().stateChanges++;
+	glBindBufferBase(target, index, buffer);
+}
+
+inline void GLStatsBindTexture(GLenum target, GLuint texture)
+{
+	GetFrameCounters().stateChanges++;
+	glBindTexture(target, texture);
+}
+
+inline void GLStatsActiveTexture(GLenum texture)
+{
+	GetFrameCounters().stateChanges++;
+	glActiveTexture(texture);
+}
+
+inline void GLStatsEnable(GLenum capability)
+{
+	GetFrameCounters().stateChanges++;
+	glEnable(capability);
+}
+
+inline void GLStatsDisable(GLenum capability)
+{
+	GetFrameCounters().stateChanges++;
+	glDisable(capability);
+}
+
+inline void GLStatsBlendFunc(GLenum source, GLenum destination)
+{
+	GetFrameCounters().stateChanges++;
+	glBlendFunc(source, destination);
+}
+
+inline GLint GLStatsGetUniformLocation(GLuint program, const GLchar *name)
+{
+	GetFrameCounters().uniformLookups++;
+	return glGetUniformLocation(program, name);
+}
+
+inline void GLStatsUniform1i(GLint location, GLint v0)
+{
+	GetFrameCounters().uniformCalls++;
+	glUniform1i(location, v0);
+}
+
+inline void GLStatsUniform1f(GLint location, GLfloat v0)
+{
+	GetFrameCounters().uniformCalls++;
+	glUniform1f(location, v0);
+}
+
+inline void GLStatsUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+	GetFrameCounters().uniformCalls++;
+	glUniform3f(location, v0, v1, v2);
+}
+
+inline void GLStatsUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+	GetFrameCounters().uniformCalls++;
+	glUniform4f(location, v0, v1, v2, v3);
+}
+
+inline void GLStatsUniform3fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	GetFrameCounters().uniformCalls++;
+	glUniform3fv(location, count, value);
+}
+
+inline void GLStatsUniform4fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	GetFrameCounters().uniformCalls++;
+	glUniform4fv(location, count, value);
+}
+
+inline void GLStatsUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	GetFrameCounters().uniformCalls++;
+	glUniformMatrix4fv(location, count, transpose, value);
+}
+
+inline void GLStatsBufferData(GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage)
+{
+	// Without data it only allocates, nothing crosses the bus
+	if (data)
+	{
+		GetFrameCounters().bytesUploaded += (unsigned long long)size;
+	}
+
+	glBufferData(target, size, data, usage);
+}
+
+inline void GLStatsBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data)
+{
+	GetFrameCounters().bytesUploaded += (unsigned long long)size;
+	glBufferSubData(target, offset, size, data);
+}
+
+inline void GLStatsTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels)
+{
+	if (pixels && !GLStatsUnpackBuffer())
+	{
+		GetFrameCounters().bytesUploaded += (unsigned long long)width * height * GLStatsPixelSize(format, type);
+	}
+
+	glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+}
+
+inline void GLStatsCompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid *data)
+{
+	if (data && !GLStatsUnpackBuffer())
+	{
+		GetFrameCounters().bytesUploaded += (unsigned long long)imageSize;
+	}
+
+	glCompressedTexImage2D(target, level, internalFormat, width, height, border, imageSize, data);
+}
+
+// Release-lite builds define GL_STATS_DISABLED: the calls go straight to GL and the counters stay at zero
+#ifndef GL_STATS_DISABLED
+#undef glDrawArrays
+#define glDrawArrays GLStatsDrawArrays
+#undef glDrawElements
+#define glDrawElements GLStatsDrawElements
+#undef glDrawElementsIndirect
+#define glDrawElementsIndirect GLStatsDrawElementsIndirect
+#undef glDrawElementsInstancedBaseVertex
+#define glDrawElementsInstancedBaseVertex GLStatsDrawElementsInstancedBaseVertex
+#undef glMultiDrawElements
+#define glMultiDrawElements GLStatsMultiDrawElements
+#undef glMultiDrawElementsBaseVertex
+#define glMultiDrawElementsBaseVertex GLStatsMultiDrawElementsBaseVertex
+#undef glMultiDrawElementsIndirect
+#define glMultiDrawElementsIndirect GLStatsMultiDrawElementsIndirect
+#undef glUseProgram
+#define glUseProgram GLStatsUseProgram
+#undef glBindVertexArray
+#define glBindVertexArray GLStatsBindVertexArray
+#undef glBindBuffer
+#define glBindBuffer GLStatsBindBuffer
+#undef glBindBufferBase
+#define glBindBufferBase GLStatsBindBufferBase
+#undef glBindTexture
+#define glBindTexture GLStatsBindTexture
+#undef glActiveTexture
+#define glActiveTexture GLStatsActiveTexture
+#undef glEnable
+#define glEnable GLStatsEnable
+#undef glDisable
+#define glDisable GLStatsDisable
+#undef glBlendFunc
+#define glBlendFunc GLStatsBlendFunc
+#undef glGetUniformLocation
+#define glGetUniformLocation GLStatsGetUniformLocation
+#undef glUniform1i
+#define glUniform1i GLStatsUniform1i
+#undef glUniform1f
+#define glUniform1f GLStatsUniform1f
+#undef glUniform3f
+#define glUniform3f GLStatsUniform3f
+#undef glUniform4f
+#define glUniform4f GLStatsUniform4f
+#undef glUniform3fv
+#define glUniform3fv GLStatsUniform3fv
+#undef glUniform4fv
+#define glUniform4fv GLStatsUniform4fv
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv GLStatsUniformMatrix4fv
+#undef glBufferData
+#define glBufferData GLStatsBufferData
+#undef glBufferSubData
+#define glBufferSubData GLStatsBufferSubData
+#undef glTexImage2D
+#define glTexImage2D GLStatsTexImage2D
+#undef glCompressedTexImage2D
+#define glCompressedTexImage2D GLStatsCompressedTexImage2D
+#endif
+
+// Per scene totals of the frame counters, and the budget a frame should stay within. A zero budget
+// field means no limit. BeginFrame clears the counters and EndFrame keeps them, so call them around
+// the frame's GL work like FrameBenchmark's.
+class GLStats
+{
+public:
+	GLStats(const std::string &scene) : scene(scene), frames(0), framesOverBudget(0)
+	{
+	}
+
+	void SetBudget(const FrameCounters &budget)
+	{
+		this->budget = budget;
+	}
+
+	void BeginFrame()
+	{
+		GetFrameCounters() = FrameCounters();
+	}
+
+	void EndFrame()
+	{
+		const FrameCounters &counters = GetFrameCounters();
+
+		this->last = counters;
+		this->total.drawCalls += counters.drawCalls;
+		this->total.stateChanges += counters.stateChanges;
+		this->total.uniformCalls += counters.uniformCalls;
+		this->total.uniformLookups += counters.uniformLookups;
+		this->total.bytesUploaded += counters.bytesUploaded;
+		this->peak.drawCalls = std::max(this->peak.drawCalls, counters.drawCalls);
+		this->peak.stateChanges = std::max(this->peak.stateChanges, counters.stateChanges);
+		this->peak.uniformCalls = std::max(this->peak.uniformCalls, counters.uniformCalls);
+		this->peak.uniformLookups = std::max(this->peak.uniformLookups, counters.uniformLookups);
+		this->peak.bytesUploaded = std::max(this->peak.bytesUploaded, counters.bytesUploaded);
+
+		if (this->isOverBudget(counters))
+		{
+			// Only the first one is printed, Report gives how many there were
+			if (0 == this->framesOverBudget)
+			{
+				std::cout << "ERROR::GL_STATS::OVER_BUDGET " << this->scene << " frame " << this->frames << ": ";
+				writeCounters(std::cout, counters);
+				std::cout << std::endl;
+			}
+
+			this->framesOverBudget++;
+		}
+
+		this->frames++;
+	}
+
+	// Counters of the last finished frame
+	const FrameCounters &GetLastFrame() const
+	{
+		return this->last;
+	}
+
+	GLuint GetFrameCount() const
+	{
+		return this->frames;
+	}
+
+	// Mean and peak per frame, and the frames over budget
+	void Report(std::ostream &out) const
+	{
+		GLuint frames = std::max(1u, this->frames);
+
+		out << "GL stats " << this->scene << ", " << this->frames << " frames" << std::endl;
+		out << "  mean:  draws " << (double)this->total.drawCalls / frames
+			<< "  state " << (double)this->total.stateChanges / frames
+			<< "  uniforms " << (double)this->total.uniformCalls / frames
+			<< "  lookups " << (double)this->total.uniformLookups / frames
+			<< "  uploaded " << (double)this->total.bytesUploaded / frames << " B" << std::endl;
+		out << "  peak:  ";
+		writeCounters(out, this->peak);
+		out << std::endl;
+		out << "  last:  ";
+		writeCounters(out, this->last);
+		out << std::endl;
+		out << "  frames over budget: " << this->framesOverBudget << std::endl;
+	}
+
+private:
+	// Same fields as FrameCounters, wide enough for a whole run
+	struct Totals
+	{
+		unsigned long long drawCalls = 0, stateChanges = 0, uniformCalls = 0, uniformLookups = 0, bytesUploaded = 0;
+	};
+
+	std::string scene;
+	FrameCounters budget, last, peak;
+	Totals total;
+	GLuint frames, framesOverBudget;
+
+	bool isOverBudget(const FrameCounters &counters) const
+	{
+		return (this->budget.drawCalls && counters.drawCalls > this->budget.drawCalls)
+			|| (this->budget.stateChanges && counters.stateChanges > this->budget.stateChanges)
+			|| (this->budget.uniformCalls && counters.uniformCalls > this->budget.uniformCalls)
+			|| (this->budget.uniformLookups && counters.uniformLookups > this->budget.uniformLookups)
+			|| (this->budget.bytesUploaded && counters.bytesUploaded > this->budget.bytesUploaded);
+	}
+
+	static void writeCounters(std::ostream &out, const FrameCounters &counters)
+	{
+		out << "draws " << counters.drawCalls
+			<< "  state " << counters.stateChanges
+			<< "  uniforms " << counters.uniformCalls
+			<< "  lookups " << counters.uniformLookups
+			<< "  uploaded " << counters.bytesUploaded << " B";
+	}
+};
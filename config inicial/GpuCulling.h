@@ -0,0 +1,391 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "Frustum.h"
+#include "BatchRenderer.h"
+
+using namespace std;
+
+// Varyings written by Shader/cull.gs, pass them to the transform feedback Shader constructor
+const GLchar *const GPU_CULLING_VARYINGS[] = { "culledColumn0", "culledColumn1", "culledColumn2", "culledColumn3" };
+const GLsizei GPU_CULLING_VARYING_COUNT = 4;
+
+// Culling passes in flight, each with its own output buffer and query. Visible counts are read back once
+// the GPU finished the pass, a frame or two later, so reading them never waits.
+const GLuint GPU_CULLING_FRAMES = 3;
+
+// Frustum culls thousands of copies of one model on the GPU. Every instance goes through Shader/cull.vs
+// as a point, the geometry shader only emits the visible ones and transform feedback packs their model
+// matrices into a buffer that the instanced draw (Shader/batched.vs) reads directly. The CPU only
+// uploads the transforms, it never looks at them one by one.
+// The visible count reaches the draw through a query: with GL 4.4 / ARB_query_buffer_object it is
+// written into the indirect commands on the GPU and the draw uses this frame's pass. Otherwise the draw
+// uses the newest pass the GPU has finished, its matrices with its count, up to GPU_CULLING_FRAMES - 1
+// frames behind the camera; instances at the screen's edges pop in that much later.
+class GpuCuller
+{
+public:
+	// Must be constructed once GLEW has been initialized. The model must outlive the culler.
+	GpuCuller(Model &model, GLuint maxInstances) : model(model), maxInstances(maxInstances), instanceCount(0), visibleCount(0), passesIssued(0), passesRead(0), drawPass(-1)
+	{
+		this->useQueryBuffer = (GLEW_ARB_query_buffer_object || GLEW_VERSION_4_4) ? true : false;
+		this->useIndirect = (GLEW_ARB_multi_draw_indirect || GLEW_VERSION_4_3) ? true : false;
+
+		this->computeBounds();
+		this->setupBuffers();
+	}
+
+	// Destroy() must have run while the context was current
+	~GpuCuller()
+	{
+		this->Destroy();
+	}
+
+	// Frees the buffers, vertex arrays and queries. On the context's thread, before the context is destroyed.
+	void Destroy()
+	{
+		if (!this->cullVAO)
+		{
+			return;
+		}
+
+		glDeleteVertexArrays(1, &this->cullVAO);
+		glDeleteBuffers(1, &this->instanceVBO);
+		glDeleteBuffers(1, &this->VBO);
+		glDeleteBuffers(1, &this->EBO);
+		glDeleteBuffers(1, &this->indirectBuffer);
+
+		for (GLuint i = 0; i < GPU_CULLING_FRAMES; i++)
+		{
+			glDeleteVertexArrays(1, &this->passes[i].drawVAO);
+			glDeleteBuffers(1, &this->passes[i].culledVBO);
+			glDeleteQueries(1, &this->passes[i].query);
+		}
+
+		this->cullVAO = 0;
+		GetMemoryTracker().Set(MEMORY_RENDERER, "GpuCuller", 0, 0);
+	}
+
+	// Replaces the instance transforms, extra instances past maxInstances are ignored
+	void SetInstances(const glm::mat4 *transforms, GLuint count)
+	{
+		this->instanceCount = glm::min(count, this->maxInstances);
+
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, this->instanceCount * sizeof(glm::mat4), transforms);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Runs the culling pass. cullShader must be built from Shader/cull.vs, Shader/cull.gs and GPU_CULLING_VARYINGS.
+	void Cull(const Shader &cullShader, const glm::mat4 &viewProjection)
+	{
+		Frustum frustum(viewProjection);
+
+		// Counts the GPU already has, then make room: with the ring full, or the pass being drawn about to
+		// be rewritten, wait for the oldest pass left (only a GPU that many frames behind gets here)
+		this->readPasses();
+		GLuint index = this->passesIssued % GPU_CULLING_FRAMES;
+
+		while (this->passesRead < this->passesIssued && (this->passesIssued - this->passesRead == GPU_CULLING_FRAMES || (GLint)index == this->drawPass))
+		{
+			this->readPass(true);
+		}
+
+		CullPass &pass = this->passes[index];
+
+		glUseProgram(cullShader.Program);
+		glUniform4fv(glGetUniformLocation(cullShader.Program, "planes"), Frustum::PLANE_COUNT, &frustum.planes[0].x);
+		glUniform4f(glGetUniformLocation(cullShader.Program, "bounds"), this->boundsCenter.x, this->boundsCenter.y, this->boundsCenter.z, this->boundsRadius);
+
+		// Nothing is rasterized, the points only exist to be captured
+		glEnable(GL_RASTERIZER_DISCARD);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, pass.culledVBO);
+		glBindVertexArray(this->cullVAO);
+
+		glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, pass.query);
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArrays(GL_POINTS, 0, this->instanceCount);
+		glEndTransformFeedback();
+		glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+		this->passesIssued++;
+
+		glBindVertexArray(0);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+		glDisable(GL_RASTERIZER_DISCARD);
+
+		if (this->useQueryBuffer && this->useIndirect)
+		{
+			// Copy the count into every command's instanceCount without leaving the GPU
+			glBindBuffer(GL_QUERY_BUFFER, this->indirectBuffer);
+
+			for (GLuint i = 0; i < this->commands.size(); i++)
+			{
+				size_t offset = i * sizeof(DrawElementsIndirectCommand) + offsetof(DrawElementsIndirectCommand, instanceCount);
+				glGetQueryObjectuiv(pass.query, GL_QUERY_RESULT, (GLuint *)offset);
+			}
+
+			glBindBuffer(GL_QUERY_BUFFER, 0);
+		}
+	}
+
+	// Draws the instances that survived the last Cull call, or the newest one finished without query buffers.
+	// shader must read the instance matrix like Shader/batched.vs.
+	void Draw(const Shader &shader)
+	{
+		glUseProgram(shader.Program);
+
+		if (this->useQueryBuffer && this->useIndirect)
+		{
+			if (0 == this->passesIssued)
+			{
+				return;
+			}
+
+			glBindVertexArray(this->passes[(this->passesIssued - 1) % GPU_CULLING_FRAMES].drawVAO);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirectBuffer);
+
+			for (GLuint i = 0; i < this->commands.size(); i++)
+			{
+				const vector<Texture> &textures = this->model.GetMeshes()[i].textures;
+
+				BindMeshTextures(shader.Program, textures);
+				glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const GLvoid *)(i * sizeof(DrawElementsIndirectCommand)));
+				UnbindMeshTextures(textures);
+			}
+
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+		else if (this->drawPass >= 0 && this->passes[this->drawPass].visibleCount > 0)
+		{
+			const CullPass &pass = this->passes[this->drawPass];
+			glBindVertexArray(pass.drawVAO);
+
+			for (GLuint i = 0; i < this->commands.size(); i++)
+			{
+				const DrawElementsIndirectCommand &command = this->commands[i];
+				const vector<Texture> &textures = this->model.GetMeshes()[i].textures;
+
+				BindMeshTextures(shader.Program, textures);
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (const GLvoid *)(command.firstIndex * sizeof(GLuint)), pass.visibleCount, command.baseVertex);
+				UnbindMeshTextures(textures);
+			}
+		}
+
+		glBindVertexArray(0);
+	}
+
+	// Visible instances of the newest pass the GPU finished, up to GPU_CULLING_FRAMES - 1 Cull calls old
+	// (0 before the first one). Never waits for the GPU.
+	GLuint GetVisibleCount()
+	{
+		this->readPasses();
+
+		return this->visibleCount;
+	}
+
+	GLuint GetInstanceCount()
+	{
+		return this->instanceCount;
+	}
+
+private:
+	/*  Culling data  */
+	Model &model;
+	GLuint maxInstances;
+	GLuint instanceCount;
+	GLuint visibleCount;	// Of the newest pass read back
+	glm::vec3 boundsCenter;
+	GLfloat boundsRadius;
+	bool useQueryBuffer;
+	bool useIndirect;
+	vector<DrawElementsIndirectCommand> commands;
+
+	/*  Render data  */
+	// One culling pass: the matrices it kept, the VAO that draws them and the query that counts them
+	struct CullPass
+	{
+		GLuint culledVBO, drawVAO, query;
+		GLuint visibleCount;
+	};
+
+	GLuint cullVAO, instanceVBO, VBO, EBO, indirectBuffer;
+	CullPass passes[GPU_CULLING_FRAMES];
+	GLuint passesIssued, passesRead;	// Passes in [passesRead, passesIssued) haven't been read back
+	GLint drawPass;						// Newest pass read back, -1 before the first
+
+	/*  Functions    */
+	// Reads back every pass the GPU finished, oldest first
+	void readPasses()
+	{
+		while (this->passesRead < this->passesIssued && this->readPass(false))
+		{
+		}
+	}
+
+	// Reads back the oldest pass not read yet. False if the GPU isn't done with it and wait is false.
+	bool readPass(bool wait)
+	{
+		GLuint index = this->passesRead % GPU_CULLING_FRAMES;
+		CullPass &pass = this->passes[index];
+
+		if (!wait)
+		{
+			GLuint available = 0;
+			glGetQueryObjectuiv(pass.query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+			if (!available)
+			{
+				return false;
+			}
+		}
+
+		glGetQueryObjectuiv(pass.query, GL_QUERY_RESULT, &pass.visibleCount);
+		this->visibleCount = pass.visibleCount;
+		this->drawPass = (GLint)index;
+		this->passesRead++;
+
+		return true;
+	}
+
+	// Bounding sphere of the whole model in object space
+	void computeBounds()
+	{
+		vector<Mesh> &meshes = this->model.GetMeshes();
+		bool first = true;
+		glm::vec3 minCorner(0.0f), maxCorner(0.0f);
+
+		for (GLuint i = 0; i < meshes.size(); i++)
+		{
+			for (GLuint j = 0; j < meshes[i].vertices.size(); j++)
+			{
+				const glm::vec3 &p = meshes[i].vertices[j].Position;
+				minCorner = first ? p : glm::min(minCorner, p);
+				maxCorner = first ? p : glm::max(maxCorner, p);
+				first = false;
+			}
+		}
+
+		this->boundsCenter = (minCorner + maxCorner) * 0.5f;
+		this->boundsRadius = 0.0f;
+
+		for (GLuint i = 0; i < meshes.size(); i++)
+		{
+			for (GLuint j = 0; j < meshes[i].vertices.size(); j++)
+			{
+				this->boundsRadius = glm::max(this->boundsRadius, glm::distance(this->boundsCenter, meshes[i].vertices[j].Position));
+			}
+		}
+	}
+
+	void setupBuffers()
+	{
+		vector<Mesh> &meshes = this->model.GetMeshes();
+		vector<Vertex> vertices;
+		vector<GLuint> indices;
+
+		// All the meshes in one buffer pair, one command per mesh
+		for (GLuint i = 0; i < meshes.size(); i++)
+		{
+			DrawElementsIndirectCommand command;
+
+			command.count = (GLuint)meshes[i].indices.size();
+			command.instanceCount = 0;
+			command.firstIndex = (GLuint)indices.size();
+			command.baseVertex = (GLint)vertices.size();
+			command.baseInstance = 0;
+			this->commands.push_back(command);
+
+			vertices.insert(vertices.end(), meshes[i].vertices.begin(), meshes[i].vertices.end());
+			indices.insert(indices.end(), meshes[i].indices.begin(), meshes[i].indices.end());
+		}
+
+		glGenVertexArrays(1, &this->cullVAO);
+		glGenBuffers(1, &this->instanceVBO);
+		glGenBuffers(1, &this->VBO);
+		glGenBuffers(1, &this->EBO);
+		glGenBuffers(1, &this->indirectBuffer);
+
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, this->maxInstances * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+
+		for (GLuint i = 0; i < GPU_CULLING_FRAMES; i++)
+		{
+			CullPass &pass = this->passes[i];
+			pass.visibleCount = 0;
+
+			glGenVertexArrays(1, &pass.drawVAO);
+			glGenBuffers(1, &pass.culledVBO);
+			glGenQueries(1, &pass.query);
+
+			glBindBuffer(GL_ARRAY_BUFFER, pass.culledVBO);
+			glBufferData(GL_ARRAY_BUFFER, this->maxInstances * sizeof(glm::mat4), NULL, GL_DYNAMIC_COPY);
+		}
+
+		if (!this->commands.empty())
+		{
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirectBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, this->commands.size() * sizeof(DrawElementsIndirectCommand), &this->commands[0], GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+
+		// Culling pass: one point per instance, the matrix at locations 0 to 3
+		glBindVertexArray(this->cullVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+
+		for (GLuint i = 0; i < 4; i++)
+		{
+			glEnableVertexAttribArray(i);
+			glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (GLvoid *)(i * sizeof(glm::vec4)));
+		}
+
+		if (!vertices.empty() && !indices.empty())
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+		}
+
+		// Drawing, one VAO per pass: the model geometry plus that pass' culled matrices as instanced attributes
+		for (GLuint p = 0; p < GPU_CULLING_FRAMES; p++)
+		{
+			glBindVertexArray(this->passes[p].drawVAO);
+			glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)0);
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, Normal));
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, TexCoords));
+
+			glBindBuffer(GL_ARRAY_BUFFER, this->passes[p].culledVBO);
+
+			for (GLuint i = 0; i < 4; i++)
+			{
+				glEnableVertexAttribArray(INSTANCE_MATRIX_ATTRIBUTE + i);
+				glVertexAttribPointer(INSTANCE_MATRIX_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (GLvoid *)(i * sizeof(glm::vec4)));
+				glVertexAttribDivisor(INSTANCE_MATRIX_ATTRIBUTE + i, 1);
+			}
+		}
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// Instance matrices (all, and the culled ones of every pass), the commands and a copy of the model's geometry
+		GetMemoryTracker().Set(MEMORY_RENDERER, "GpuCuller", 0,
+			(1 + GPU_CULLING_FRAMES) * this->maxInstances * sizeof(glm::mat4) + this->commands.size() * sizeof(DrawElementsIndirectCommand)
+			+ vertices.size() * sizeof(Vertex) + indices.size() * sizeof(GLuint));
+	}
+};
@@ -0,0 +1,325 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <string>
+#include <functional>
+#include <iostream>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include "Profiler.h"
+
+// Frames whose queries can be in flight. Results are read this many frames later, by then the GPU is done
+// with them and reading never waits.
+const GLuint GPU_TIMER_FRAMES = 4;
+
+// Timed scopes per frame; deeper or later ones still get their debug group but no timing
+const GLuint GPU_TIMER_MAX_SCOPES = 64;
+
+// Frames between re-reading the GPU clock against the CPU one for the trace
+const GLuint GPU_TIMER_SYNC_INTERVAL = 120;
+
+// Time the GPU spent in one scope of a finished frame
+struct GpuTimerResult
+{
+	const char *name;
+	GLuint depth;
+	double milliseconds;
+};
+
+// Named GPU timing scopes. Every scope writes a GL_TIMESTAMP query when it opens and another when it
+// closes, so scopes nest freely (GL_TIME_ELAPSED queries can't). BeginFrame and EndFrame open and close
+// a top-level "Frame" scope around the rest, whose time is the whole frame's; FrameBenchmark takes its
+// GPU frame time from it. Each frame uses its own set out of a ring of GPU_TIMER_FRAMES, read back once
+// the GPU has finished them. Scopes are also KHR_debug groups, so RenderDoc, Nsight and the like show
+// the same pass names, and their timings go to the profiler's "GPU" track next to the CPU zones.
+// All calls must come from the thread that owns the GL context.
+class GpuTimer
+{
+public:
+	GpuTimer() : initialized(false), timerQueries(false), debugGroups(false), framesIssued(0), framesRead(0), framesDropped(0), depth(0), track(0)
+	{
+	}
+
+	// Call once per frame before the first scope
+	void BeginFrame()
+	{
+		if (!this->initialized)
+		{
+			this->initialize();
+		}
+
+		if (!this->timerQueries)
+		{
+			this->Begin("Frame");
+			return;
+		}
+
+		// Everything the GPU already finished
+		while (this->framesRead < this->framesIssued && this->readFrame(false))
+		{
+		}
+
+		// Ring full and the oldest frame still running: drop its timings rather than wait for it
+		if (this->framesIssued - this->framesRead == GPU_TIMER_FRAMES)
+		{
+			this->framesRead++;
+			this->framesDropped++;
+		}
+
+		Frame &frame = this->current();
+		frame.scopes.clear();
+
+		if (0 == this->framesIssued % GPU_TIMER_SYNC_INTERVAL)
+		{
+			GLint64 gpuTime = 0;
+			glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+			this->syncTicks = ProfilerTicks();
+			this->syncGpuTime = (GLuint64)gpuTime;
+		}
+
+		frame.syncTicks = this->syncTicks;
+		frame.syncGpuTime = this->syncGpuTime;
+
+		this->Begin("Frame");
+	}
+
+	void Begin(const char *name)
+	{
+		if (this->debugGroups)
+		{
+			glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+		}
+
+		if (this->timerQueries)
+		{
+			Frame &frame = this->current();
+
+			if (frame.scopes.size() < GPU_TIMER_MAX_SCOPES)
+			{
+				Scope scope = { name, this->depth };
+				frame.scopes.push_back(scope);
+				glQueryCounter(frame.queries[2 * (frame.scopes.size() - 1)], GL_TIMESTAMP);
+				this->open.push_back((GLint)frame.scopes.size() - 1);
+			}
+			else
+			{
+				this->open.push_back(-1);
+			}
+		}
+
+		this->depth++;
+	}
+
+	void End()
+	{
+		this->depth--;
+
+		if (this->timerQueries)
+		{
+			GLint scope = this->open.back();
+			this->open.pop_back();
+
+			if (scope >= 0)
+			{
+				Frame &frame = this->current();
+				frame.lastQuery = frame.queries[2 * scope + 1];
+				glQueryCounter(frame.lastQuery, GL_TIMESTAMP);
+			}
+		}
+
+		if (this->debugGroups)
+		{
+			glPopDebugGroup();
+		}
+	}
+
+	// Call once per frame after the last scope
+	void EndFrame()
+	{
+		this->End();
+
+		if (this->timerQueries)
+		{
+			this->framesIssued++;
+		}
+	}
+
+	// Scopes of the newest frame read back, in the order they were opened
+	const std::vector<GpuTimerResult> &GetResults() const
+	{
+		return this->results;
+	}
+
+	// Frames whose timings were lost because the GPU was more than GPU_TIMER_FRAMES behind
+	GLuint GetDroppedFrames() const
+	{
+		return this->framesDropped;
+	}
+
+	// False until the first BeginFrame, or when the driver has no timer queries
+	bool IsTiming() const
+	{
+		return this->timerQueries;
+	}
+
+	// Called with the index (counting from the first BeginFrame) and "Frame" time of every frame read back.
+	// Dropped frames aren't reported.
+	void SetFrameHandler(const std::function<void(GLuint, double)> &handler)
+	{
+		this->frameHandler = handler;
+	}
+
+	// Reads every frame still in flight, waiting for the GPU to finish them
+	void Finish()
+	{
+		while (this->timerQueries && this->framesRead < this->framesIssued)
+		{
+			this->readFrame(true);
+		}
+	}
+
+	// Reads what is still in flight and frees the queries. Call before destroying the context.
+	void Destroy()
+	{
+		if (!this->timerQueries)
+		{
+			return;
+		}
+
+		this->Finish();
+
+		for (GLuint i = 0; i < GPU_TIMER_FRAMES; i++)
+		{
+			glDeleteQueries(2 * GPU_TIMER_MAX_SCOPES, this->frames[i].queries);
+		}
+
+		this->timerQueries = false;
+	}
+
+private:
+	struct Scope
+	{
+		const char *name;
+		GLuint depth;
+	};
+
+	struct Frame
+	{
+		GLuint queries[2 * GPU_TIMER_MAX_SCOPES];
+		std::vector<Scope> scopes;
+		GLuint lastQuery;	// Written last, once it's available all the frame's queries are
+		unsigned long long syncTicks;
+		GLuint64 syncGpuTime;
+	};
+
+	bool initialized, timerQueries, debugGroups;
+	Frame frames[GPU_TIMER_FRAMES];
+	GLuint framesIssued, framesRead, framesDropped;
+	GLuint depth;
+	std::vector<GLint> open;	// Scope index of every open scope, -1 if it isn't timed
+	std::vector<GpuTimerResult> results;
+	std::function<void(GLuint, double)> frameHandler;
+	unsigned long long syncTicks;
+	GLuint64 syncGpuTime;
+	GLuint track;
+
+	void initialize()
+	{
+		// Timestamps need GL 3.3 or ARB_timer_query, debug groups GL 4.3 or KHR_debug
+		this->timerQueries = (GLEW_ARB_timer_query || GLEW_VERSION_3_3) ? true : false;
+		this->debugGroups = (GLEW_KHR_debug || GLEW_VERSION_4_3) ? true : false;
+
+		if (this->timerQueries)
+		{
+			for (GLuint i = 0; i < GPU_TIMER_FRAMES; i++)
+			{
+				glGenQueries(2 * GPU_TIMER_MAX_SCOPES, this->frames[i].queries);
+				this->frames[i].scopes.reserve(GPU_TIMER_MAX_SCOPES);
+			}
+
+			this->open.reserve(GPU_TIMER_MAX_SCOPES);
+			this->track = GetProfiler().GetTrack("GPU");
+		}
+		else
+		{
+			std::cout << "ERROR::GPU_TIMER::NO_TIMER_QUERIES" << std::endl;
+		}
+
+		this->initialized = true;
+	}
+
+	Frame &current()
+	{
+		return this->frames[this->framesIssued % GPU_TIMER_FRAMES];
+	}
+
+	// Reads the oldest frame in flight. Without wait it gives up if the GPU isn't done with it yet.
+	bool readFrame(bool wait)
+	{
+		Frame &frame = this->frames[this->framesRead % GPU_TIMER_FRAMES];
+
+		if (!frame.scopes.empty() && !wait)
+		{
+			GLint available = 0;
+			glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+
+			if (!available)
+			{
+				return false;
+			}
+		}
+
+		this->results.clear();
+
+		for (GLuint i = 0; i < frame.scopes.size(); i++)
+		{
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+
+			GpuTimerResult result = { frame.scopes[i].name, frame.scopes[i].depth, (end - begin) / 1.0e6 };
+			this->results.push_back(result);
+
+			ProfilerTrackEvent event = { frame.scopes[i].name, frame.syncTicks, (double)(long long)(begin - frame.syncGpuTime) / 1.0e3, (end - begin) / 1.0e3 };
+			GetProfiler().AddTrackEvent(this->track, event);
+		}
+
+		// Scope 0 is the "Frame" one BeginFrame opens
+		if (this->frameHandler && !this->results.empty())
+		{
+			this->frameHandler(this->framesRead, this->results[0].milliseconds);
+		}
+
+		this->framesRead++;
+
+		return true;
+	}
+};
+
+// Times the enclosing scope on the GPU, as a debug group of the same name
+class GpuZone
+{
+public:
+	GpuZone(GpuTimer &timer, const char *name) : timer(timer)
+	{
+		this->timer.Begin(name);
+	}
+
+	~GpuZone()
+	{
+		this->timer.End();
+	}
+
+private:
+	GpuTimer &timer;
+};
+
+// GPU_ZONE(timer, "name") times the rest of the scope; compiled out with the CPU zones by PROFILER_DISABLED
+#ifdef PROFILER_DISABLED
+#define GPU_ZONE(timer, name)
+#else
+#define GPU_ZONE(timer, name) GpuZone PROFILER_CONCAT(gpuZone, __LINE__)(timer, name)
+#endif
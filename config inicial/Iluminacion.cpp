@@ -10,6 +10,10 @@
 
 // GL includes
 #include "Shader.h"
+#include "RenderContext.h"
+#include "FrameBenchmark.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
 #include "Camera.h"
 #include "Model.h"
 
@@ -55,46 +59,44 @@ glm::vec3 dirLightDiffuse(0.4f, 0.4f, 0.4f);
 glm::vec3 dirLightSpecular(0.5f, 0.5f, 0.5f);
 
 
-int main()
+int main(int argc, char **argv)
 {
-    // Init GLFW
-    glfwInit();
-    // Set all the required options for GLFW
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-
-    // Create a GLFWwindow object that we can use for GLFW's functions
-    GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Materiales e Iluminacion", nullptr, nullptr);
-
-    if (nullptr == window)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-
+    // Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+    // --benchmark archivo.json [--warmup N] [--measure N] recorre una ruta de cmara fija y mide cada frame
+    RenderContextOptions options = ParseRenderContextOptions(argc, argv);
+    FrameBenchmark benchmark("iluminacion", ParseFrameBenchmarkOptions(argc, argv));
+    benchmark.Configure(options);
+
+    // --trace archivo.json guarda las zonas medidas para chrome://tracing o Perfetto
+    ProfilerOptions traza = ParseProfilerOptions(argc, argv);
+    PROFILE_THREAD("Principal");
+
+    // Las texturas se guardan comprimidas (BC1) en TextureCache/; --no-texture-cache las decodifica siempre
+    GetTextureCacheOptions() = ParseTextureCacheOptions(argc, argv);
+
+    // --glstats muestra al cerrar las llamadas a GL y los bytes subidos por frame
+    GLStatsOptions estadisticas = ParseGLStatsOptions(argc, argv);
+    GLStats glStats("iluminacion");
+    // El benchmark toma el tiempo de GPU de cada frame de la zona "Frame" del temporizador
+    GpuTimer gpuTimer;
+    benchmark.SetGpuTimer(gpuTimer);
+
+    RenderContext context;
+    if (!context.Create(WIDTH, HEIGHT, "Materiales e Iluminacion", options))
         return EXIT_FAILURE;
-    }
-
-    glfwMakeContextCurrent(window);
 
-    glfwGetFramebufferSize(window, &SCREEN_WIDTH, &SCREEN_HEIGHT);
+    GLFWwindow* window = context.GetWindow();
+    SCREEN_WIDTH = context.GetWidth();
+    SCREEN_HEIGHT = context.GetHeight();
 
-    // Set the required callback functions
-    glfwSetKeyCallback(window, KeyCallback);
-    glfwSetCursorPosCallback(window, MouseCallback);
-
-    // GLFW Options
-    //glfwSetInputMode( window, GLFW_CURSOR, GLFW_CURSOR_DISABLED );
-
-    // Set this to true so GLEW knows to use a modern approach to retrieving function pointers and extensions
-    glewExperimental = GL_TRUE;
-    // Initialize GLEW to setup the OpenGL Function pointers
-    if (GLEW_OK != glewInit())
+    // Sin ventana no hay eventos de entrada
+    if (window)
     {
-        std::cout << "Failed to initialize GLEW" << std::endl;
-        return EXIT_FAILURE;
+        // Set the required callback functions
+        glfwSetKeyCallback(window, KeyCallback);
+        glfwSetCursorPosCallback(window, MouseCallback);
+        // GLFW Options
+        //glfwSetInputMode( window, GLFW_CURSOR, GLFW_CURSOR_DISABLED );
     }
 
     // Define the viewport dimensions
@@ -110,9 +112,11 @@ int main()
 
 
 
-    // Load models
-    Model red_dog((char*)"Models/RedDog.obj");
-	Model blue_dog((char*)"Models/RedDog.obj");
+    // Load models. Las texturas se decodifican en los hilos del JobSystem y se suben en el loop.
+    JobSystem jobs;
+    TextureLoader texturas(jobs);
+    Model red_dog((char*)"Models/RedDog.obj", &jobs, &texturas);
+	Model blue_dog((char*)"Models/RedDog.obj", &jobs, &texturas);
     glm::mat4 projection = glm::perspective(camera.GetZoom(), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
 
     float vertices[] = {
@@ -174,44 +178,43 @@ int main()
     glEnableVertexAttribArray(1);
 
     // Load textures
+    // Se invierte en Y como haca stbi_set_flip_vertically_on_load
+    GLuint texture = texturas.Load("Texture_albedo.jpg", "Models", true);
 
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    int textureWidth, textureHeight, nrChannels;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char* image;
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-
-    image = stbi_load("Models/Texture_albedo.jpg", &textureWidth, &textureHeight, &nrChannels, 0);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureWidth, textureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    if (image)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureWidth, textureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-    {
-        std::cout << "Failed to load texture" << std::endl;
-    }
-    stbi_image_free(image);
+    // Con --benchmark todos los frames medidos tienen ya las texturas definitivas
+    if (benchmark.IsEnabled())
+        texturas.Finish();
 
+    // Ruta de la cmara para --benchmark: rodea los dos perros y la lmpara
+    CameraPath &ruta = benchmark.GetCameraPath();
+    ruta.AddKey(0.0f, glm::vec3(2.5f, 1.5f, 10.0f), -90.0f, -5.0f);
+    ruta.AddKey(3.0f, glm::vec3(10.0f, 2.0f, 4.0f), -152.0f, -10.0f);
+    ruta.AddKey(6.0f, glm::vec3(2.5f, 3.0f, -6.0f), -270.0f, -15.0f);
+    ruta.AddKey(9.0f, glm::vec3(-5.0f, 1.5f, 4.0f), -388.0f, -5.0f);
+    ruta.AddKey(12.0f, glm::vec3(2.5f, 1.5f, 10.0f), -450.0f, -5.0f);
 
     // Game loop
-    while (!glfwWindowShouldClose(window))
+    while (!context.ShouldClose() && !benchmark.IsFinished())
     {
+        PROFILE_ZONE("Frame");
+        benchmark.BeginFrame();
+        glStats.BeginFrame();
+        gpuTimer.BeginFrame();
+        texturas.Update();
+        benchmark.BeginStage(FRAME_STAGE_UPDATE);
+
         // Set frame time
-        GLfloat currentFrame = glfwGetTime();
+        GLfloat currentFrame = benchmark.GetTime(context.GetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
         // Check and call events
-        glfwPollEvents();
+        context.PollEvents();
         DoMovement();
+        benchmark.UpdateCamera(camera, currentFrame);
+
+        benchmark.EndStage(FRAME_STAGE_UPDATE);
+        benchmark.BeginStage(FRAME_STAGE_SUBMIT);
 
         // Clear the colorbuffer
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -299,14 +302,27 @@ int main()
         glDrawArrays(GL_TRIANGLES, 0, 36);
         glBindVertexArray(0);
 
+        gpuTimer.EndFrame();
+        benchmark.EndStage(FRAME_STAGE_SUBMIT);
+
         // Swap the buffers
-        glfwSwapBuffers(window);
+        context.SwapBuffers();
+        glStats.EndFrame();
+        benchmark.EndFrame();
     }
 
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
 
-    glfwTerminate();
+    // Los tiempos de GPU que faltan se leen antes de exportar la traza
+    gpuTimer.Destroy();
+    if (estadisticas.report) glStats.Report(std::cout);
+    if (!traza.tracePath.empty()) GetProfiler().ExportChromeTrace(traza.tracePath);
+
+    // El anillo de subida de texturas se libera con el contexto an activo
+    texturas.Destroy();
+
+    context.Destroy();
     return 0;
 }
 
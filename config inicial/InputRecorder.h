@@ -0,0 +1,428 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+// GL Includes
+#include <GL/glew.h>
+
+// File layout: "INPR", version, then records. Every record starts with its type byte and the time since
+// the previous record in microseconds (varint):
+//   INPUT_RECORD_FRAME  varint ticks since the previous frame, float deltaTime
+//   INPUT_RECORD_KEY    uint16 key, uint8 action
+//   INPUT_RECORD_MOUSE  float xOffset, float yOffset
+// The key and mouse records after a frame record are the input that frame consumed.
+const char INPUT_RECORDER_MAGIC[4] = { 'I', 'N', 'P', 'R' };
+const GLuint INPUT_RECORDER_VERSION = 1;
+
+enum InputRecordType
+{
+	INPUT_RECORD_FRAME = 0,
+	INPUT_RECORD_KEY,
+	INPUT_RECORD_MOUSE
+};
+
+// Command line switches:
+//   --record file.inp  writes every key and mouse event with the frame and simulation step that used it
+//   --replay file.inp  ignores the devices and feeds the recorded events back, frame by frame
+struct InputRecorderOptions
+{
+	std::string recordPath;
+	std::string replayPath;
+};
+
+inline InputRecorderOptions ParseInputRecorderOptions(int argc, char **argv)
+{
+	InputRecorderOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--record") && i + 1 < argc)
+		{
+			options.recordPath = argv[++i];
+		}
+		else if (0 == strcmp(argv[i], "--replay") && i + 1 < argc)
+		{
+			options.replayPath = argv[++i];
+		}
+	}
+
+	return options;
+}
+
+// Records the input a scene consumes and plays it back deterministically. The input callbacks report
+// every event with RecordKey/RecordMouse and apply it as usual; the simulation calls Frame() once per
+// frame, at the point where it takes the accumulated input, passing the fixed timestep's step count and
+// the frame time. Recording, that closes the frame: its step, time and events are written. Replaying,
+// Frame() restores the recorded frame time and calls the key and mouse handlers with the events of that
+// frame, so the simulation sees the same input on the same steps as the recorded run, whatever the
+// machine's frame rate.
+class InputRecorder
+{
+public:
+	InputRecorder() : recording(false), replaying(false), finished(false), lastTick(0), lastRecordTime(0), nextFrame(0), desync(false)
+	{
+	}
+
+	~InputRecorder()
+	{
+		this->Close();
+	}
+
+	// Starts recording or replaying as the options ask; false if a file couldn't be opened
+	bool Open(const InputRecorderOptions &options)
+	{
+		this->start = std::chrono::steady_clock::now();
+
+		if (!options.replayPath.empty())
+		{
+			return this->load(options.replayPath);
+		}
+
+		if (!options.recordPath.empty())
+		{
+			this->file.open(options.recordPath.c_str(), std::ios::binary);
+
+			if (!this->file)
+			{
+				std::cout << "ERROR::INPUT_RECORDER::CANNOT_WRITE " << options.recordPath << std::endl;
+				return false;
+			}
+
+			GLuint version = INPUT_RECORDER_VERSION;
+			this->file.write(INPUT_RECORDER_MAGIC, 4);
+			this->file.write((const char *)&version, sizeof(version));
+			this->recording = true;
+		}
+
+		return true;
+	}
+
+	// Writes what is still buffered; called by the destructor too
+	void Close()
+	{
+		if (this->recording)
+		{
+			if (!this->buffer.empty())
+			{
+				this->file.write((const char *)&this->buffer[0], this->buffer.size());
+				this->buffer.clear();
+			}
+
+			this->file.close();
+			this->recording = false;
+		}
+	}
+
+	bool IsRecording() const
+	{
+		return this->recording;
+	}
+
+	// While replaying the scene should ignore the real devices
+	bool IsReplaying() const
+	{
+		return this->replaying;
+	}
+
+	// Every recorded frame was replayed
+	bool IsFinished() const
+	{
+		return this->finished;
+	}
+
+	// Handlers that apply one event the same way the input callbacks do
+	void SetHandlers(const std::function<void(int, int)> &keyHandler, const std::function<void(GLfloat, GLfloat)> &mouseHandler)
+	{
+		this->keyHandler = keyHandler;
+		this->mouseHandler = mouseHandler;
+	}
+
+	// From the input callbacks
+	void RecordKey(int key, int action)
+	{
+		if (!this->recording || key < 0 || key > 0xFFFF)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		Event event = { this->now(), INPUT_RECORD_KEY, key, action, 0.0f, 0.0f };
+		this->pending.push_back(event);
+	}
+
+	void RecordMouse(GLfloat xOffset, GLfloat yOffset)
+	{
+		if (!this->recording)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		Event event = { this->now(), INPUT_RECORD_MOUSE, 0, 0, xOffset, yOffset };
+		this->pending.push_back(event);
+	}
+
+	// Once per frame where the simulation takes its input. tick is the number of fixed steps simulated so far.
+	// When replaying deltaTime is replaced by the recorded one.
+	void Frame(unsigned long long tick, GLfloat &deltaTime)
+	{
+		if (this->recording)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			this->writeHeader(INPUT_RECORD_FRAME, this->now());
+			this->writeVarint(tick - this->lastTick);
+			this->writeBytes(&deltaTime, sizeof(deltaTime));
+			this->lastTick = tick;
+
+			for (GLuint i = 0; i < this->pending.size(); i++)
+			{
+				const Event &event = this->pending[i];
+				this->writeHeader(event.type, event.time);
+
+				if (INPUT_RECORD_KEY == event.type)
+				{
+					unsigned short key = (unsigned short)event.key;
+					unsigned char action = (unsigned char)event.action;
+					this->writeBytes(&key, sizeof(key));
+					this->writeBytes(&action, sizeof(action));
+				}
+				else
+				{
+					this->writeBytes(&event.x, sizeof(event.x));
+					this->writeBytes(&event.y, sizeof(event.y));
+				}
+			}
+
+			this->pending.clear();
+
+			// Keep the file small and the writes rare
+			if (this->buffer.size() > 64 * 1024)
+			{
+				this->file.write((const char *)&this->buffer[0], this->buffer.size());
+				this->buffer.clear();
+			}
+		}
+		else if (this->replaying)
+		{
+			if (this->nextFrame >= this->frames.size())
+			{
+				this->finished = true;
+				return;
+			}
+
+			const RecordedFrame &frame = this->frames[this->nextFrame++];
+
+			// Different step count means the simulation diverged from the recorded run
+			if (frame.tick != tick && !this->desync)
+			{
+				std::cout << "ERROR::INPUT_RECORDER::DESYNC at frame " << this->nextFrame - 1 << ": step " << tick << ", recorded " << frame.tick << std::endl;
+				this->desync = true;
+			}
+
+			deltaTime = frame.deltaTime;
+
+			for (GLuint i = frame.firstEvent; i < frame.firstEvent + frame.eventCount; i++)
+			{
+				const Event &event = this->events[i];
+
+				if (INPUT_RECORD_KEY == event.type && this->keyHandler)
+				{
+					this->keyHandler(event.key, event.action);
+				}
+				else if (INPUT_RECORD_MOUSE == event.type && this->mouseHandler)
+				{
+					this->mouseHandler(event.x, event.y);
+				}
+			}
+
+			if (this->nextFrame == this->frames.size())
+			{
+				this->finished = true;
+			}
+		}
+	}
+
+private:
+	struct Event
+	{
+		unsigned long long time;	// Microseconds since Open
+		GLuint type;
+		int key, action;
+		GLfloat x, y;
+	};
+
+	struct RecordedFrame
+	{
+		unsigned long long tick;
+		GLfloat deltaTime;
+		GLuint firstEvent, eventCount;
+	};
+
+	bool recording, replaying;
+	std::atomic<bool> finished;
+	std::chrono::steady_clock::time_point start;
+	std::mutex mutex;
+	std::function<void(int, int)> keyHandler;
+	std::function<void(GLfloat, GLfloat)> mouseHandler;
+
+	/*  Recording  */
+	std::ofstream file;
+	std::vector<unsigned char> buffer;
+	std::vector<Event> pending;
+	unsigned long long lastTick, lastRecordTime;
+
+	/*  Replay  */
+	std::vector<RecordedFrame> frames;
+	std::vector<Event> events;
+	GLuint nextFrame;
+	bool desync;
+
+	unsigned long long now() const
+	{
+		return (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->start).count();
+	}
+
+	void writeBytes(const void *data, size_t size)
+	{
+		const unsigned char *bytes = (const unsigned char *)data;
+		this->buffer.insert(this->buffer.end(), bytes, bytes + size);
+	}
+
+	// 7 bits per byte, high bit set on every byte but the last
+	void writeVarint(unsigned long long value)
+	{
+		while (value >= 0x80)
+		{
+			this->buffer.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+
+		this->buffer.push_back((unsigned char)value);
+	}
+
+	void writeHeader(GLuint type, unsigned long long time)
+	{
+		this->buffer.push_back((unsigned char)type);
+		this->writeVarint(time >= this->lastRecordTime ? time - this->lastRecordTime : 0);
+		this->lastRecordTime = std::max(time, this->lastRecordTime);
+	}
+
+	static bool readVarint(const std::vector<unsigned char> &data, size_t &offset, unsigned long long &value)
+	{
+		value = 0;
+
+		for (GLuint shift = 0; offset < data.size() && shift < 64; shift += 7)
+		{
+			unsigned char byte = data[offset++];
+			value |= (unsigned long long)(byte & 0x7F) << shift;
+
+			if (!(byte & 0x80))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	static bool readBytes(const std::vector<unsigned char> &data, size_t &offset, void *out, size_t size)
+	{
+		if (offset + size > data.size())
+		{
+			return false;
+		}
+
+		memcpy(out, &data[offset], size);
+		offset += size;
+
+		return true;
+	}
+
+	bool load(const std::string &path)
+	{
+		std::ifstream in(path.c_str(), std::ios::binary);
+
+		if (!in)
+		{
+			std::cout << "ERROR::INPUT_RECORDER::CANNOT_READ " << path << std::endl;
+			return false;
+		}
+
+		std::vector<unsigned char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		GLuint version = 0;
+
+		if (data.size() < 8 || 0 != memcmp(&data[0], INPUT_RECORDER_MAGIC, 4) || (memcpy(&version, &data[4], 4), version != INPUT_RECORDER_VERSION))
+		{
+			std::cout << "ERROR::INPUT_RECORDER::NOT_A_RECORDING " << path << std::endl;
+			return false;
+		}
+
+		size_t offset = 8;
+		unsigned long long time = 0, tick = 0;
+
+		while (offset < data.size())
+		{
+			GLuint type = data[offset++];
+			unsigned long long elapsed;
+			bool ok = readVarint(data, offset, elapsed);
+			Event event = { time += elapsed, type, 0, 0, 0.0f, 0.0f };
+
+			if (INPUT_RECORD_FRAME == type)
+			{
+				unsigned long long ticks;
+				RecordedFrame frame = { 0, 0.0f, (GLuint)this->events.size(), 0 };
+				ok = ok && readVarint(data, offset, ticks) && readBytes(data, offset, &frame.deltaTime, sizeof(frame.deltaTime));
+				frame.tick = tick += ticks;
+
+				if (ok)
+				{
+					this->frames.push_back(frame);
+				}
+			}
+			else if (INPUT_RECORD_KEY == type)
+			{
+				unsigned short key;
+				unsigned char action;
+				ok = ok && readBytes(data, offset, &key, sizeof(key)) && readBytes(data, offset, &action, sizeof(action));
+				event.key = key;
+				event.action = action;
+			}
+			else if (INPUT_RECORD_MOUSE == type)
+			{
+				ok = ok && readBytes(data, offset, &event.x, sizeof(event.x)) && readBytes(data, offset, &event.y, sizeof(event.y));
+			}
+			else
+			{
+				ok = false;
+			}
+
+			// A truncated tail (the recording was killed) just ends the replay early
+			if (!ok)
+			{
+				break;
+			}
+
+			if (INPUT_RECORD_FRAME != type && !this->frames.empty())
+			{
+				this->events.push_back(event);
+				this->frames.back().eventCount++;
+			}
+		}
+
+		this->replaying = true;
+		this->finished = this->frames.empty();
+
+		return true;
+	}
+};
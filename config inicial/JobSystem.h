@@ -0,0 +1,393 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <iostream>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include "Profiler.h"
+
+// Jobs each thread can have in flight before its ring of job objects wraps around
+const GLuint JOB_RING_SIZE = 4096;
+
+// Most jobs one ParallelFor creates, bigger loops get bigger ranges. Well under the ring's size, so the
+// ranges never wrap onto the root job that waits for them.
+const GLuint JOB_PARALLEL_FOR_MAX_JOBS = JOB_RING_SIZE / 4;
+
+// A unit of work. Jobs are created by JobSystem::Create and live in a per-thread ring, so a handle stays
+// valid until JOB_RING_SIZE more jobs were created on the same thread. A slot is only reused once the job
+// in it finished: Create runs other jobs until a queued one does, and skips the ones not queued yet (a
+// root whose children are still being created), which would never finish while it waits.
+struct Job
+{
+	std::function<void()> function;
+	Job *parent;
+	std::atomic<GLint> unfinished; // The job itself plus its children still running
+	std::atomic<bool> queued;		// Run was called on it
+};
+
+// Per thread counters, see JobSystem::GetWorkerStats
+struct JobWorkerStats
+{
+	GLuint jobsExecuted = 0;
+	GLuint jobsStolen = 0;		// Taken from another thread's deque
+	double busySeconds = 0.0;	// Time spent inside job functions
+	double utilization = 0.0;	// busySeconds over the time since the last ResetStats
+};
+
+// Work-stealing job scheduler. Every thread of the system (the one that created it is worker 0) owns
+// a deque: it pushes and pops its own jobs at the back, so recent work stays hot in its cache, and
+// steals from the front of the others' when it runs dry. Threads outside the system can create and run
+// jobs too; theirs go to one shared extra deque.
+// A job can have a parent: the parent only finishes once every child has, so waiting on a root job
+// waits on the whole tree. Wait() never just blocks, the waiting thread runs other jobs meanwhile.
+class JobSystem
+{
+public:
+	// threadCount includes the calling thread, 0 uses every hardware thread.
+	// There is one worker slot per thread plus the shared one for outside threads.
+	explicit JobSystem(GLuint threadCount = 0) : threadCount(threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency())), workers(this->threadCount + 1), stopping(false), queued(0)
+	{
+		this->statsStart = now();
+		currentThread().system = this;
+		currentThread().index = 0;
+
+		for (GLuint i = 1; i < this->threadCount; i++)
+		{
+			this->threads.push_back(std::thread(&JobSystem::workerLoop, this, i));
+		}
+	}
+
+	~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->sleepMutex);
+			this->stopping = true;
+		}
+
+		this->wake.notify_all();
+
+		for (GLuint i = 0; i < this->threads.size(); i++)
+		{
+			this->threads[i].join();
+		}
+
+		if (currentThread().system == this)
+		{
+			currentThread().system = nullptr;
+		}
+	}
+
+	// Threads that execute jobs, the creating thread included
+	GLuint GetThreadCount() const
+	{
+		return this->threadCount;
+	}
+
+	// Index of the calling thread in [0, GetThreadCount()], GetThreadCount() for threads outside the system.
+	// Arrays indexed by worker need GetThreadCount() + 1 entries.
+	GLuint GetWorkerIndex() const
+	{
+		return currentThread().system == this ? currentThread().index : this->threadCount;
+	}
+
+	// Creates a job without starting it. With a parent, the parent won't finish before this job does.
+	Job *Create(const std::function<void()> &function, Job *parent = nullptr)
+	{
+		GLuint index = this->GetWorkerIndex();
+		Worker &worker = this->workers[index];
+		Job *job = nullptr;
+
+		for (GLuint tried = 0; !job && tried < JOB_RING_SIZE; tried++)
+		{
+			Job *slot = &worker.ring[worker.allocated.fetch_add(1) % JOB_RING_SIZE];
+
+			if (slot->unfinished <= 0 || slot->queued)
+			{
+				job = slot;
+			}
+		}
+
+		if (!job)
+		{
+			// Every slot holds a job nobody ran yet: take one off the ring, kept until the system goes
+			std::cout << "ERROR::JOB_SYSTEM::RING_FULL_OF_UNQUEUED_JOBS" << std::endl;
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			worker.overflow.emplace_back();
+			job = &worker.overflow.back();
+		}
+
+		// The ring wrapped onto a job still queued or running (a decode spanning frames, say)
+		while (job->unfinished > 0)
+		{
+			if (!this->executeOne(index))
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		job->function = function;
+		job->parent = parent;
+		job->unfinished = 1;
+		job->queued = false;
+
+		if (parent)
+		{
+			parent->unfinished++;
+		}
+
+		return job;
+	}
+
+	// Queues the job on the calling thread's deque
+	void Run(Job *job)
+	{
+		Worker &worker = this->workers[this->GetWorkerIndex()];
+		job->queued = true;
+
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			worker.jobs.push_back(job);
+		}
+
+		this->queued++;
+
+		// Taking the lock orders this with a worker that just found nothing to do and is about to sleep
+		{
+			std::lock_guard<std::mutex> lock(this->sleepMutex);
+		}
+
+		this->wake.notify_one();
+	}
+
+	// Runs other jobs until this one (and its children) finished
+	void Wait(const Job *job)
+	{
+		GLuint index = this->GetWorkerIndex();
+
+		while (job->unfinished > 0)
+		{
+			if (!this->executeOne(index))
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	bool IsFinished(const Job *job) const
+	{
+		return job->unfinished <= 0;
+	}
+
+	// Calls body(begin, end, worker) over [0, count) split in ranges of at most grain items and waits for all
+	// of them. worker is the calling thread's GetWorkerIndex(), handy for per thread accumulators.
+	void ParallelFor(GLuint count, GLuint grain, const std::function<void(GLuint, GLuint, GLuint)> &body)
+	{
+		grain = std::max(std::max(1u, grain), (count + JOB_PARALLEL_FOR_MAX_JOBS - 1) / JOB_PARALLEL_FOR_MAX_JOBS);
+
+		if (count <= grain || this->threadCount <= 1)
+		{
+			if (count > 0)
+			{
+				body(0, count, this->GetWorkerIndex());
+			}
+
+			return;
+		}
+
+		Job *root = this->Create([] {});
+
+		for (GLuint begin = 0; begin < count; begin += grain)
+		{
+			GLuint end = std::min(count, begin + grain);
+
+			this->Run(this->Create([this, begin, end, &body] { body(begin, end, this->GetWorkerIndex()); }, root));
+		}
+
+		this->Run(root);
+		this->Wait(root);
+	}
+
+	// Counters of one worker since the last ResetStats, index as in GetWorkerIndex()
+	JobWorkerStats GetWorkerStats(GLuint worker) const
+	{
+		const Worker &w = this->workers[worker];
+		JobWorkerStats stats;
+		double elapsed = now() - this->statsStart;
+
+		stats.jobsExecuted = w.jobsExecuted;
+		stats.jobsStolen = w.jobsStolen;
+		stats.busySeconds = w.busyNanoseconds * 1e-9;
+		stats.utilization = elapsed > 0.0 ? stats.busySeconds / elapsed : 0.0;
+
+		return stats;
+	}
+
+	// Call while no jobs are running
+	void ResetStats()
+	{
+		for (GLuint i = 0; i < this->workers.size(); i++)
+		{
+			this->workers[i].jobsExecuted = 0;
+			this->workers[i].jobsStolen = 0;
+			this->workers[i].busyNanoseconds = 0;
+		}
+
+		this->statsStart = now();
+	}
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Job *> jobs;
+		std::vector<Job> ring;
+		std::deque<Job> overflow;	// Only used when the whole ring waits to be queued
+		std::atomic<GLuint> allocated;
+
+		// Atomic since the slot for outside threads is shared by all of them
+		std::atomic<GLuint> jobsExecuted, jobsStolen;
+		std::atomic<unsigned long long> busyNanoseconds;
+
+		Worker() : ring(JOB_RING_SIZE), allocated(0), jobsExecuted(0), jobsStolen(0), busyNanoseconds(0)
+		{
+		}
+	};
+
+	struct ThreadSlot
+	{
+		const JobSystem *system;
+		GLuint index;
+	};
+
+	GLuint threadCount;
+	std::vector<Worker> workers;
+	std::vector<std::thread> threads;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	bool stopping;
+	std::atomic<GLint> queued;
+	double statsStart;
+
+	static ThreadSlot &currentThread()
+	{
+		static thread_local ThreadSlot slot = { nullptr, 0 };
+		return slot;
+	}
+
+	static double now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Own jobs newest first, then the oldest job of any other deque
+	Job *take(GLuint index, bool &stolen)
+	{
+		stolen = false;
+
+		{
+			Worker &own = this->workers[index];
+			std::lock_guard<std::mutex> lock(own.mutex);
+
+			if (!own.jobs.empty())
+			{
+				Job *job = own.jobs.back();
+				own.jobs.pop_back();
+				return job;
+			}
+		}
+
+		GLuint count = (GLuint)this->workers.size();
+
+		for (GLuint offset = 1; offset < count; offset++)
+		{
+			Worker &victim = this->workers[(index + offset) % count];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+
+			if (!victim.jobs.empty())
+			{
+				Job *job = victim.jobs.front();
+				victim.jobs.pop_front();
+				stolen = true;
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool executeOne(GLuint index)
+	{
+		bool stolen;
+		Job *job = this->take(index, stolen);
+
+		if (!job)
+		{
+			return false;
+		}
+
+		this->queued--;
+
+		double start = now();
+		job->function();
+
+		Worker &worker = this->workers[index];
+		worker.busyNanoseconds += (unsigned long long)((now() - start) * 1e9);
+		worker.jobsExecuted++;
+		worker.jobsStolen += stolen ? 1 : 0;
+
+		this->finish(job);
+
+		return true;
+	}
+
+	void finish(Job *job)
+	{
+		// The parent is read first: once unfinished reaches 0 the slot can be reused by Create
+		while (job)
+		{
+			Job *parent = job->parent;
+
+			if (0 != --job->unfinished)
+			{
+				break;
+			}
+
+			job = parent;
+		}
+	}
+
+	void workerLoop(GLuint index)
+	{
+		currentThread().system = this;
+		currentThread().index = index;
+		PROFILE_THREAD(("Job worker " + std::to_string(index)).c_str());
+
+		while (true)
+		{
+			if (this->executeOne(index))
+			{
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(this->sleepMutex);
+			this->wake.wait(lock, [this] { return this->stopping || this->queued > 0; });
+
+			if (this->stopping)
+			{
+				return;
+			}
+		}
+	}
+};
@@ -16,8 +16,11 @@
 
 // Módulos personalizados del proyecto
 #include "Shader.h"       // Clase para manejar programas de sombreado (VS y FS)
+#include "RenderContext.h"
 #include "Camera.h"       // Clase que gestiona el movimiento de la cámara
 #include "Model.h"        // Clase para cargar y dibujar modelos 3D
+#include "Animation.h"    // Clips de animación con keyframes por tiempo
+#include "AnimationFile.h" // Guardado y carga de clips en binario
 
 // Declaración de funciones utilizadas en el flujo del programa
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode);
@@ -69,80 +72,78 @@ float FLegs = 0.0f, RLegs = 0.0f, head = 0.0f, tail = 0.0f;
 // Variables base del modelo principal
 float dogPosX, dogPosY, dogPosZ;
 
-// Estructura de keyframes y control de interpolación
-#define MAX_FRAMES 9
-int i_max_steps = 190;
-int i_curr_steps = 0;
+// Keyframes por tiempo: cada variable animada es un canal del clip, sin límite de poses
+// y con la misma duración por segmento sin importar los FPS
+const float KEY_INTERVAL = 190.0f / 60.0f; // Segundos entre poses (los 190 pasos de antes a 60 FPS)
 
-typedef struct _frame {
-    float rotDog, rotDogInc;
-    float dogPosX, dogPosY, dogPosZ;
-    float incX, incY, incZ;
-    float head, headInc;
-} FRAME;
-
-FRAME KeyFrame[MAX_FRAMES];  // Arreglo con los cuadros clave
+AnimationClip dogClip;
 int FrameIndex = 0;
 bool play = false;
-int playIndex = 0;
+float playTime = 0.0f;
+
+// Archivo donde se guardan las poses entre ejecuciones
+const char *CLIP_PATH = "perro.anim";
+
+// Asocia cada variable del perro con un canal del clip
+void setupClip() {
+    dogClip.AddChannel("dogPosX", &dogPosX);
+    dogClip.AddChannel("dogPosY", &dogPosY);
+    dogClip.AddChannel("dogPosZ", &dogPosZ);
+    dogClip.AddChannel("rotDog", &rotDog, ANIMATION_CHANNEL_ANGLE);
+    dogClip.AddChannel("head", &head, ANIMATION_CHANNEL_ANGLE);
+}
 
 // Guarda un nuevo keyframe con la pose actual
 void saveFrame() {
     printf("frameindex %d\n", FrameIndex);
-    KeyFrame[FrameIndex].dogPosX = dogPosX;
-    KeyFrame[FrameIndex].dogPosY = dogPosY;
-    KeyFrame[FrameIndex].dogPosZ = dogPosZ;
-    KeyFrame[FrameIndex].rotDog  = rotDog;
-    KeyFrame[FrameIndex].head    = head;
+    dogClip.Capture(FrameIndex * KEY_INTERVAL);
     FrameIndex++;
 }
 
 // Restaura el modelo a la primera pose grabada
 void resetElements() {
-    dogPosX = KeyFrame[0].dogPosX;
-    dogPosY = KeyFrame[0].dogPosY;
-    dogPosZ = KeyFrame[0].dogPosZ;
-    rotDog  = KeyFrame[0].rotDog;
-    head    = KeyFrame[0].head;
+    dogClip.Apply(dogClip.GetStartTime());
+}
+
+// Guarda las poses grabadas (simplificadas y cuantizadas) para la siguiente ejecución
+void saveClip() {
+    if (SaveAnimationClip(CLIP_PATH, dogClip))
+        printf("clip guardado en %s\n", CLIP_PATH);
 }
 
-// Calcula los incrementos para interpolar entre dos keyframes
-void interpolation() {
-    KeyFrame[playIndex].incX = (KeyFrame[playIndex + 1].dogPosX - KeyFrame[playIndex].dogPosX) / i_max_steps;
-    KeyFrame[playIndex].incY = (KeyFrame[playIndex + 1].dogPosY - KeyFrame[playIndex].dogPosY) / i_max_steps;
-    KeyFrame[playIndex].incZ = (KeyFrame[playIndex + 1].dogPosZ - KeyFrame[playIndex].dogPosZ) / i_max_steps;
+// Carga las poses guardadas, las siguientes se graban después de la última
+void loadClip() {
+    if (LoadAnimationClip(CLIP_PATH, dogClip)) {
+        FrameIndex = (int)(dogClip.GetEndTime() / KEY_INTERVAL) + 1;
+        resetElements();
+        printf("clip cargado de %s\n", CLIP_PATH);
+    }
+}
 
-    KeyFrame[playIndex].rotDogInc = (KeyFrame[playIndex + 1].rotDog - KeyFrame[playIndex].rotDog) / i_max_steps;
-    KeyFrame[playIndex].headInc   = (KeyFrame[playIndex + 1].head   - KeyFrame[playIndex].head)   / i_max_steps;
+// Evalúa la pose en el instante t de la reproducción
+void interpolation(float t) {
+    dogClip.Apply(dogClip.GetStartTime() + t);
 }
 
 // Control de tiempo entre cuadros
 GLfloat deltaTime = 0.0f;
 GLfloat lastFrame = 0.0f;
 
-int main() {
-    // Inicialización de GLFW y creación de la ventana
-    glfwInit();
-    GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Animacion maquina de estados", nullptr, nullptr);
-
-    if (!window) {
-        std::cout << "Error al crear la ventana GLFW" << std::endl;
-        glfwTerminate();
+int main(int argc, char **argv) {
+    // Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+    RenderContext context;
+    if (!context.Create(WIDTH, HEIGHT, "Animacion maquina de estados", ParseRenderContextOptions(argc, argv), false))
         return EXIT_FAILURE;
-    }
 
-    glfwMakeContextCurrent(window);
-    glfwGetFramebufferSize(window, &SCREEN_WIDTH, &SCREEN_HEIGHT);
+    GLFWwindow* window = context.GetWindow();
+    SCREEN_WIDTH = context.GetWidth();
+    SCREEN_HEIGHT = context.GetHeight();
 
-    // Asignación de funciones de callback para eventos
-    glfwSetKeyCallback(window, KeyCallback);
-    glfwSetCursorPosCallback(window, MouseCallback);
-
-    // Inicialización de GLEW (manejador de extensiones)
-    glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK) {
-        std::cout << "Error al inicializar GLEW" << std::endl;
-        return EXIT_FAILURE;
+    // Sin ventana no hay eventos de entrada
+    if (window) {
+        // Asignación de funciones de callback para eventos
+        glfwSetKeyCallback(window, KeyCallback);
+        glfwSetCursorPosCallback(window, MouseCallback);
     }
 
     glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
@@ -162,10 +163,10 @@ int main() {
     Model Piso("Models/piso.obj");
     Model Ball("Models/ball.obj");
 
-    // Inicialización de todos los keyframes en cero
-    for (int i = 0; i < MAX_FRAMES; i++) {
-        KeyFrame[i] = {0,0,0,0,0,0,0,0,0,0};
-    }
+    // Canales de animación del perro
+    setupClip();
+    if (std::ifstream(CLIP_PATH))
+        loadClip();
 
     // Configuración de buffers de vértices
     GLuint VBO, VAO;
@@ -190,12 +191,12 @@ int main() {
     glm::mat4 projection = glm::perspective(camera.GetZoom(), (GLfloat)SCREEN_WIDTH / SCREEN_HEIGHT, 0.1f, 100.0f);
 
     // Bucle principal de renderizado
-    while (!glfwWindowShouldClose(window)) {
-        GLfloat currentFrame = glfwGetTime();
+    while (!context.ShouldClose()) {
+        GLfloat currentFrame = context.GetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        glfwPollEvents();
+        context.PollEvents();
         DoMovement();
         Animation();
 
@@ -206,9 +207,76 @@ int main() {
         lightingShader.Use();
         // (Aquí sigue toda la configuración de luces, materiales y dibujo de modelos)
         // ...
-        glfwSwapBuffers(window);
+        context.SwapBuffers();
     }
 
-    glfwTerminate();
+    context.Destroy();
     return 0;
 }
+
+// Movimiento de cámara con teclado
+void DoMovement() {
+    if (keys[GLFW_KEY_W]) camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (keys[GLFW_KEY_S]) camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (keys[GLFW_KEY_A]) camera.ProcessKeyboard(LEFT, deltaTime);
+    if (keys[GLFW_KEY_D]) camera.ProcessKeyboard(RIGHT, deltaTime);
+}
+
+// Teclado: K guarda una pose, L reproduce o detiene la animación, G guarda el clip y C lo vuelve a cargar
+void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
+    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, GL_TRUE);
+
+    if (key >= 0 && key < 1024)
+        keys[key] = (action == GLFW_PRESS);
+
+    if (key == GLFW_KEY_K && action == GLFW_PRESS)
+        saveFrame();
+
+    if (key == GLFW_KEY_G && action == GLFW_PRESS)
+        saveClip();
+
+    if (key == GLFW_KEY_C && action == GLFW_PRESS && !play)
+        loadClip();
+
+    if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+        if (!play && FrameIndex > 1) {
+            resetElements();
+            playTime = 0.0f;
+            play = true;
+        }
+        else {
+            play = false;
+        }
+    }
+}
+
+// Reproducción de los keyframes, avanza con el tiempo real y no con los frames
+void Animation() {
+    if (!play)
+        return;
+
+    playTime += deltaTime;
+
+    if (playTime >= dogClip.GetDuration()) {
+        interpolation(dogClip.GetDuration());
+        play = false;
+        return;
+    }
+
+    interpolation(playTime);
+}
+
+// Movimiento del ratón para controlar la cámara
+void MouseCallback(GLFWwindow* window, double xPos, double yPos) {
+    if (firstMouse) {
+        lastX = xPos; lastY = yPos;
+        firstMouse = false;
+    }
+
+    GLfloat xOffset = xPos - lastX;
+    GLfloat yOffset = lastY - yPos; // Eje Y invertido
+    lastX = xPos; lastY = yPos;
+
+    camera.ProcessMouseMovement(xOffset, yOffset);
+}
\ No newline at end of file
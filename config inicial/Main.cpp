@@ -5,6 +5,7 @@
 #include <GL/glew.h>
 
 #include <GLFW/glfw3.h>
+#include "RenderContext.h"
 
 const GLint WIDTH = 800, HEIGHT = 600; //ventana de 
 
@@ -35,39 +36,13 @@ void CrearShader(void); //declarar una funcion pero se describe mas abjo
 
 
 
-int main() {
-	glfwInit();
-	//Verificacin de compatibilidad 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-
-	GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "Practica 0", nullptr, nullptr);
-	
-	int screenWidth, screenHeight;
-
-	glfwGetFramebufferSize(window, &screenWidth, &screenHeight);
-
-	//Verificacin de errores de creacion  ventana
-	if (nullptr == window) 
-	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-
+int main(int argc, char **argv) {
+	// Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+	RenderContext context;
+	if (!context.Create(WIDTH, HEIGHT, "Practica 0", ParseRenderContextOptions(argc, argv)))
 		return EXIT_FAILURE;
-	}
-
-	glfwMakeContextCurrent(window);
-	glewExperimental = GL_TRUE;
-
-	//Verificacin de errores de inicializacin de glew
 
-	if (GLEW_OK != glewInit()) {
-		std::cout << "Failed to initialise GLEW" << std::endl;
-		return EXIT_FAILURE;
-	}
+	int screenWidth = context.GetWidth(), screenHeight = context.GetHeight();
 
 	// Imprimimos informacin de OpenGL del sistema
 	std::cout << "> Version: " << glGetString(GL_VERSION) << std::endl;
@@ -113,10 +88,10 @@ int main() {
 
 
 
-	while (!glfwWindowShouldClose(window))
+	while (!context.ShouldClose())
 	{
 		// Check if any events have been activiated (key pressed, mouse moved etc.) and call corresponding response functions
-		glfwPollEvents();
+		context.PollEvents();
 
 		// Render
 		// Clear the colorbuffer
@@ -131,12 +106,12 @@ int main() {
 		glBindVertexArray(0);
 
 		// Swap the screen buffers
-		glfwSwapBuffers(window);
+		context.SwapBuffers();
 	}
 
 
 
-	glfwTerminate();
+	context.Destroy();
 	return EXIT_SUCCESS;
 }
 
@@ -8,41 +8,25 @@
 
 // Shaders
 #include "Shader.h"
+#include "RenderContext.h"
 
 void resize(GLFWwindow* window, int width, int height);
 
 const GLint WIDTH = 800, HEIGHT = 600;
 
 
-int main() {
-	glfwInit();
-	//Verificaci�n de compatibilidad 
-	/*glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_COMPAT_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);*/
-
-	GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "Dibujo de Primitivas en 2D", NULL, NULL);
-	glfwSetFramebufferSizeCallback(window, resize);
-	
-	//Verificaci�n de errores de creacion  ventana
-	if (window== NULL) 
-	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-
+int main(int argc, char **argv) {
+	// Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+	RenderContext context;
+	if (!context.Create(WIDTH, HEIGHT, "Dibujo de Primitivas en 2D", ParseRenderContextOptions(argc, argv), false))
 		return EXIT_FAILURE;
-	}
-
-	glfwMakeContextCurrent(window);
-	glewExperimental = GL_TRUE;
 
-	//Verificaci�n de errores de inicializaci�n de glew
+	GLFWwindow *window = context.GetWindow();
 
-	if (GLEW_OK != glewInit()) {
-		std::cout << "Failed to initialise GLEW" << std::endl;
-		return EXIT_FAILURE;
+	// Sin ventana no hay eventos de entrada
+	if (window)
+	{
+		glfwSetFramebufferSizeCallback(window, resize);
 	}
 
 	// Imprimimos informacin de OpenGL del sistema
@@ -104,10 +88,10 @@ int main() {
 
 
 	
-	while (!glfwWindowShouldClose(window))
+	while (!context.ShouldClose())
 	{
 		// Check if any events have been activiated (key pressed, mouse moved etc.) and call corresponding response functions
-		glfwPollEvents();
+		context.PollEvents();
 
 		// Render
 		// Clear the colorbuffer
@@ -140,12 +124,12 @@ int main() {
         glBindVertexArray(0);
     
 		// Swap the screen buffers
-		glfwSwapBuffers(window);
+		context.SwapBuffers();
 	}
 
 
 
-	glfwTerminate();
+	context.Destroy();
 	return EXIT_SUCCESS;
 }
 
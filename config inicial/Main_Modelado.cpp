@@ -14,6 +14,7 @@
 
 // Shaders
 #include "Shader.h"
+#include "RenderContext.h"
 
 void Inputs(GLFWwindow* window);
 
@@ -25,41 +26,14 @@ float movZ = -5.0f;
 float rotX = 0.0f;
 float rotY = 0.0f;
 float rotZ = 0.0f;
-int main() {
-	glfwInit();
-	//Verificacin de compatibilidad 
-	// Set all the required options for GLFW
-	/*glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);*/
-
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Modelado geometrico", nullptr, nullptr);
-
-	int screenWidth, screenHeight;
-
-	glfwGetFramebufferSize(window, &screenWidth, &screenHeight);
-
-	//Verificacin de errores de creacion  ventana
-	if (nullptr == window)
-	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-
+int main(int argc, char **argv) {
+	// Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+	RenderContext context;
+	if (!context.Create(WIDTH, HEIGHT, "Modelado geometrico", ParseRenderContextOptions(argc, argv), false))
 		return EXIT_FAILURE;
-	}
-
-	glfwMakeContextCurrent(window);
-	glewExperimental = GL_TRUE;
 
-	//Verificacin de errores de inicializacin de glew
-
-	if (GLEW_OK != glewInit()) {
-		std::cout << "Failed to initialise GLEW" << std::endl;
-		return EXIT_FAILURE;
-	}
+	GLFWwindow* window = context.GetWindow();
+	int screenWidth = context.GetWidth(), screenHeight = context.GetHeight();
 
 
 	// Define las dimensiones del viewport
@@ -165,12 +139,13 @@ int main() {
 
 	projection = glm::perspective(glm::radians(45.0f), (GLfloat)screenWidth / (GLfloat)screenHeight, 0.1f, 100.0f);//FOV, Radio de aspecto,znear,zfar
 	//projection = glm::ortho(0.0f, (GLfloat)screenWidth, 0.0f, (GLfloat)screenHeight, 0.1f, 1000.0f);//Izq,Der,Fondo,Alto,Cercania,Lejania
-	while (!glfwWindowShouldClose(window))
+	while (!context.ShouldClose())
 	{
 
-		Inputs(window);
+		if (window)
+			Inputs(window);
 		// Check if any events have been activiated (key pressed, mouse moved etc.) and call corresponding response functions
-		glfwPollEvents();
+		context.PollEvents();
 
 		// Render
 		// Clear the colorbuffer
@@ -252,14 +227,14 @@ int main() {
 
 
 		// Swap the screen buffers
-		glfwSwapBuffers(window);
+		context.SwapBuffers();
 
 	}
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 
 
-	glfwTerminate();
+	context.Destroy();
 	return EXIT_SUCCESS;
 }
 
@@ -14,45 +14,18 @@
 
 // Shaders
 #include "Shader.h"
+#include "RenderContext.h"
 
 const GLint WIDTH = 800, HEIGHT = 600;
 
 
-int main() {
-	glfwInit();
-	//Verificaci�n de compatibilidad 
-	// Set all the required options for GLFW
-	/*glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);*/
-
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-
-	GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "Proyecciones y transformaciones basicas", nullptr, nullptr);
-
-	int screenWidth, screenHeight;
-
-	glfwGetFramebufferSize(window, &screenWidth, &screenHeight);
-
-	//Verificaci�n de errores de creacion  ventana
-	if (nullptr == window)
-	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-
+int main(int argc, char **argv) {
+	// Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+	RenderContext context;
+	if (!context.Create(WIDTH, HEIGHT, "Proyecciones y transformaciones basicas", ParseRenderContextOptions(argc, argv), false))
 		return EXIT_FAILURE;
-	}
-
-	glfwMakeContextCurrent(window);
-	glewExperimental = GL_TRUE;
 
-	//Verificaci�n de errores de inicializaci�n de glew
-
-	if (GLEW_OK != glewInit()) {
-		std::cout << "Failed to initialise GLEW" << std::endl;
-		return EXIT_FAILURE;
-	}
+	int screenWidth = context.GetWidth(), screenHeight = context.GetHeight();
 
 
 	// Define las dimensiones del viewport
@@ -202,10 +175,10 @@ int main() {
 
 	projection = glm::perspective(45.0f, (GLfloat)screenWidth / (GLfloat)screenHeight, 0.1f, 100.0f);//FOV, Radio de aspecto,znear,zfar
 	//projection = glm::ortho(0.0f, (GLfloat)screenWidth, 0.0f, (GLfloat)screenHeight, 0.1f, 1000.0f);//Izq,Der,Fondo,Alto,Cercania,Lejania
-	while (!glfwWindowShouldClose(window))
+	while (!context.ShouldClose())
 	{
 		// Check if any events have been activiated (key pressed, mouse moved etc.) and call corresponding response functions
-		glfwPollEvents();
+		context.PollEvents();
 
 		// Render
 		// Clear the colorbuffer
@@ -258,14 +231,14 @@ int main() {
 
 
 		// Swap the screen buffers
-		glfwSwapBuffers(window);
+		context.SwapBuffers();
 	
 	}
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 
 
-	glfwTerminate();
+	context.Destroy();
 	return EXIT_SUCCESS;
 
   
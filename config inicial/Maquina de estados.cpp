@@ -4,6 +4,8 @@
 
 #include <iostream>
 #include <cmath>
+#include <thread>
+#include <mutex>
 #include <GL/glew.h>           // Extensiones de OpenGL
 #include <GLFW/glfw3.h>        // Creación de ventanas y manejo de eventos
 #include "stb_image.h"         // Carga de imágenes (texturas)
@@ -12,8 +14,17 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "SOIL2/SOIL2.h"       // Alternativa para carga de imágenes
 #include "Shader.h"            // Clase para manejar los shaders
+#include "RenderContext.h"
+#include "FrameBenchmark.h"
 #include "Camera.h"            // Clase de cámara para navegación 3D
 #include "Model.h"             // Clase que carga y renderiza modelos OBJ
+#include "SceneGraph.h"        // Jerarquía de transformaciones con banderas de cambio
+#include "StateMachine.h"      // Máquinas de estado compiladas a tablas
+#include "FixedTimestep.h"     // Simulación a paso fijo con interpolación
+#include "FramePipeline.h"     // Hilos de actualización y render con frames en doble búfer
+#include "InputRecorder.h"     // Grabación y repetición de la entrada
+#include "Profiler.h"          // Zonas de perfilado exportables a Chrome/Perfetto
+#include "GpuTimer.h"          // Tiempos de GPU por pasada, sin esperar a la GPU
 
 // ======================================================================
 // DECLARACIÓN DE FUNCIONES
@@ -22,6 +33,8 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode
 void MouseCallback(GLFWwindow* window, double xPos, double yPos);
 void DoMovement();
 void Animation();
+void aplicarTecla(int key, int action);
+void aplicarRaton(GLfloat xOffset, GLfloat yOffset);
 
 // ======================================================================
 // VARIABLES GLOBALES
@@ -32,7 +45,6 @@ int SCREEN_WIDTH, SCREEN_HEIGHT;
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f)); // Posición inicial de la cámara
 GLfloat lastX = WIDTH / 2.0;
 GLfloat lastY = HEIGHT / 2.0;
-bool keys[1024];       // Arreglo para registrar teclas presionadas
 bool firstMouse = true;
 
 // Iluminación
@@ -67,48 +79,105 @@ float vertices[] = {
 // ======================================================================
 glm::vec3 Light1 = glm::vec3(0);
 float rotBall = 0.0f;     // Rotación de la pelota
-bool AnimBall = false;    // Control de animación de la pelota
-bool AnimDog = false;     // Control de animación del perro
 float rotDog = 0.0f;      // Rotación general del perro
-int dogAnim = 0;          // Dirección del movimiento
 float FLegs = 0.0f;       // Patas delanteras
 float RLegs = 0.0f;       // Patas traseras
 float head = 0.0f;        // Cabeza
 float tail = 0.0f;        // Cola
 glm::vec3 dogPos(0.0f);   // Posición del perro
-bool step = false;
+
+// Canales y entradas de las máquinas de estado, en el orden en que se definen
+enum { CANAL_CABEZA = 0, CANAL_COLA };
+enum { CANAL_GIRO = 0 };
+enum { ENTRADA_ANIMAR = 0 };
+
+StateMachineDefinition definirPerro();
+StateMachineDefinition definirPelota();
+
+// El comportamiento vive en tablas; cada perro o pelota es una instancia
+StateMachine perroMaquina(definirPerro());
+StateMachine pelotaMaquina(definirPelota());
+GLuint perro = perroMaquina.AddInstance();
+GLuint pelota = pelotaMaquina.AddInstance();
 
 // Control de tiempo entre frames
 GLfloat deltaTime = 0.0f;
 GLfloat lastFrame = 0.0f;
 
+// La simulación avanza a 60 Hz sin importar los FPS; se dibuja mezclando los dos últimos pasos
+FixedTimestep timestep;
+Interpolated<GLfloat> headState, tailState, ballState;
+Interpolated<glm::vec3> cameraState(glm::vec3(0.0f, 0.0f, 3.0f));
+
+// Entrada que juntan los callbacks (hilo principal) y consume el hilo de actualización
+struct EntradaFrame {
+    bool keys[1024];                              // Teclas presionadas
+    GLfloat mouseX, mouseY;                       // Desplazamiento del ratón desde la última toma
+    bool cambiarLuz, cambiarPelota, cambiarPerro; // Teclas que alternan algo, pendientes de aplicar
+    double tiempo;                                // Cuándo se muestreó, para medir la latencia
+};
+EntradaFrame entradaPendiente = {};
+EntradaFrame entrada = {};   // Copia que usa el hilo de actualización
+std::mutex entradaMutex;
+
+// Con --record guarda la entrada de cada frame; con --replay la vuelve a aplicar en los mismos pasos
+InputRecorder grabadora;
+
+// Todo lo que el render necesita para dibujar un frame; solo lo escribe el hilo de actualización
+struct EscenaFrame {
+    glm::mat4 view;
+    glm::vec3 cameraPos;
+    glm::vec3 lightColor;
+    glm::mat4 dog[7];        // Cuerpo, cabeza, cola y patas
+    glm::mat4 ball;
+};
+FramePipeline<EscenaFrame> pipeline;
+
 // ======================================================================
 // FUNCIÓN PRINCIPAL
 // ======================================================================
-int main()
+int main(int argc, char **argv)
 {
-    // Inicialización de GLFW (ventana y contexto OpenGL)
-    glfwInit();
-
-    GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Animacion maquina de estados", nullptr, nullptr);
-    if (!window) {
-        std::cout << "Error al crear la ventana GLFW" << std::endl;
-        glfwTerminate();
+    // Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+    // --benchmark archivo.json [--warmup N] [--measure N] recorre una ruta de cámara fija y mide cada frame
+    RenderContextOptions options = ParseRenderContextOptions(argc, argv);
+    FrameBenchmark benchmark("maquina_de_estados", ParseFrameBenchmarkOptions(argc, argv));
+    benchmark.Configure(options);
+
+    // --trace archivo.json guarda las zonas medidas para chrome://tracing o Perfetto
+    ProfilerOptions traza = ParseProfilerOptions(argc, argv);
+    PROFILE_THREAD("Principal");
+
+    // Las texturas se guardan comprimidas (BC1) en TextureCache/; --no-texture-cache las decodifica siempre
+    GetTextureCacheOptions() = ParseTextureCacheOptions(argc, argv);
+
+    // --glstats muestra al cerrar las llamadas a GL y los bytes subidos por frame
+    GLStatsOptions estadisticas = ParseGLStatsOptions(argc, argv);
+    // --memory muestra la memoria de CPU y GPU por subsistema cuando cambia y, al cerrar, por recurso
+    MemoryTrackerOptions memoria = ParseMemoryTrackerOptions(argc, argv);
+    GLStats glStats("maquina_de_estados");
+    GpuTimer gpuTimer;
+    // El benchmark toma el tiempo de GPU de cada frame de la zona "Frame" del temporizador
+    benchmark.SetGpuTimer(gpuTimer);
+
+    // --record archivo.inp guarda teclas y ratón; --replay archivo.inp los repite exactamente
+    if (!grabadora.Open(ParseInputRecorderOptions(argc, argv)))
         return EXIT_FAILURE;
-    }
+    grabadora.SetHandlers(aplicarTecla, aplicarRaton);
 
-    glfwMakeContextCurrent(window);
-    glfwGetFramebufferSize(window, &SCREEN_WIDTH, &SCREEN_HEIGHT);
+    RenderContext context;
+    if (!context.Create(WIDTH, HEIGHT, "Animacion maquina de estados", options, false))
+        return EXIT_FAILURE;
 
-    // Callbacks para teclado y ratón
-    glfwSetKeyCallback(window, KeyCallback);
-    glfwSetCursorPosCallback(window, MouseCallback);
+    GLFWwindow* window = context.GetWindow();
+    SCREEN_WIDTH = context.GetWidth();
+    SCREEN_HEIGHT = context.GetHeight();
 
-    // Inicializa GLEW (funciones modernas de OpenGL)
-    glewExperimental = GL_TRUE;
-    if (GLEW_OK != glewInit()) {
-        std::cout << "Error al inicializar GLEW" << std::endl;
-        return EXIT_FAILURE;
+    // Sin ventana no hay eventos de entrada
+    if (window) {
+        // Callbacks para teclado y ratón
+        glfwSetKeyCallback(window, KeyCallback);
+        glfwSetCursorPosCallback(window, MouseCallback);
     }
 
     // Configuración del área de renderizado
@@ -120,16 +189,34 @@ int main()
     Shader lightingShader("Shader/lighting.vs", "Shader/lighting.frag");
     Shader lampShader("Shader/lamp.vs", "Shader/lamp.frag");
 
-    // Modelos del perro y escenario
-    Model DogBody((char*)"Models/DogBody.obj");
-    Model HeadDog((char*)"Models/HeadDog.obj");
-    Model DogTail((char*)"Models/TailDog.obj");
-    Model F_RightLeg((char*)"Models/F_RightLegDog.obj");
-    Model F_LeftLeg((char*)"Models/F_LeftLegDog.obj");
-    Model B_RightLeg((char*)"Models/B_RightLegDog.obj");
-    Model B_LeftLeg((char*)"Models/B_LeftLegDog.obj");
-    Model Piso((char*)"Models/piso.obj");
-    Model Ball((char*)"Models/ball.obj");
+    // Modelos del perro y escenario. Sus texturas se decodifican a la vez en los hilos del JobSystem
+    // mientras se cargan los demás modelos, y se suben en el ciclo principal.
+    JobSystem jobs;
+    TextureLoader texturas(jobs);
+    Model DogBody((char*)"Models/DogBody.obj", nullptr, &texturas);
+    Model HeadDog((char*)"Models/HeadDog.obj", nullptr, &texturas);
+    Model DogTail((char*)"Models/TailDog.obj", nullptr, &texturas);
+    Model F_RightLeg((char*)"Models/F_RightLegDog.obj", nullptr, &texturas);
+    Model F_LeftLeg((char*)"Models/F_LeftLegDog.obj", nullptr, &texturas);
+    Model B_RightLeg((char*)"Models/B_RightLegDog.obj", nullptr, &texturas);
+    Model B_LeftLeg((char*)"Models/B_LeftLegDog.obj", nullptr, &texturas);
+    Model Piso((char*)"Models/piso.obj", nullptr, &texturas);
+    Model Ball((char*)"Models/ball.obj", nullptr, &texturas);
+
+    // Con --benchmark todos los frames medidos tienen ya las texturas definitivas
+    if (benchmark.IsEnabled()) {
+        texturas.Finish();
+    }
+
+    // Jerarquía del perro: cuerpo como raíz, cabeza, cola y patas como hijos
+    SceneGraph dogGraph;
+    GLuint dogBody = dogGraph.AddNode(SCENE_ROOT);
+    GLuint dogHead = dogGraph.AddNode(dogBody);
+    GLuint dogTail = dogGraph.AddNode(dogBody);
+    GLuint dogFrontLeft = dogGraph.AddNode(dogBody);
+    GLuint dogFrontRight = dogGraph.AddNode(dogBody);
+    GLuint dogBackLeft = dogGraph.AddNode(dogBody);
+    GLuint dogBackRight = dogGraph.AddNode(dogBody);
 
     // ==================================================================
     // CONFIGURACIÓN DE LOS BUFFERS PARA DIBUJAR
@@ -148,20 +235,140 @@ int main()
     glEnableVertexAttribArray(1);
 
     // ==================================================================
-    // CICLO PRINCIPAL DE RENDERIZADO
+    // HILO DE ACTUALIZACIÓN: SIMULA EL FRAME N + 1 MIENTRAS SE DIBUJA EL N
     // ==================================================================
     glm::mat4 projection = glm::perspective(camera.GetZoom(), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
+    GLuint dogNodes[] = { dogBody, dogHead, dogTail, dogFrontLeft, dogFrontRight, dogBackLeft, dogBackRight };
+
+    // Ruta de la cámara para --benchmark: da una vuelta al perro y la pelota
+    CameraPath &ruta = benchmark.GetCameraPath();
+    ruta.AddKey(0.0f, glm::vec3(0.0f, 0.5f, 3.0f), -90.0f, -10.0f);
+    ruta.AddKey(3.0f, glm::vec3(2.5f, 1.0f, 1.5f), -150.0f, -15.0f);
+    ruta.AddKey(6.0f, glm::vec3(0.0f, 1.5f, -3.0f), -270.0f, -25.0f);
+    ruta.AddKey(9.0f, glm::vec3(-2.5f, 1.0f, 1.5f), -390.0f, -15.0f);
+    ruta.AddKey(12.0f, glm::vec3(0.0f, 0.5f, 3.0f), -450.0f, -10.0f);
+
+    // Con --benchmark las animaciones se activan desde el principio, salvo que las traiga la grabación
+    if (benchmark.IsEnabled() && !grabadora.IsReplaying()) {
+        perroMaquina.SetInput(perro, ENTRADA_ANIMAR, true);
+        pelotaMaquina.SetInput(pelota, ENTRADA_ANIMAR, true);
+    }
 
-    while (!glfwWindowShouldClose(window))
-    {
-        // Calcular tiempo entre frames
-        GLfloat currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+    std::thread actualizacion([&]() {
+        PROFILE_THREAD("Actualizacion");
+
+        while (EscenaFrame* frame = pipeline.BeginUpdate())
+        {
+            PROFILE_ZONE("Update");
+            benchmark.BeginStage(FRAME_STAGE_UPDATE);
+
+            // Calcular tiempo entre frames; con --benchmark cada frame avanza exactamente un paso
+            GLfloat currentFrame = benchmark.IsEnabled() ? lastFrame + FRAME_BENCHMARK_STEP : context.GetTime();
+            deltaTime = currentFrame - lastFrame;
+
+            // Entrada acumulada desde el frame anterior
+            {
+                std::lock_guard<std::mutex> lock(entradaMutex);
+                // Grabando cierra el frame con su paso y su tiempo; repitiendo, recupera ambos y aplica sus eventos
+                grabadora.Frame(timestep.GetStepCount(), deltaTime);
+                entrada = entradaPendiente;
+                entradaPendiente.mouseX = entradaPendiente.mouseY = 0.0f;
+                entradaPendiente.cambiarLuz = entradaPendiente.cambiarPelota = entradaPendiente.cambiarPerro = false;
+            }
+
+            // Al repetir el reloj también sale de la grabación
+            if (grabadora.IsReplaying())
+                currentFrame = lastFrame + deltaTime;
+            lastFrame = currentFrame;
+
+            camera.ProcessMouseMovement(entrada.mouseX, entrada.mouseY);
+
+            if (entrada.cambiarLuz) {
+                active = !active;
+                Light1 = active ? glm::vec3(0.2f, 0.8f, 1.0f) : glm::vec3(0.0f);
+            }
+            if (entrada.cambiarPelota)
+                pelotaMaquina.SetInput(pelota, ENTRADA_ANIMAR, !pelotaMaquina.GetInput(pelota, ENTRADA_ANIMAR));
+            if (entrada.cambiarPerro)
+                perroMaquina.SetInput(perro, ENTRADA_ANIMAR, !perroMaquina.GetInput(perro, ENTRADA_ANIMAR));
+
+            // Pasos fijos de simulación que caben en el tiempo transcurrido
+            GLuint steps = timestep.Advance(deltaTime);
+            for (GLuint i = 0; i < steps; i++) {
+                DoMovement();      // Movimiento de cámara
+                Animation();       // Actualización de animaciones
+            }
+
+            // La ruta del benchmark ya es continua, no hace falta interpolar la cámara
+            if (benchmark.IsEnabled() && !grabadora.IsReplaying()) {
+                benchmark.UpdateCamera(camera, currentFrame);
+                cameraState.Reset(camera.GetPosition());
+            }
+
+            // Estado a dibujar entre el paso anterior y el último
+            GLfloat alpha = timestep.GetAlpha();
+            head = headState.Get(alpha);
+            tail = tailState.Get(alpha);
+            rotBall = ballState.Get(alpha);
+            frame->cameraPos = cameraState.Get(alpha);
+            frame->view = glm::lookAt(frame->cameraPos, frame->cameraPos + camera.GetFront(), glm::vec3(0.0f, 1.0f, 0.0f));
+
+            // Luz puntual animada
+            frame->lightColor.x = abs(sin(currentFrame * Light1.x));
+            frame->lightColor.y = abs(sin(currentFrame * Light1.y));
+            frame->lightColor.z = sin(currentFrame * Light1.z);
+
+            // Perro: las partes cuelgan del cuerpo en el grafo de escena, solo se
+            // recalculan las que cambiaron desde el frame anterior
+            glm::mat4 body = glm::translate(glm::mat4(1.0f), dogPos);
+            dogGraph.SetLocal(dogBody, glm::rotate(body, glm::radians(rotDog), glm::vec3(0.0f, 1.0f, 0.0f)));
+            dogGraph.SetLocal(dogHead, glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.093f, 0.208f)), glm::radians(head), glm::vec3(0.0f, 0.0f, 1.0f)));
+            dogGraph.SetLocal(dogTail, glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.026f, -0.288f)), glm::radians(tail), glm::vec3(0.0f, 0.0f, -1.0f)));
+            dogGraph.SetLocal(dogFrontLeft, glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.112f, -0.044f, 0.074f)), glm::radians(FLegs), glm::vec3(-1.0f, 0.0f, 0.0f)));
+            dogGraph.SetLocal(dogFrontRight, glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(-0.111f, -0.055f, 0.074f)), glm::radians(FLegs), glm::vec3(1.0f, 0.0f, 0.0f)));
+            dogGraph.SetLocal(dogBackLeft, glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.082f, -0.046f, -0.218f)), glm::radians(RLegs), glm::vec3(1.0f, 0.0f, 0.0f)));
+            dogGraph.SetLocal(dogBackRight, glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(-0.083f, -0.057f, -0.231f)), glm::radians(RLegs), glm::vec3(-1.0f, 0.0f, 0.0f)));
+            dogGraph.Update();
+
+            for (int i = 0; i < 7; i++)
+                frame->dog[i] = dogGraph.GetWorld(dogNodes[i]);
+
+            frame->ball = glm::rotate(glm::mat4(1.0f), glm::radians(rotBall), glm::vec3(0.0f, 1.0f, 0.0f));
+
+            benchmark.EndStage(FRAME_STAGE_UPDATE);
+            pipeline.EndUpdate(entrada.tiempo);
+        }
+    });
 
-        glfwPollEvents();  // Procesar entradas
-        DoMovement();      // Movimiento de cámara
-        Animation();       // Actualización de animaciones
+    // ==================================================================
+    // CICLO PRINCIPAL DE RENDERIZADO
+    // ==================================================================
+    while (!context.ShouldClose() && !benchmark.IsFinished() && !grabadora.IsFinished())
+    {
+        PROFILE_ZONE("Frame");
+        benchmark.BeginFrame();
+        glStats.BeginFrame();
+        texturas.Update();
+        context.PollEvents();  // Procesar entradas
+        {
+            std::lock_guard<std::mutex> lock(entradaMutex);
+            entradaPendiente.tiempo = FramePipelineTime();
+        }
+
+        // Frame ya simulado; el hilo de actualización prepara el siguiente mientras tanto
+        const EscenaFrame* frame = pipeline.BeginRender();
+        if (!frame)
+            break;
+
+        // Recorte por meshlets del perro y la pelota, medido aparte del envío
+        benchmark.BeginStage(FRAME_STAGE_CULL);
+        DogBody.CullMeshlets(projection, frame->view, frame->dog[0], frame->cameraPos);
+        // Es translúcida y su cara trasera se ve: solo se recortan los clusters fuera del frustum
+        Ball.CullMeshlets(projection, frame->view, frame->ball, frame->cameraPos, false);
+        benchmark.EndStage(FRAME_STAGE_CULL);
+
+        benchmark.BeginStage(FRAME_STAGE_SUBMIT);
+        gpuTimer.BeginFrame();
 
         // Limpieza del frame anterior
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -179,14 +386,12 @@ int main()
         glUniform3f(glGetUniformLocation(lightingShader.Program, "dirLight.diffuse"), 0.6f, 0.6f, 0.6f);
         glUniform3f(glGetUniformLocation(lightingShader.Program, "dirLight.specular"), 0.3f, 0.3f, 0.3f);
 
-        // Luz puntual animada
-        glm::vec3 lightColor;
-        lightColor.x = abs(sin(glfwGetTime() * Light1.x));
-        lightColor.y = abs(sin(glfwGetTime() * Light1.y));
-        lightColor.z = sin(glfwGetTime() * Light1.z);
-
         // Posición de la cámara para el shader
-        glUniform3f(glGetUniformLocation(lightingShader.Program, "viewPos"), camera.GetPosition().x, camera.GetPosition().y, camera.GetPosition().z);
+        glUniform3f(glGetUniformLocation(lightingShader.Program, "viewPos"), frame->cameraPos.x, frame->cameraPos.y, frame->cameraPos.z);
+
+        // Matrices de cámara (también se usan para el recorte por meshlets)
+        glUniformMatrix4fv(glGetUniformLocation(lightingShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(frame->view));
+        glUniformMatrix4fv(glGetUniformLocation(lightingShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
         // ==================================================================
         // RENDERIZADO DE MODELOS (SUELO, PERRO, PELOTA)
@@ -195,30 +400,66 @@ int main()
         GLint modelLoc = glGetUniformLocation(lightingShader.Program, "model");
 
         // Suelo
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        Piso.Draw(lightingShader);
-
-        // Perro: cuerpo principal
-        model = glm::translate(model, dogPos);
-        model = glm::rotate(model, glm::radians(dogRot), glm::vec3(0.0f, 1.0f, 0.0f));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        DogBody.Draw(lightingShader);
-
-        // (Cabeza, cola, patas... cada parte se transforma individualmente)
-        // ...
+        {
+            GPU_ZONE(gpuTimer, "Suelo");
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+            Piso.Draw(lightingShader);
+        }
+
+        // Perro
+        {
+            GPU_ZONE(gpuTimer, "Perro");
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(frame->dog[0]));
+            DogBody.DrawVisible(lightingShader);
+
+            Model *dogParts[] = { &HeadDog, &DogTail, &F_LeftLeg, &F_RightLeg, &B_LeftLeg, &B_RightLeg };
+            for (int i = 0; i < 6; i++) {
+                glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(frame->dog[i + 1]));
+                dogParts[i]->Draw(lightingShader);
+            }
+        }
 
         // Pelota (con transparencia activada)
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        model = glm::rotate(glm::mat4(1.0f), glm::radians(rotBall), glm::vec3(0.0f, 1.0f, 0.0f));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        Ball.Draw(lightingShader);
-        glDisable(GL_BLEND);
-
-        glfwSwapBuffers(window); // Intercambia buffers para mostrar el frame actual
+        {
+            GPU_ZONE(gpuTimer, "Pelota");
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(frame->ball));
+            Ball.DrawVisible(lightingShader);
+            glDisable(GL_BLEND);
+        }
+        gpuTimer.EndFrame();
+        benchmark.EndStage(FRAME_STAGE_SUBMIT);
+
+        context.SwapBuffers(); // Intercambia buffers para mostrar el frame actual
+        pipeline.EndRender();
+        glStats.EndFrame();
+        if (memoria.report) GetMemoryTracker().WriteFrameSummary(std::cout);
+        benchmark.EndFrame();
     }
 
-    glfwTerminate(); // Libera recursos al cerrar la ventana
+    pipeline.Stop();
+    actualizacion.join();
+    grabadora.Close();
+
+    // Latencia añadida por el pipeline: desde que se lee la entrada hasta que se muestra el frame
+    FramePipelineStats stats = pipeline.GetStats();
+    std::cout << "Frames: " << stats.frames
+              << "  latencia media: " << stats.averageLatency * 1000.0 << " ms"
+              << "  maxima: " << stats.maxLatency * 1000.0 << " ms"
+              << "  espera actualizacion: " << stats.updateWaitSeconds << " s"
+              << "  espera render: " << stats.renderWaitSeconds << " s" << std::endl;
+
+    // Los tiempos de GPU que faltan se leen antes de exportar la traza
+    gpuTimer.Destroy();
+    if (estadisticas.report) glStats.Report(std::cout);
+    if (memoria.report) GetMemoryTracker().Report(std::cout);
+    if (!traza.tracePath.empty()) GetProfiler().ExportChromeTrace(traza.tracePath);
+
+    // El anillo de subida de texturas se libera con el contexto aún activo
+    texturas.Destroy();
+
+    context.Destroy(); // Libera recursos al cerrar la ventana
     return 0;
 }
 
@@ -226,43 +467,101 @@ int main()
 // FUNCIONES DE MOVIMIENTO Y ANIMACIÓN
 // ======================================================================
 
-// Movimiento de cámara con teclado
+// Movimiento de cámara con teclado, un paso fijo de simulación (hilo de actualización)
 void DoMovement() {
-    if (keys[GLFW_KEY_W]) camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (keys[GLFW_KEY_S]) camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (keys[GLFW_KEY_A]) camera.ProcessKeyboard(LEFT, deltaTime);
-    if (keys[GLFW_KEY_D]) camera.ProcessKeyboard(RIGHT, deltaTime);
+    GLfloat step = timestep.GetStep();
+    if (entrada.keys[GLFW_KEY_W]) camera.ProcessKeyboard(FORWARD, step);
+    if (entrada.keys[GLFW_KEY_S]) camera.ProcessKeyboard(BACKWARD, step);
+    if (entrada.keys[GLFW_KEY_A]) camera.ProcessKeyboard(LEFT, step);
+    if (entrada.keys[GLFW_KEY_D]) camera.ProcessKeyboard(RIGHT, step);
+    cameraState.Set(camera.GetPosition());
 }
 
-// Teclado: activa animaciones o luces
+// Teclado: activa animaciones o luces. Solo anota la entrada; la aplica el hilo de actualización
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GL_TRUE);
 
+    // Repitiendo una grabación se ignora el teclado real
+    if (grabadora.IsReplaying())
+        return;
+
+    std::lock_guard<std::mutex> lock(entradaMutex);
+    grabadora.RecordKey(key, action);
+    aplicarTecla(key, action);
+}
+
+// Aplica una tecla a la entrada pendiente; la usan el callback y la repetición, con entradaMutex tomado
+void aplicarTecla(int key, int action) {
     if (key >= 0 && key < 1024)
-        keys[key] = (action == GLFW_PRESS);
+        entradaPendiente.keys[key] = (action == GLFW_PRESS);
 
     // Alterna luz
-    if (keys[GLFW_KEY_SPACE]) {
-        active = !active;
-        Light1 = active ? glm::vec3(0.2f, 0.8f, 1.0f) : glm::vec3(0.0f);
-    }
+    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+        entradaPendiente.cambiarLuz = !entradaPendiente.cambiarLuz;
 
     // Alterna animaciones
-    if (key == GLFW_KEY_N && action == GLFW_PRESS) AnimBall = !AnimBall;
-    if (key == GLFW_KEY_Q && action == GLFW_PRESS) AnimDog = !AnimDog;
+    if (key == GLFW_KEY_N && action == GLFW_PRESS)
+        entradaPendiente.cambiarPelota = !entradaPendiente.cambiarPelota;
+    if (key == GLFW_KEY_Q && action == GLFW_PRESS)
+        entradaPendiente.cambiarPerro = !entradaPendiente.cambiarPerro;
+}
+
+// Perro: quieto, o moviendo la cabeza de un tope al otro mientras mueve la cola.
+// Las velocidades son las de antes (0.8 y 1.2 grados por frame a 60 FPS) pasadas a grados por segundo.
+StateMachineDefinition definirPerro() {
+    const float headMax = 15.0f, headMin = -15.0f;
+    const float headSpeed = 0.8f * 60.0f, tailSpeed = 1.2f * 60.0f;
+    StateMachineDefinition def;
+
+    def.AddChannel("cabeza");
+    def.AddChannel("cola");
+    def.AddInput("animar");
+
+    GLuint quieto = def.AddState("Quieto");
+    GLuint arriba = def.AddState("CabezaArriba");
+    GLuint abajo = def.AddState("CabezaAbajo");
+
+    def.AddRate(arriba, CANAL_CABEZA, headSpeed);
+    def.AddRate(arriba, CANAL_COLA, tailSpeed);
+    def.AddRate(abajo, CANAL_CABEZA, -headSpeed);
+    def.AddRate(abajo, CANAL_COLA, -tailSpeed);
+
+    def.AddGuard(def.AddTransition(quieto, arriba), GUARD_INPUT_SET, ENTRADA_ANIMAR);
+    def.AddGuard(def.AddTransition(arriba, quieto), GUARD_INPUT_CLEAR, ENTRADA_ANIMAR);
+    def.AddGuard(def.AddTransition(abajo, quieto), GUARD_INPUT_CLEAR, ENTRADA_ANIMAR);
+    def.AddGuard(def.AddTransition(arriba, abajo), GUARD_CHANNEL_ABOVE, CANAL_CABEZA, headMax);
+    def.AddGuard(def.AddTransition(abajo, arriba), GUARD_CHANNEL_BELOW, CANAL_CABEZA, headMin);
+
+    return def;
 }
 
-// Animación del perro y pelota
+// Pelota: quieta o girando sobre Y
+StateMachineDefinition definirPelota() {
+    StateMachineDefinition def;
+
+    def.AddChannel("giro");
+    def.AddInput("animar");
+
+    GLuint quieta = def.AddState("Quieta");
+    GLuint girando = def.AddState("Girando");
+
+    def.AddRate(girando, CANAL_GIRO, 0.4f * 60.0f);
+
+    def.AddGuard(def.AddTransition(quieta, girando), GUARD_INPUT_SET, ENTRADA_ANIMAR);
+    def.AddGuard(def.AddTransition(girando, quieta), GUARD_INPUT_CLEAR, ENTRADA_ANIMAR);
+
+    return def;
+}
+
+// Animación del perro y pelota: avanza las máquinas un paso fijo y guarda el resultado para interpolarlo
 void Animation() {
-    if (AnimBall) rotBall += 0.4f;
+    perroMaquina.Tick(timestep.GetStep());
+    pelotaMaquina.Tick(timestep.GetStep());
 
-    if (AnimDog) {
-        const float headStep = 0.8f, tailStep = 1.2f, legStep = 1.2f;
-        const float headMax = 15.0f, headMin = -15.0f;
-        head += headStep * dogAnim;
-        if (head >= headMax || head <= headMin) dogAnim *= -1;
-    }
+    headState.Set(perroMaquina.GetChannel(perro, CANAL_CABEZA));
+    tailState.Set(perroMaquina.GetChannel(perro, CANAL_COLA));
+    ballState.Set(pelotaMaquina.GetChannel(pelota, CANAL_GIRO));
 }
 
 // Movimiento del ratón para controlar la cámara
@@ -276,5 +575,16 @@ void MouseCallback(GLFWwindow* window, double xPos, double yPos) {
     GLfloat yOffset = lastY - yPos; // Eje Y invertido
     lastX = xPos; lastY = yPos;
 
-    camera.ProcessMouseMovement(xOffset, yOffset);
+    if (grabadora.IsReplaying())
+        return;
+
+    std::lock_guard<std::mutex> lock(entradaMutex);
+    grabadora.RecordMouse(xOffset, yOffset);
+    aplicarRaton(xOffset, yOffset);
+}
+
+// Acumula el desplazamiento del ratón en la entrada pendiente, con entradaMutex tomado
+void aplicarRaton(GLfloat xOffset, GLfloat yOffset) {
+    entradaPendiente.mouseX += xOffset;
+    entradaPendiente.mouseY += yOffset;
 }
@@ -0,0 +1,249 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <atomic>
+
+// GL Includes
+#include <GL/glew.h>
+
+// What the memory is for
+enum MemorySubsystem
+{
+	MEMORY_MESH = 0,	// Mesh vectors on the CPU, their VBO/EBO on the GPU
+	MEMORY_TEXTURE,		// Texture objects, mip chain included
+	MEMORY_IMAGE,		// Decoded SOIL pixels waiting for their upload
+	MEMORY_ASSIMP,		// Importer scratch while a model loads
+	MEMORY_RENDERER,	// Shared buffers of BatchRenderer and GpuCuller
+	MEMORY_SUBSYSTEM_COUNT
+};
+
+const char *const MEMORY_SUBSYSTEM_NAMES[MEMORY_SUBSYSTEM_COUNT] = { "mesh", "texture", "image", "assimp", "renderer" };
+
+// Command line switch, added to the RenderContext ones:
+//   --memory  print a line whenever the footprint changes and the full report when the scene closes
+struct MemoryTrackerOptions
+{
+	bool report = false;
+};
+
+inline MemoryTrackerOptions ParseMemoryTrackerOptions(int argc, char **argv)
+{
+	MemoryTrackerOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--memory"))
+		{
+			options.report = true;
+		}
+	}
+
+	return options;
+}
+
+// GPU bytes of a texture, adding every mip level down to 1x1 when it has them. An estimate: the driver
+// may pad rows or store RGB as RGBA, which is why callers pass 4 bytes per texel for RGB8.
+inline unsigned long long EstimateTextureBytes(GLsizei width, GLsizei height, GLuint bytesPerTexel, bool mipmaps)
+{
+	unsigned long long bytes = 0;
+
+	while (true)
+	{
+		bytes += (unsigned long long)width * height * bytesPerTexel;
+
+		if (!mipmaps || (1 == width && 1 == height))
+		{
+			return bytes;
+		}
+
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+}
+
+// Bytes held by one asset in one subsystem
+struct MemoryUsage
+{
+	long long cpuBytes = 0, gpuBytes = 0;
+	long long cpuPeak = 0, gpuPeak = 0;
+};
+
+// Memory tagged by subsystem and by asset (a model or texture path, or the owner's name). Loaders call
+// Add with what they allocate and free, owners that rebuild their buffers call Set with the new size.
+// GPU bytes are what was asked for in glBufferData/glTexImage2D, not what the driver really reserves.
+// Thread safe: textures are decoded on job workers.
+class MemoryTracker
+{
+public:
+	MemoryTracker() : changed(false)
+	{
+	}
+
+	void Add(MemorySubsystem subsystem, const std::string &asset, long long cpuBytes, long long gpuBytes)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		MemoryUsage &usage = this->usage[makeKey(subsystem, asset)];
+		this->update(usage, usage.cpuBytes + cpuBytes, usage.gpuBytes + gpuBytes);
+	}
+
+	void Set(MemorySubsystem subsystem, const std::string &asset, long long cpuBytes, long long gpuBytes)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->update(this->usage[makeKey(subsystem, asset)], cpuBytes, gpuBytes);
+	}
+
+	// What an asset holds in one subsystem now and at most
+	MemoryUsage GetUsage(MemorySubsystem subsystem, const std::string &asset)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		std::map<Key, MemoryUsage>::const_iterator found = this->usage.find(makeKey(subsystem, asset));
+
+		return found != this->usage.end() ? found->second : MemoryUsage();
+	}
+
+	// Current bytes of a whole subsystem
+	MemoryUsage GetTotal(MemorySubsystem subsystem)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		MemoryUsage total;
+
+		for (std::map<Key, MemoryUsage>::const_iterator it = this->usage.begin(); it != this->usage.end(); ++it)
+		{
+			if (it->first.first == subsystem)
+			{
+				total.cpuBytes += it->second.cpuBytes;
+				total.gpuBytes += it->second.gpuBytes;
+				total.cpuPeak += it->second.cpuPeak;
+				total.gpuPeak += it->second.gpuPeak;
+			}
+		}
+
+		return total;
+	}
+
+	// One line with the totals per subsystem, only when something changed since the last call. Meant to
+	// be called once per frame.
+	bool WriteFrameSummary(std::ostream &out)
+	{
+		if (!this->changed)
+		{
+			return false;
+		}
+
+		MemoryUsage totals[MEMORY_SUBSYSTEM_COUNT];
+		long long cpu = 0, gpu = 0;
+		std::ios::fmtflags flags = out.flags();
+		std::streamsize precision = out.precision();
+		this->changed = false;
+
+		for (GLuint i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++)
+		{
+			totals[i] = this->GetTotal((MemorySubsystem)i);
+			cpu += totals[i].cpuBytes;
+			gpu += totals[i].gpuBytes;
+		}
+
+		out << std::fixed << std::setprecision(2) << "Memory: CPU " << megabytes(cpu) << " MB, GPU " << megabytes(gpu) << " MB (";
+
+		for (GLuint i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++)
+		{
+			out << (i ? ", " : "") << MEMORY_SUBSYSTEM_NAMES[i] << " " << megabytes(totals[i].cpuBytes + totals[i].gpuBytes);
+		}
+
+		out << ")" << std::endl;
+		out.flags(flags);
+		out.precision(precision);
+
+		return true;
+	}
+
+	// Every asset, largest first (current CPU + GPU bytes, then peak), with the subsystem totals
+	void Report(std::ostream &out)
+	{
+		std::vector<std::pair<Key, MemoryUsage> > rows;
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			rows.assign(this->usage.begin(), this->usage.end());
+		}
+
+		std::sort(rows.begin(), rows.end(), largerFirst);
+
+		std::ios::fmtflags flags = out.flags();
+		std::streamsize precision = out.precision();
+
+		out << std::fixed << std::setprecision(2) << "Memory by asset (MB)" << std::endl;
+		out << "  " << std::left << std::setw(10) << "subsystem" << std::right << std::setw(10) << "CPU" << std::setw(10) << "CPU peak" << std::setw(10) << "GPU" << "  asset" << std::endl;
+
+		for (GLuint i = 0; i < rows.size(); i++)
+		{
+			out << "  " << std::left << std::setw(10) << MEMORY_SUBSYSTEM_NAMES[rows[i].first.first] << std::right
+				<< std::setw(10) << megabytes(rows[i].second.cpuBytes)
+				<< std::setw(10) << megabytes(rows[i].second.cpuPeak)
+				<< std::setw(10) << megabytes(rows[i].second.gpuBytes)
+				<< "  " << rows[i].first.second << std::endl;
+		}
+
+		for (GLuint i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++)
+		{
+			MemoryUsage total = this->GetTotal((MemorySubsystem)i);
+			out << "  total " << std::left << std::setw(10) << MEMORY_SUBSYSTEM_NAMES[i] << std::right
+				<< " CPU " << megabytes(total.cpuBytes) << " (peak " << megabytes(total.cpuPeak) << "), GPU " << megabytes(total.gpuBytes) << std::endl;
+		}
+
+		out.flags(flags);
+		out.precision(precision);
+	}
+
+private:
+	typedef std::pair<GLuint, std::string> Key;
+
+	std::mutex mutex;
+	std::map<Key, MemoryUsage> usage;
+	std::atomic<bool> changed;
+
+	static Key makeKey(MemorySubsystem subsystem, const std::string &asset)
+	{
+		return std::make_pair((GLuint)subsystem, asset);
+	}
+
+	void update(MemoryUsage &usage, long long cpuBytes, long long gpuBytes)
+	{
+		this->changed = this->changed || usage.cpuBytes != cpuBytes || usage.gpuBytes != gpuBytes;
+		usage.cpuBytes = cpuBytes;
+		usage.gpuBytes = gpuBytes;
+		usage.cpuPeak = std::max(usage.cpuPeak, cpuBytes);
+		usage.gpuPeak = std::max(usage.gpuPeak, gpuBytes);
+	}
+
+	static bool largerFirst(const std::pair<Key, MemoryUsage> &a, const std::pair<Key, MemoryUsage> &b)
+	{
+		long long sizeA = a.second.cpuBytes + a.second.gpuBytes, sizeB = b.second.cpuBytes + b.second.gpuBytes;
+
+		if (sizeA != sizeB)
+		{
+			return sizeA > sizeB;
+		}
+
+		return a.second.cpuPeak + a.second.gpuPeak > b.second.cpuPeak + b.second.gpuPeak;
+	}
+
+	static double megabytes(long long bytes)
+	{
+		return bytes / (1024.0 * 1024.0);
+	}
+};
+
+inline MemoryTracker &GetMemoryTracker()
+{
+	static MemoryTracker tracker;
+	return tracker;
+}
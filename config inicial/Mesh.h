@@ -16,6 +16,7 @@
 
 
 #include "Shader.h"
+#include "Meshlet.h"
 
 using namespace std;
 
@@ -36,6 +37,51 @@ struct Texture
 	aiString path;
 };
 
+// Binds every texture to its sampler (texture_diffuseN, texture_specularN) and sets the default shininess
+inline void BindMeshTextures(GLuint program, const vector<Texture> &textures)
+{
+	// Bind appropriate textures
+	GLuint diffuseNr = 1;
+	GLuint specularNr = 1;
+
+	for (GLuint i = 0; i < textures.size(); i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + i); // Active proper texture unit before binding
+										  // Retrieve texture number (the N in diffuse_textureN)
+		stringstream ss;
+		string number;
+		string name = textures[i].type;
+
+		if (name == "texture_diffuse")
+		{
+			ss << diffuseNr++; // Transfer GLuint to stream
+		}
+		else if (name == "texture_specular")
+		{
+			ss << specularNr++; // Transfer GLuint to stream
+		}
+
+		number = ss.str();
+		// Now set the sampler to the correct texture unit
+		glUniform1i(glGetUniformLocation(program, (name + number).c_str()), i);
+		// And finally bind the texture
+		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+	}
+
+	// Also set each mesh's shininess property to a default value (if you want you could extend this to another mesh property and possibly change this value)
+	glUniform1f(glGetUniformLocation(program, "material.shininess"), 16.0f);
+}
+
+inline void UnbindMeshTextures(const vector<Texture> &textures)
+{
+	// Always good practice to set everything back to defaults once configured.
+	for (GLuint i = 0; i < textures.size(); i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
+
 class Mesh
 {
 public:
@@ -43,6 +89,11 @@ public:
 	vector<Vertex> vertices;
 	vector<GLuint> indices;
 	vector<Texture> textures;
+	vector<Meshlet> meshlets;
+
+	// Index ranges that survived the last CullMeshlets call
+	vector<GLuint> visibleFirst;
+	vector<GLsizei> visibleCount;
 
 	/*  Functions  */
 	// Constructor
@@ -52,62 +103,173 @@ public:
 		this->indices = indices;
 		this->textures = textures;
 
+		// Split the triangles in small clusters; this reorders the indices so each cluster is a contiguous range
+		if (!this->vertices.empty())
+		{
+			this->meshlets = BuildMeshlets(&this->vertices[0].Position, sizeof(Vertex), (GLuint)this->vertices.size(), this->indices);
+		}
+
 		// Now that we have all the required data, set the vertex buffers and its attribute pointers.
 		this->setupMesh();
 	}
 
+	// Constructor for geometry already split with BuildMeshlets, e.g. on a worker thread while loading
+	Mesh(vector<Vertex> vertices, vector<GLuint> indices, vector<Texture> textures, vector<Meshlet> meshlets)
+	{
+		this->vertices = vertices;
+		this->indices = indices;
+		this->textures = textures;
+		this->meshlets = meshlets;
+
+		this->setupMesh();
+	}
+
 	// Render the mesh
 	void Draw(Shader shader)
 	{
-		// Bind appropriate textures
-		GLuint diffuseNr = 1;
-		GLuint specularNr = 1;
+		PROFILE_ZONE("Mesh::Draw");
+
+		this->bindTextures(shader);
 
-		for (GLuint i = 0; i < this->textures.size(); i++)
+		// Draw mesh
+		glBindVertexArray(this->VAO);
+		glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
+		glBindVertexArray(0);
+
+		this->unbindTextures();
+	}
+
+	// Finds the meshlets inside the frustum that are not entirely back-facing and stores them,
+	// merged into contiguous ranges, in visibleFirst/visibleCount. Returns the number of ranges.
+	// Frustum and camera position must be expressed in the mesh's object space.
+	GLuint CullMeshlets(const Frustum &frustum, const glm::vec3 &cameraPosition, bool backfaceCulling = true, MeshletCullStats *stats = nullptr)
+	{
+		this->visibleFirst.clear();
+		this->visibleCount.clear();
+
+		GLuint rangeEnd = 0;
+		GLuint culledTriangles = 0;
+
+		for (GLuint i = 0; i < this->meshlets.size(); i++)
 		{
-			glActiveTexture(GL_TEXTURE0 + i); // Active proper texture unit before binding
-											  // Retrieve texture number (the N in diffuse_textureN)
-			stringstream ss;
-			string number;
-			string name = this->textures[i].type;
+			const Meshlet &meshlet = this->meshlets[i];
 
-			if (name == "texture_diffuse")
+			if (!frustum.IsSphereVisible(meshlet.center, meshlet.radius))
 			{
-				ss << diffuseNr++; // Transfer GLuint to stream
+				culledTriangles += meshlet.indexCount / 3;
+
+				if (stats)
+				{
+					stats->frustumCulled++;
+				}
+
+				continue;
 			}
-			else if (name == "texture_specular")
+
+			if (backfaceCulling && IsMeshletBackfacing(meshlet, cameraPosition))
 			{
-				ss << specularNr++; // Transfer GLuint to stream
+				culledTriangles += meshlet.indexCount / 3;
+
+				if (stats)
+				{
+					stats->backfaceCulled++;
+				}
+
+				continue;
 			}
 
-			number = ss.str();
-			// Now set the sampler to the correct texture unit
-			glUniform1i(glGetUniformLocation(shader.Program, (name + number).c_str()), i);
-			// And finally bind the texture
-			glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
+			// Consecutive survivors are merged into a single range
+			if (!this->visibleCount.empty() && rangeEnd == meshlet.firstIndex)
+			{
+				this->visibleCount.back() += meshlet.indexCount;
+			}
+			else
+			{
+				this->visibleFirst.push_back(meshlet.firstIndex);
+				this->visibleCount.push_back(meshlet.indexCount);
+			}
+
+			rangeEnd = meshlet.firstIndex + meshlet.indexCount;
 		}
 
-		// Also set each mesh's shininess property to a default value (if you want you could extend this to another mesh property and possibly change this value)
-		glUniform1f(glGetUniformLocation(shader.Program, "material.shininess"), 16.0f);
+		if (stats)
+		{
+			stats->meshlets += (GLuint)this->meshlets.size();
+			stats->trianglesCulled += culledTriangles;
+			stats->trianglesSubmitted += (GLuint)(this->indices.size() / 3) - culledTriangles;
+			stats->drawRanges += (GLuint)this->visibleCount.size();
+		}
 
-		// Draw mesh
-		glBindVertexArray(this->VAO);
-		glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+		return (GLuint)this->visibleCount.size();
+	}
+
+	// Render only the meshlets that survive CullMeshlets, all of them in one multi-draw call
+	void DrawCulled(Shader shader, const Frustum &frustum, const glm::vec3 &cameraPosition, bool backfaceCulling = true, MeshletCullStats *stats = nullptr)
+	{
+		this->CullMeshlets(frustum, cameraPosition, backfaceCulling, stats);
+		this->DrawVisible(shader);
+	}
+
+	// Render the ranges found by the last CullMeshlets call. Culling touches no GL state, so it can run
+	// on any thread and only this part has to happen on the context's thread.
+	void DrawVisible(Shader shader)
+	{
+		PROFILE_ZONE("Mesh::DrawVisible");
 
-		// Always good practice to set everything back to defaults once configured.
-		for (GLuint i = 0; i < this->textures.size(); i++)
+		if (this->visibleCount.empty())
 		{
-			glActiveTexture(GL_TEXTURE0 + i);
-			glBindTexture(GL_TEXTURE_2D, 0);
+			return;
 		}
+
+		this->drawOffsets.resize(this->visibleFirst.size());
+
+		for (GLuint i = 0; i < this->visibleFirst.size(); i++)
+		{
+			this->drawOffsets[i] = (const GLvoid *)(this->visibleFirst[i] * sizeof(GLuint));
+		}
+
+		this->bindTextures(shader);
+
+		glBindVertexArray(this->VAO);
+		glMultiDrawElements(GL_TRIANGLES, &this->visibleCount[0], GL_UNSIGNED_INT, &this->drawOffsets[0], (GLsizei)this->visibleCount.size());
+		glBindVertexArray(0);
+
+		this->unbindTextures();
+	}
+
+	// Bytes held by the mesh's vectors, culling scratch included
+	size_t GetCpuBytes() const
+	{
+		return this->vertices.capacity() * sizeof(Vertex) + this->indices.capacity() * sizeof(GLuint)
+			+ this->textures.capacity() * sizeof(Texture) + this->meshlets.capacity() * sizeof(Meshlet)
+			+ this->visibleFirst.capacity() * sizeof(GLuint) + this->visibleCount.capacity() * sizeof(GLsizei)
+			+ this->drawOffsets.capacity() * sizeof(const GLvoid *);
+	}
+
+	// Bytes uploaded to the VBO and EBO
+	size_t GetGpuBytes() const
+	{
+		return this->vertices.size() * sizeof(Vertex) + this->indices.size() * sizeof(GLuint);
 	}
 
 private:
 	/*  Render data  */
 	GLuint VAO, VBO, EBO;
 
+	// Scratch array for the multi-draw call, kept between frames to avoid reallocating
+	vector<const GLvoid *> drawOffsets;
+
 	/*  Functions    */
+	void bindTextures(Shader &shader)
+	{
+		BindMeshTextures(shader.Program, this->textures);
+	}
+
+	void unbindTextures()
+	{
+		UnbindMeshTextures(this->textures);
+	}
+
 	// Initializes all the buffer objects/arrays
 	void setupMesh()
 	{
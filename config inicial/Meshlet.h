@@ -0,0 +1,358 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <cmath>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+// Cluster limits, sized like the mesh shader friendly meshlets (64 vertices / 124 triangles)
+const GLuint MESHLET_MAX_VERTICES = 64;
+const GLuint MESHLET_MAX_TRIANGLES = 124;
+
+// Cone cutoff used for clusters whose normals spread too much to ever be rejected
+const GLfloat MESHLET_CONE_DISABLED = 2.0f;
+
+// A small cluster of triangles stored as a contiguous range of the mesh index buffer
+struct Meshlet
+{
+	// Index range inside the (reordered) element buffer
+	GLuint firstIndex;
+	GLuint indexCount;
+	GLuint vertexCount;
+
+	// Bounding sphere in object space
+	glm::vec3 center;
+	GLfloat radius;
+
+	// Normal cone: every triangle faces away from a camera for which dot(normalize(apex - camera), axis) >= cutoff
+	glm::vec3 coneApex;
+	glm::vec3 coneAxis;
+	GLfloat coneCutoff;
+};
+
+// Counters filled by the culling pass, handy to print or to feed a benchmark
+struct MeshletCullStats
+{
+	GLuint meshlets = 0;
+	GLuint frustumCulled = 0;
+	GLuint backfaceCulled = 0;
+	GLuint trianglesSubmitted = 0;
+	GLuint trianglesCulled = 0;
+	GLuint drawRanges = 0;
+};
+
+// Reads the position of vertex i from an interleaved vertex array
+inline const glm::vec3 &MeshletPosition(const GLvoid *positions, size_t stride, GLuint i)
+{
+	return *(const glm::vec3 *)((const char *)positions + stride * i);
+}
+
+// Computes the bounding sphere and the normal cone of the triangles in [first, first + count)
+inline void ComputeMeshletBounds(Meshlet &meshlet, const GLvoid *positions, size_t stride, const std::vector<GLuint> &indices)
+{
+	glm::vec3 minCorner = MeshletPosition(positions, stride, indices[meshlet.firstIndex]);
+	glm::vec3 maxCorner = minCorner;
+
+	for (GLuint i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++)
+	{
+		const glm::vec3 &p = MeshletPosition(positions, stride, indices[i]);
+		minCorner = glm::min(minCorner, p);
+		maxCorner = glm::max(maxCorner, p);
+	}
+
+	meshlet.center = (minCorner + maxCorner) * 0.5f;
+	meshlet.radius = 0.0f;
+
+	for (GLuint i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++)
+	{
+		meshlet.radius = glm::max(meshlet.radius, glm::distance(meshlet.center, MeshletPosition(positions, stride, indices[i])));
+	}
+
+	// Area weighted average of the face normals gives the cone axis
+	std::vector<glm::vec3> normals;
+	std::vector<GLuint> corners;
+	glm::vec3 axis(0.0f);
+
+	for (GLuint i = meshlet.firstIndex; i + 2 < meshlet.firstIndex + meshlet.indexCount; i += 3)
+	{
+		const glm::vec3 &p0 = MeshletPosition(positions, stride, indices[i]);
+		const glm::vec3 &p1 = MeshletPosition(positions, stride, indices[i + 1]);
+		const glm::vec3 &p2 = MeshletPosition(positions, stride, indices[i + 2]);
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		GLfloat area = glm::length(n);
+
+		if (area <= 0.0f)
+		{
+			continue; // Degenerate triangles can face anywhere, they don't constrain the cone
+		}
+
+		axis += n;
+		normals.push_back(n / area);
+		corners.push_back(indices[i]);
+	}
+
+	meshlet.coneApex = meshlet.center;
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = MESHLET_CONE_DISABLED;
+
+	GLfloat axisLength = glm::length(axis);
+
+	if (normals.empty() || axisLength <= 0.0f)
+	{
+		return;
+	}
+
+	axis = axis / axisLength;
+
+	GLfloat minDot = 1.0f;
+
+	for (GLuint i = 0; i < normals.size(); i++)
+	{
+		minDot = glm::min(minDot, glm::dot(axis, normals[i]));
+	}
+
+	// Close to a hemisphere of normals the test would hardly ever pass, keep the cluster always visible
+	if (minDot <= 0.1f)
+	{
+		return;
+	}
+
+	// Move the apex back along the axis until every triangle plane lies in front of it
+	GLfloat maxT = 0.0f;
+
+	for (GLuint i = 0; i < normals.size(); i++)
+	{
+		const glm::vec3 &p0 = MeshletPosition(positions, stride, corners[i]);
+		GLfloat dc = glm::dot(meshlet.center - p0, normals[i]);
+		GLfloat dn = glm::dot(axis, normals[i]);
+		maxT = glm::max(maxT, dc / dn);
+	}
+
+	meshlet.coneApex = meshlet.center - axis * maxT;
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+// Weight of the normal deviation against the spatial distance when choosing the next triangle.
+// Higher values give tighter normal cones (more backface rejection) at the cost of rounder clusters.
+const GLfloat MESHLET_CONE_WEIGHT = 0.5f;
+
+// Triangles bending more than ~37 degrees from the cluster's average normal start a new cluster,
+// otherwise round meshes end up with cones too wide to ever be rejected
+const GLfloat MESHLET_CONE_LIMIT = 0.8f;
+
+// Splits a triangle list into meshlets. Triangles are grown greedily from a seed over shared vertices:
+// triangles that add no new vertex are taken first, the rest are ranked by distance to the cluster and
+// by how far their normal bends from the cluster's average normal. The index buffer is rewritten so
+// every meshlet is a contiguous range; neighbouring meshlets stay neighbours, so the surviving ranges
+// can often be merged when they are drawn.
+inline std::vector<Meshlet> BuildMeshlets(const GLvoid *positions, size_t stride, GLuint vertexCount, std::vector<GLuint> &indices)
+{
+	std::vector<Meshlet> meshlets;
+	GLuint triangleCount = (GLuint)(indices.size() / 3);
+
+	if (0 == triangleCount || 0 == vertexCount)
+	{
+		return meshlets;
+	}
+
+	// Vertex -> triangle adjacency in compressed rows
+	std::vector<GLuint> adjacencyOffsets(vertexCount + 1, 0);
+	std::vector<GLuint> adjacency(triangleCount * 3);
+
+	for (GLuint i = 0; i < triangleCount * 3; i++)
+	{
+		adjacencyOffsets[indices[i] + 1]++;
+	}
+
+	for (GLuint v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+
+	std::vector<GLuint> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+	for (GLuint i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	// Per triangle centroid and unit normal used to rank the candidates
+	std::vector<glm::vec3> centroids(triangleCount);
+	std::vector<glm::vec3> normals(triangleCount);
+
+	for (GLuint t = 0; t < triangleCount; t++)
+	{
+		const glm::vec3 &p0 = MeshletPosition(positions, stride, indices[t * 3]);
+		const glm::vec3 &p1 = MeshletPosition(positions, stride, indices[t * 3 + 1]);
+		const glm::vec3 &p2 = MeshletPosition(positions, stride, indices[t * 3 + 2]);
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		GLfloat area = glm::length(n);
+
+		centroids[t] = (p0 + p1 + p2) * (1.0f / 3.0f);
+		normals[t] = (area > 0.0f) ? n / area : glm::vec3(0.0f);
+	}
+
+	std::vector<GLuint> reordered;
+	reordered.reserve(indices.size());
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<GLuint> vertexStamp(vertexCount, 0); // meshlet number + 1 that already references the vertex
+	std::vector<GLuint> candidates;
+	GLuint seedCursor = 0;
+
+	while (true)
+	{
+		while (seedCursor < triangleCount && emitted[seedCursor])
+		{
+			seedCursor++;
+		}
+
+		if (seedCursor == triangleCount)
+		{
+			break;
+		}
+
+		Meshlet meshlet;
+		meshlet.firstIndex = (GLuint)reordered.size();
+		meshlet.indexCount = 0;
+		meshlet.vertexCount = 0;
+
+		GLuint stamp = (GLuint)meshlets.size() + 1;
+		GLuint triangle = seedCursor;
+		glm::vec3 centroidSum(0.0f);
+		glm::vec3 normalSum(0.0f);
+		GLfloat extent = 0.0f;
+		candidates.clear();
+
+		while (true)
+		{
+			// Emit the chosen triangle and queue its neighbours
+			emitted[triangle] = true;
+			centroidSum += centroids[triangle];
+			normalSum += normals[triangle];
+
+			for (GLuint k = 0; k < 3; k++)
+			{
+				GLuint v = indices[triangle * 3 + k];
+				reordered.push_back(v);
+
+				if (vertexStamp[v] != stamp)
+				{
+					vertexStamp[v] = stamp;
+					meshlet.vertexCount++;
+
+					for (GLuint a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++)
+					{
+						if (!emitted[adjacency[a]])
+						{
+							candidates.push_back(adjacency[a]);
+						}
+					}
+				}
+			}
+
+			meshlet.indexCount += 3;
+
+			GLuint emittedCount = meshlet.indexCount / 3;
+
+			if (emittedCount >= MESHLET_MAX_TRIANGLES)
+			{
+				break;
+			}
+
+			glm::vec3 center = centroidSum * (1.0f / emittedCount);
+			GLfloat normalLength = glm::length(normalSum);
+			glm::vec3 axis = (normalLength > 0.0f) ? normalSum / normalLength : glm::vec3(0.0f);
+
+			// Rough cluster extent, used to make the distance term scale independent
+			extent = glm::max(extent, glm::distance(center, centroids[triangle]));
+
+			// Pick the best pending neighbour, dropping the ones already used
+			GLuint best = triangleCount;
+			GLuint bestNew = 4;
+			GLfloat bestScore = 0.0f;
+			GLuint kept = 0;
+
+			for (GLuint c = 0; c < candidates.size(); c++)
+			{
+				GLuint t = candidates[c];
+
+				if (emitted[t])
+				{
+					continue;
+				}
+
+				candidates[kept++] = t;
+
+				GLuint newVertices = 0;
+
+				for (GLuint k = 0; k < 3; k++)
+				{
+					newVertices += (vertexStamp[indices[t * 3 + k]] != stamp) ? 1 : 0;
+				}
+
+				if (meshlet.vertexCount + newVertices > MESHLET_MAX_VERTICES || glm::dot(axis, normals[t]) < MESHLET_CONE_LIMIT)
+				{
+					continue;
+				}
+
+				GLfloat score = glm::distance(center, centroids[t]) / (extent + 1e-6f) + MESHLET_CONE_WEIGHT * (1.0f - glm::dot(axis, normals[t]));
+				GLuint tier = (0 == newVertices) ? 0 : 1;
+				GLuint bestTier = (0 == bestNew) ? 0 : 1;
+
+				if (best == triangleCount || tier < bestTier || (tier == bestTier && score < bestScore))
+				{
+					best = t;
+					bestNew = newVertices;
+					bestScore = score;
+				}
+			}
+
+			candidates.resize(kept);
+
+			if (best == triangleCount)
+			{
+				break;
+			}
+
+			triangle = best;
+		}
+
+		meshlets.push_back(meshlet);
+	}
+
+	indices.swap(reordered);
+
+	for (GLuint i = 0; i < meshlets.size(); i++)
+	{
+		ComputeMeshletBounds(meshlets[i], positions, stride, indices);
+	}
+
+	return meshlets;
+}
+
+// Returns true when the whole cluster faces away from the camera (camera given in the same space as the meshlet)
+inline bool IsMeshletBackfacing(const Meshlet &meshlet, const glm::vec3 &cameraPosition)
+{
+	if (meshlet.coneCutoff >= 1.0f)
+	{
+		return false;
+	}
+
+	glm::vec3 toApex = meshlet.coneApex - cameraPosition;
+	GLfloat distance = glm::length(toApex);
+
+	if (distance <= 0.0f)
+	{
+		return false;
+	}
+
+	return glm::dot(toApex, meshlet.coneAxis) >= meshlet.coneCutoff * distance;
+}
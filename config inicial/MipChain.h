@@ -0,0 +1,465 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include "JobSystem.h"
+#include "SIMDLanes.h"
+
+// Downsampling filters
+enum MipFilter
+{
+	MIP_FILTER_BOX = 0,	// 2x2 average, what mipmap_image does
+	MIP_FILTER_KAISER	// 8x8 Kaiser windowed sinc, sharper, less aliasing
+};
+
+struct MipChainOptions
+{
+	MipFilter filter = MIP_FILTER_BOX;
+	bool srgb = false;	// Color channels are sRGB encoded: average them in linear space (alpha always is linear)
+};
+
+// Output rows per job when a level is split over a job system
+const GLuint MIP_CHAIN_JOB_ROWS = 16;
+
+// Source texels per output texel, along each axis, of the Kaiser filter; and its window's shape
+const GLuint MIP_KAISER_TAPS = 8;
+const GLfloat MIP_KAISER_BETA = 4.0f;
+
+// Buckets of the linear to sRGB table, narrower than the closest sRGB steps (the linear segment near 0)
+// so that each holds one step at most
+const GLuint MIP_SRGB_BUCKETS = 4096;
+
+// One level of the chain, interleaved as the source image
+struct MipLevel
+{
+	int width, height;
+	std::vector<unsigned char> pixels;
+};
+
+// Builds the mip chain of an image down to 1x1, every level filtered from the one before it, so the whole
+// chain costs about 4/3 of one pass over the full image (mipmap_image from the full image costs a full
+// pass per level). Levels are kept as floats between steps, in linear space when srgb is set, and only
+// rounded to bytes for the output.
+// Every filter is separable: a vertical pass over whole interleaved rows, then a horizontal one over even
+// and odd texels split apart; both run SIMDLanes at a time. With a job system the rows of each level are
+// spread over its threads. Dimensions halve rounding down, as with mipmap_image; edges are clamped.
+class MipChainBuilder
+{
+public:
+	explicit MipChainBuilder(JobSystem *jobs = nullptr, MipChainOptions options = MipChainOptions()) : jobs(jobs), options(options)
+	{
+	}
+
+	// Fills levels with level 1 onwards (level 0 is the image itself). False for an invalid image.
+	bool Build(const unsigned char *pixels, int width, int height, int channels, std::vector<MipLevel> &levels)
+	{
+		levels.clear();
+
+		if (!pixels || width < 1 || height < 1 || channels < 1 || channels > 4)
+		{
+			return false;
+		}
+
+		Source source = { pixels, nullptr, width, height, channels };
+		std::vector<GLfloat> previous, current;
+
+		while (source.width > 1 || source.height > 1)
+		{
+			MipLevel level;
+			level.width = std::max(1, source.width / 2);
+			level.height = std::max(1, source.height / 2);
+			level.pixels.resize((size_t)level.width * level.height * channels);
+
+			// The smallest level never feeds another
+			bool last = 1 == level.width && 1 == level.height;
+			current.resize(last ? 0 : (size_t)level.width * level.height * channels);
+
+			Step step = Step();
+			step.source = source;
+			step.level = &level;
+			step.floats = last ? nullptr : &current[0];
+			step.vertical = Taps(source.height, this->options.filter);
+			step.horizontal = Taps(source.width, this->options.filter);
+
+			if (this->jobs)
+			{
+				this->jobs->ParallelFor((GLuint)level.height, MIP_CHAIN_JOB_ROWS, [this, &step](GLuint begin, GLuint end, GLuint)
+				{
+					this->filterRows(step, begin, end);
+				});
+			}
+			else
+			{
+				this->filterRows(step, 0, (GLuint)level.height);
+			}
+
+			previous.swap(current);
+			source.bytes = nullptr;
+			source.floats = previous.empty() ? nullptr : &previous[0];
+			source.width = level.width;
+			source.height = level.height;
+			levels.push_back(std::move(level));
+		}
+
+		return true;
+	}
+
+private:
+	// The level being filtered: the image's bytes for level 0, the floats kept from the last step after that
+	struct Source
+	{
+		const unsigned char *bytes;
+		const GLfloat *floats;
+		int width, height, channels;
+	};
+
+	// Filter along one axis: output texel i reads source texels 2i + offset[t] (clamped), weighed by weight[t]
+	struct Taps
+	{
+		GLuint count;
+		GLint offset[MIP_KAISER_TAPS];
+		GLfloat weight[MIP_KAISER_TAPS];
+
+		Taps() : count(0) {}
+
+		Taps(int size, MipFilter filter)
+		{
+			// A side already 1 texel wide is copied
+			if (1 == size)
+			{
+				this->count = 1;
+				this->offset[0] = 0;
+				this->weight[0] = 1.0f;
+			}
+			else if (MIP_FILTER_BOX == filter)
+			{
+				this->count = 2;
+				this->offset[0] = 0;
+				this->offset[1] = 1;
+				this->weight[0] = this->weight[1] = 0.5f;
+			}
+			else
+			{
+				// sinc of half the source rate, centered between texels 2i and 2i + 1, under a Kaiser window
+				GLfloat sum = 0.0f;
+				this->count = MIP_KAISER_TAPS;
+
+				for (GLuint t = 0; t < MIP_KAISER_TAPS; t++)
+				{
+					GLint offset = (GLint)t - (GLint)MIP_KAISER_TAPS / 2 + 1;
+					double x = offset - 0.5, half = MIP_KAISER_TAPS / 2.0;
+					double sinc = std::sin(3.14159265358979 * x / 2.0) / (3.14159265358979 * x / 2.0);
+					double window = besselI0(MIP_KAISER_BETA * std::sqrt(std::max(0.0, 1.0 - (x / half) * (x / half)))) / besselI0(MIP_KAISER_BETA);
+
+					this->offset[t] = offset;
+					this->weight[t] = (GLfloat)(sinc * window);
+					sum += this->weight[t];
+				}
+
+				for (GLuint t = 0; t < MIP_KAISER_TAPS; t++)
+				{
+					this->weight[t] /= sum;
+				}
+			}
+		}
+	};
+
+	struct Step
+	{
+		Source source;
+		MipLevel *level;
+		GLfloat *floats;	// Where the level is kept for the next step, nullptr for the last one
+		Taps vertical, horizontal;
+	};
+
+	// Byte to float and back, linear values in [0, 255]
+	struct Conversion
+	{
+		GLfloat decode[256];		// sRGB to linear
+		GLfloat identity[256];		// Linear channels
+		GLfloat thresholds[256];	// Linear values where the sRGB encoding rounds up to the next byte, the last one never
+		unsigned char encode[MIP_SRGB_BUCKETS];	// sRGB byte at the start of each bucket
+
+		Conversion()
+		{
+			for (GLuint i = 0; i < 256; i++)
+			{
+				this->decode[i] = 255.0f * toLinear(i / 255.0f);
+				this->identity[i] = (GLfloat)i;
+			}
+
+			for (GLuint i = 0; i < 255; i++)
+			{
+				this->thresholds[i] = 255.0f * toLinear((i + 0.5f) / 255.0f);
+			}
+
+			this->thresholds[255] = 1e30f;
+
+			for (GLuint b = 0, encoded = 0; b < MIP_SRGB_BUCKETS; b++)
+			{
+				while (this->thresholds[encoded] <= b * 255.0f / MIP_SRGB_BUCKETS)
+				{
+					encoded++;
+				}
+
+				this->encode[b] = (unsigned char)encoded;
+			}
+		}
+
+		static GLfloat toLinear(GLfloat value)
+		{
+			return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+	};
+
+#if defined(__AVX2__)
+	typedef SIMDLanes8 Lanes;
+#elif defined(SIMD_LANES_SSE2)
+	typedef SIMDLanes4 Lanes;
+#else
+	typedef SIMDLanes1 Lanes;
+#endif
+
+	JobSystem *jobs;
+	MipChainOptions options;
+
+	static const Conversion &getConversion()
+	{
+		static Conversion conversion;
+		return conversion;
+	}
+
+	static double besselI0(double x)
+	{
+		double sum = 1.0, term = 1.0;
+
+		for (GLuint k = 1; k < 32; k++)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	// Channels averaged in linear space: color ones when srgb is set, never alpha (the last of 2 or 4)
+	bool isSRGB(int channel, int channels) const
+	{
+		return this->options.srgb && !(0 == (channels & 1) && channel == channels - 1);
+	}
+
+	void filterRows(const Step &step, GLuint begin, GLuint end) const
+	{
+		const Source &source = step.source;
+		const GLuint L = Lanes::LANES;
+		int channels = source.channels, width = step.level->width;
+		size_t sourceRow = (size_t)source.width * channels;
+
+		// Rows of level 0 converted to floats, the last few kept since the Kaiser taps of neighbouring
+		// output rows overlap
+		const GLuint cached = MIP_KAISER_TAPS;
+		std::vector<GLfloat> converted(source.bytes ? cached * sourceRow : 0);
+		GLint convertedRow[cached];
+		std::fill(convertedRow, convertedRow + cached, -1);
+
+		// Vertically filtered row, then its even and odd texels with room for the clamped edges
+		const GLint pad = (GLint)MIP_KAISER_TAPS / 4;
+		std::vector<GLfloat> filtered(sourceRow);
+		std::vector<GLfloat> even((width + 2 * pad) * channels + L), odd((width + 2 * pad) * channels + L);
+		std::vector<GLfloat> output((size_t)width * channels + L);
+
+		for (GLuint y = begin; y < end; y++)
+		{
+			// Vertical pass, over the whole interleaved row
+			const GLfloat *rows[MIP_KAISER_TAPS];
+
+			for (GLuint t = 0; t < step.vertical.count; t++)
+			{
+				GLint row = std::min(std::max((GLint)y * 2 + step.vertical.offset[t], 0), source.height - 1);
+
+				if (source.floats)
+				{
+					rows[t] = source.floats + row * sourceRow;
+				}
+				else
+				{
+					GLfloat *slot = &converted[(row % cached) * sourceRow];
+
+					if (convertedRow[row % cached] != row)
+					{
+						this->convertRow(source.bytes + row * sourceRow, source.width, channels, slot);
+						convertedRow[row % cached] = row;
+					}
+
+					rows[t] = slot;
+				}
+			}
+
+			size_t x = 0;
+
+			for (; x + L <= sourceRow; x += L)
+			{
+				Lanes sum(0.0f);
+
+				for (GLuint t = 0; t < step.vertical.count; t++)
+				{
+					sum = sum + Lanes::LoadUnaligned(rows[t] + x) * step.vertical.weight[t];
+				}
+
+				sum.StoreUnaligned(&filtered[x]);
+			}
+
+			for (; x < sourceRow; x++)
+			{
+				GLfloat sum = 0.0f;
+
+				for (GLuint t = 0; t < step.vertical.count; t++)
+				{
+					sum += rows[t][x] * step.vertical.weight[t];
+				}
+
+				filtered[x] = sum;
+			}
+
+			// Split even and odd texels (clamped past the edges): source texel 2i + offset is then
+			// even[i + offset / 2] or odd[i + (offset - 1) / 2], and a tap is one shifted run over the row
+			switch (channels)
+			{
+			case 1: splitTexels<1>(&filtered[0], source.width, width, pad, &even[0], &odd[0]); break;
+			case 2: splitTexels<2>(&filtered[0], source.width, width, pad, &even[0], &odd[0]); break;
+			case 3: splitTexels<3>(&filtered[0], source.width, width, pad, &even[0], &odd[0]); break;
+			default: splitTexels<4>(&filtered[0], source.width, width, pad, &even[0], &odd[0]); break;
+			}
+
+			size_t count = (size_t)width * channels;
+
+			for (x = 0; x < count; x += L)
+			{
+				Lanes sum(0.0f);
+
+				for (GLuint t = 0; t < step.horizontal.count; t++)
+				{
+					GLint offset = step.horizontal.offset[t];
+					const GLfloat *texels = 0 == (offset & 1) ? &even[(pad + (offset >> 1)) * channels] : &odd[(pad + ((offset - 1) >> 1)) * channels];
+
+					sum = sum + Lanes::LoadUnaligned(texels + x) * step.horizontal.weight[t];
+				}
+
+				sum.StoreUnaligned(&output[x]);
+			}
+
+			if (step.floats)
+			{
+				std::copy(output.begin(), output.begin() + count, step.floats + y * count);
+			}
+
+			this->encodeRow(&output[0], width, channels, &step.level->pixels[y * count]);
+		}
+	}
+
+	// Even and odd texels of a row into their own rows, pad texels past each edge clamped
+	template <GLint C>
+	static void splitTexels(const GLfloat *row, GLint sourceWidth, GLint width, GLint pad, GLfloat *even, GLfloat *odd)
+	{
+		GLint inside = (sourceWidth - 1) / 2;
+
+		for (GLint i = -pad; i < width + pad; i++)
+		{
+			GLint evenIndex = 2 * i, oddIndex = 2 * i + 1;
+
+			if (i < 0 || i >= inside)
+			{
+				evenIndex = std::min(std::max(evenIndex, 0), sourceWidth - 1);
+				oddIndex = std::min(std::max(oddIndex, 0), sourceWidth - 1);
+			}
+
+			for (GLint c = 0; c < C; c++)
+			{
+				even[(i + pad) * C + c] = row[evenIndex * C + c];
+				odd[(i + pad) * C + c] = row[oddIndex * C + c];
+			}
+		}
+	}
+
+	void convertRow(const unsigned char *bytes, int width, int channels, GLfloat *floats) const
+	{
+		const GLuint L = Lanes::LANES;
+		size_t count = (size_t)width * channels, i = 0;
+
+		if (!this->options.srgb)
+		{
+			for (; i + L <= count; i += L)
+			{
+				Lanes::LoadBytes(bytes + i).StoreUnaligned(floats + i);
+			}
+		}
+
+		// The rest through each channel's table, channel c being i % channels
+		const Conversion &conversion = getConversion();
+		const GLfloat *tables[4];
+
+		for (int c = 0; c < channels; c++)
+		{
+			tables[c] = this->isSRGB(c, channels) ? conversion.decode : conversion.identity;
+		}
+
+		for (int c = (int)(i % channels); i < count; i++)
+		{
+			floats[i] = tables[c][bytes[i]];
+			c = c + 1 == channels ? 0 : c + 1;
+		}
+	}
+
+	void encodeRow(const GLfloat *floats, int width, int channels, unsigned char *bytes) const
+	{
+		const Conversion &conversion = getConversion();
+		size_t count = (size_t)width * channels;
+		bool srgb[4];
+
+		for (int c = 0; c < channels; c++)
+		{
+			srgb[c] = this->isSRGB(c, channels);
+		}
+
+		const GLuint L = Lanes::LANES;
+		size_t i = 0;
+
+		for (; i + L <= count; i += L)
+		{
+			(Min(Max(Lanes::LoadUnaligned(floats + i), Lanes(0.0f)), Lanes(255.0f)) + Lanes(0.5f)).StoreBytes(bytes + i);
+		}
+
+		for (; i < count; i++)
+		{
+			bytes[i] = (unsigned char)(std::min(std::max(floats[i], 0.0f), 255.0f) + 0.5f);
+		}
+
+		if (!this->options.srgb)
+		{
+			return;
+		}
+
+		for (size_t c = (i = 0); i < count; i++, c = c + 1 == (size_t)channels ? 0 : c + 1)
+		{
+			if (srgb[c])
+			{
+				// The bucket's byte, or the next one if the value is past the step inside the bucket
+				GLfloat value = std::min(std::max(floats[i], 0.0f), 255.0f);
+				GLuint encoded = conversion.encode[std::min((GLuint)(value * (MIP_SRGB_BUCKETS / 255.0f)), MIP_SRGB_BUCKETS - 1)];
+
+				if (conversion.thresholds[encoded] <= value)
+				{
+					encoded++;
+				}
+
+				bytes[i] = (unsigned char)encoded;
+			}
+		}
+	}
+};
@@ -17,6 +17,10 @@
 
 #include "Mesh.h"
 #include  "Shader.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include "TextureLoader.h"
 
 using namespace std;
 
@@ -27,9 +31,11 @@ class Model
 public:
 	/*  Functions   */
 	// Constructor, expects a filepath to a 3D model.
-	Model(GLchar *path)
+	// With a job system the meshes are converted and their textures decoded in parallel. With a texture
+	// loader the textures are only requested: the model is ready before they are, see TextureLoader.
+	Model(GLchar *path, JobSystem *jobs = nullptr, TextureLoader *textureLoader = nullptr) : textureLoader(textureLoader)
 	{
-		this->loadModel(path);
+		this->loadModel(path, jobs);
 	}
 
 	// Draws the model, and thus all its meshes
@@ -41,16 +47,83 @@ public:
 		}
 	}
 
+	// Gives access to the meshes, e.g. to copy their geometry into a shared buffer
+	vector<Mesh> &GetMeshes()
+	{
+		return this->meshes;
+	}
+
+	// Culls the meshlets of every mesh against the view frustum and, optionally, by their normal cones;
+	// DrawVisible then draws what survived. Only valid for closed, opaque geometry when backface culling
+	// is on (the back side is never seen). Touches no GL state, so culling can be timed or run apart from
+	// the draw. With a job system the meshes are culled in parallel.
+	void CullMeshlets(const glm::mat4 &projection, const glm::mat4 &view, const glm::mat4 &model, const glm::vec3 &cameraPosition, bool backfaceCulling = true, MeshletCullStats *stats = nullptr, JobSystem *jobs = nullptr)
+	{
+		// Bring the frustum and the camera to object space once, so the clusters are tested untransformed
+		Frustum frustum(projection * view * model);
+		glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+		if (!jobs || this->meshes.size() < 2)
+		{
+			for (GLuint i = 0; i < this->meshes.size(); i++)
+			{
+				this->meshes[i].CullMeshlets(frustum, localCamera, backfaceCulling, stats);
+			}
+
+			return;
+		}
+
+		// Every mesh fills its own stats, they are added up afterwards
+		vector<MeshletCullStats> meshStats(this->meshes.size());
+
+		jobs->ParallelFor((GLuint)this->meshes.size(), 1, [&](GLuint begin, GLuint end, GLuint)
+		{
+			for (GLuint i = begin; i < end; i++)
+			{
+				this->meshes[i].CullMeshlets(frustum, localCamera, backfaceCulling, &meshStats[i]);
+			}
+		});
+
+		for (GLuint i = 0; stats && i < this->meshes.size(); i++)
+		{
+			stats->meshlets += meshStats[i].meshlets;
+			stats->frustumCulled += meshStats[i].frustumCulled;
+			stats->backfaceCulled += meshStats[i].backfaceCulled;
+			stats->trianglesSubmitted += meshStats[i].trianglesSubmitted;
+			stats->trianglesCulled += meshStats[i].trianglesCulled;
+			stats->drawRanges += meshStats[i].drawRanges;
+		}
+	}
+
+	// Draws the meshlets kept by the last CullMeshlets call, mesh by mesh in order
+	void DrawVisible(Shader shader)
+	{
+		for (GLuint i = 0; i < this->meshes.size(); i++)
+		{
+			this->meshes[i].DrawVisible(shader);
+		}
+	}
+
+	// CullMeshlets followed by DrawVisible
+	void DrawCulled(Shader shader, const glm::mat4 &projection, const glm::mat4 &view, const glm::mat4 &model, const glm::vec3 &cameraPosition, bool backfaceCulling = true, MeshletCullStats *stats = nullptr, JobSystem *jobs = nullptr)
+	{
+		this->CullMeshlets(projection, view, model, cameraPosition, backfaceCulling, stats, jobs);
+		this->DrawVisible(shader);
+	}
+
 private:
 	/*  Model Data  */
 	vector<Mesh> meshes;
 	string directory;
 	vector<Texture> textures_loaded;	// Stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+	TextureLoader *textureLoader;		// Decodes the textures in the background while loading, if set
 
 										/*  Functions   */
 										// Loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-	void loadModel(string path)
+	void loadModel(string path, JobSystem *jobs)
 	{
+		PROFILE_ZONE("Model::loadModel");
+
 		// Read file via ASSIMP
 		Assimp::Importer importer;
 		const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
@@ -61,16 +134,153 @@ private:
 			cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
 			return;
 		}
+		// Importer scratch, freed with the importer when this function returns
+		aiMemoryInfo importerMemory;
+		importer.GetMemoryRequirements(importerMemory);
+		GetMemoryTracker().Add(MEMORY_ASSIMP, path, importerMemory.total, 0);
+
 		// Retrieve the directory path of the filepath
 		this->directory = path.substr(0, path.find_last_of('/'));
 
-		// Process ASSIMP's root node recursively
-		this->processNode(scene->mRootNode, scene);
+		if (jobs)
+		{
+			this->processScene(scene, *jobs);
+		}
+		else
+		{
+			// Process ASSIMP's root node recursively
+			this->processNode(scene->mRootNode, scene);
+		}
+
+		size_t cpuBytes = 0, gpuBytes = 0;
+
+		for (GLuint i = 0; i < this->meshes.size(); i++)
+		{
+			cpuBytes += this->meshes[i].GetCpuBytes();
+			gpuBytes += this->meshes[i].GetGpuBytes();
+		}
+
+		GetMemoryTracker().Add(MEMORY_MESH, path, cpuBytes, gpuBytes);
+		GetMemoryTracker().Add(MEMORY_ASSIMP, path, -(long long)importerMemory.total, 0);
+	}
+
+	// Same result as processNode, fanned out over the job system: every mesh is converted and split in
+	// meshlets by its own job while other jobs decode the new textures. Only the GL work (creating
+	// buffers and uploading textures) is left for this thread.
+	void processScene(const aiScene *scene, JobSystem &jobs)
+	{
+		PROFILE_ZONE("Model::processScene");
+
+		vector<aiMesh *> sceneMeshes;
+		this->collectMeshes(scene->mRootNode, scene, sceneMeshes);
+
+		// Textures that no mesh of this model loaded yet, each one decoded once
+		vector<aiString> newPaths;
+		vector<string> newTypes;
+
+		for (GLuint i = 0; i < sceneMeshes.size(); i++)
+		{
+			aiMaterial *material = scene->mMaterials[sceneMeshes[i]->mMaterialIndex];
+			this->findNewTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", newPaths, newTypes);
+			this->findNewTextures(material, aiTextureType_SPECULAR, "texture_specular", newPaths, newTypes);
+		}
+
+		vector<TextureImage> images(newPaths.size());
+		vector<GLuint> requested(newPaths.size());
+		vector<vector<Vertex> > vertices(sceneMeshes.size());
+		vector<vector<GLuint> > indices(sceneMeshes.size());
+		vector<vector<Meshlet> > meshlets(sceneMeshes.size());
+		Job *root = jobs.Create([] {});
+
+		// The loader decodes on jobs of its own that nobody here waits for
+		for (GLuint i = 0; i < newPaths.size(); i++)
+		{
+			if (this->textureLoader)
+			{
+				requested[i] = this->textureLoader->Load(newPaths[i].C_Str(), this->directory);
+			}
+			else
+			{
+				jobs.Run(jobs.Create([this, i, &images, &newPaths] { images[i] = DecodeTextureFile(newPaths[i].C_Str(), this->directory); }, root));
+			}
+		}
+
+		for (GLuint i = 0; i < sceneMeshes.size(); i++)
+		{
+			jobs.Run(jobs.Create([this, i, &sceneMeshes, &vertices, &indices, &meshlets]
+			{
+				PROFILE_ZONE("Model::processMesh");
+
+				this->extractGeometry(sceneMeshes[i], vertices[i], indices[i]);
+
+				if (!vertices[i].empty())
+				{
+					meshlets[i] = BuildMeshlets(&vertices[i][0].Position, sizeof(Vertex), (GLuint)vertices[i].size(), indices[i]);
+				}
+			}, root));
+		}
+
+		jobs.Run(root);
+		jobs.Wait(root);
+
+		for (GLuint i = 0; i < newPaths.size(); i++)
+		{
+			Texture texture;
+			texture.id = this->textureLoader ? requested[i] : UploadTexture(images[i]);
+			texture.type = newTypes[i];
+			texture.path = newPaths[i];
+			this->textures_loaded.push_back(texture);
+		}
+
+		// Every texture is in textures_loaded now, so this only looks them up
+		for (GLuint i = 0; i < sceneMeshes.size(); i++)
+		{
+			this->meshes.push_back(Mesh(vertices[i], indices[i], this->processMaterial(sceneMeshes[i], scene), meshlets[i]));
+		}
+	}
+
+	// The meshes in the order processNode visits them
+	void collectMeshes(aiNode *node, const aiScene *scene, vector<aiMesh *> &sceneMeshes)
+	{
+		for (GLuint i = 0; i < node->mNumMeshes; i++)
+		{
+			sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+		}
+
+		for (GLuint i = 0; i < node->mNumChildren; i++)
+		{
+			this->collectMeshes(node->mChildren[i], scene, sceneMeshes);
+		}
+	}
+
+	// Adds the textures of the material that aren't loaded nor already in the list
+	void findNewTextures(aiMaterial *mat, aiTextureType type, string typeName, vector<aiString> &paths, vector<string> &types)
+	{
+		for (GLuint i = 0; i < mat->GetTextureCount(type); i++)
+		{
+			aiString str;
+			mat->GetTexture(type, i, &str);
+
+			bool known = std::find(paths.begin(), paths.end(), str) != paths.end();
+
+			for (GLuint j = 0; !known && j < this->textures_loaded.size(); j++)
+			{
+				known = this->textures_loaded[j].path == str;
+			}
+
+			if (!known)
+			{
+				paths.push_back(str);
+				types.push_back(typeName);
+			}
+		}
 	}
 
 	// Processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
 	void processNode(aiNode* node, const aiScene* scene)
 	{
+		PROFILE_ZONE("Model::processNode");
+
 		// Process each mesh located at the current node
 		for (GLuint i = 0; i < node->mNumMeshes; i++)
 		{
@@ -90,11 +300,21 @@ private:
 
 	Mesh processMesh(aiMesh *mesh, const aiScene *scene)
 	{
+		PROFILE_ZONE("Model::processMesh");
+
 		// Data to fill
 		vector<Vertex> vertices;
 		vector<GLuint> indices;
-		vector<Texture> textures;
 
+		this->extractGeometry(mesh, vertices, indices);
+
+		// Return a mesh object created from the extracted mesh data
+		return Mesh(vertices, indices, this->processMaterial(mesh, scene));
+	}
+
+	// Converts the vertices and faces of the mesh, touches no shared state so it can run on any thread
+	void extractGeometry(aiMesh *mesh, vector<Vertex> &vertices, vector<GLuint> &indices)
+	{
 		// Walk through each of the mesh's vertices
 		for (GLuint i = 0; i < mesh->mNumVertices; i++)
 		{
@@ -141,6 +361,11 @@ private:
 				indices.push_back(face.mIndices[j]);
 			}
 		}
+	}
+
+	vector<Texture> processMaterial(aiMesh *mesh, const aiScene *scene)
+	{
+		vector<Texture> textures;
 
 		// Process materials
 		if (mesh->mMaterialIndex >= 0)
@@ -162,8 +387,7 @@ private:
 			textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 		}
 
-		// Return a mesh object created from the extracted mesh data
-		return Mesh(vertices, indices, textures);
+		return textures;
 	}
 
 	// Checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -194,7 +418,7 @@ private:
 			if (!skip)
 			{   // If texture hasn't been loaded already, load it
 				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
+				texture.id = this->textureLoader ? this->textureLoader->Load(str.C_Str(), this->directory) : TextureFromFile(str.C_Str(), this->directory);
 				texture.type = typeName;
 				texture.path = str;
 				textures.push_back(texture);
@@ -209,28 +433,9 @@ private:
 
 GLint TextureFromFile(const char *path, string directory)
 {
-	//Generate texture ID and load texture data
-	string filename = string(path);
-	filename = directory + '/' + filename;
-	GLuint textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height;
-
-	unsigned char *image = SOIL_load_image(filename.c_str(), &width, &height, 0, SOIL_LOAD_RGB);
-
-	// Assign texture to ID
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	// Parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	SOIL_free_image_data(image);
-
-	return textureID;
-}
\ No newline at end of file
+	PROFILE_ZONE("TextureFromFile");
+
+	TextureImage image = DecodeTextureFile(path, directory);
+
+	return UploadTexture(image);
+}
@@ -8,8 +8,15 @@
 
 // Shaders
 #include "Shader.h"
+#include "RenderContext.h"
+#include "FrameBenchmark.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
+#include "SceneGraph.h"
 
 void Inputs(GLFWwindow *window);
+struct Pieza;
+glm::mat4 articulacion(const Pieza &pieza);
 
 
 const GLint WIDTH = 1200, HEIGHT = 800;
@@ -29,42 +36,41 @@ float falange2 = 0.0f;
 float dedo = 0.0f;
 float dedo2 = 0.0f;
 
-
-int main() {
-	glfwInit();
-	//Verificacin de compatibilidad 
-	// Set all the required options for GLFW
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-
-	GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "Modelado jerarquico", nullptr, nullptr);
-
-	int screenWidth, screenHeight;
-
-	glfwGetFramebufferSize(window, &screenWidth, &screenHeight);
-
-	//Verificacin de errores de creacion  ventana
-	if (nullptr == window)
-	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-
+// Pieza del brazo: articulacin = translate(antes) * rotate(angulo, eje) * translate(despues).
+// La escala solo se usa al dibujar, los hijos no la heredan (igual que modelTemp antes)
+struct Pieza {
+	GLint padre;
+	glm::vec3 antes, eje, despues, escala, color;
+	float *angulo;
+	float ultimo;
+	GLuint nodo;
+};
+
+
+int main(int argc, char **argv) {
+	// Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+	// --benchmark archivo.json [--warmup N] [--measure N] recorre una ruta de cmara fija y mide cada frame
+	RenderContextOptions options = ParseRenderContextOptions(argc, argv);
+	FrameBenchmark benchmark("modelado_jerarquico", ParseFrameBenchmarkOptions(argc, argv));
+	benchmark.Configure(options);
+
+	// --trace archivo.json guarda las zonas medidas para chrome://tracing o Perfetto
+	ProfilerOptions traza = ParseProfilerOptions(argc, argv);
+	PROFILE_THREAD("Principal");
+
+	// --glstats muestra al cerrar las llamadas a GL y los bytes subidos por frame
+	GLStatsOptions estadisticas = ParseGLStatsOptions(argc, argv);
+	GLStats glStats("modelado_jerarquico");
+	// El benchmark toma el tiempo de GPU de cada frame de la zona "Frame" del temporizador
+	GpuTimer gpuTimer;
+	benchmark.SetGpuTimer(gpuTimer);
+
+	RenderContext context;
+	if (!context.Create(WIDTH, HEIGHT, "Modelado jerarquico", options))
 		return EXIT_FAILURE;
-	}
 
-	glfwMakeContextCurrent(window);
-	glewExperimental = GL_TRUE;
-
-	//Verificacin de errores de inicializacin de glew
-
-	if (GLEW_OK != glewInit()) {
-		std::cout << "Failed to initialise GLEW" << std::endl;
-		return EXIT_FAILURE;
-	}
+	GLFWwindow *window = context.GetWindow();
+	int screenWidth = context.GetWidth(), screenHeight = context.GetHeight();
 
 
 	// Define las dimensiones del viewport
@@ -166,12 +172,45 @@ int main() {
 
 	projection = glm::perspective(glm::radians(45.0f), (GLfloat)screenWidth / (GLfloat)screenHeight, 0.1f, 100.0f);//FOV, Radio de aspecto,znear,zfar
 	glm::vec3 color= glm::vec3(0.0f, 0.0f, 1.0f);
-	while (!glfwWindowShouldClose(window))
+
+	// Cadena hombro -> codo -> mueca -> falange -> dedo -> falange2 -> dedo2, cada pieza cuelga de la anterior
+	Pieza piezas[] = {
+		{ SCENE_ROOT, glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.5f, 0.0f, 0.0f), glm::vec3(3.0f, 1.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f), &hombro },	//Bicep
+		{ 0, glm::vec3(1.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(2.0f, 1.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), &codo },	//Antebrazo
+		{ 1, glm::vec3(0.75f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.5f, 1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), &mueca },	//Mueca
+		{ 2, glm::vec3(0.01f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.2f, 0.2f), glm::vec3(1.0f, 0.15f, 0.15f), glm::vec3(0.0f, 1.0f, 1.0f), &falange },	//Falange
+		{ 3, glm::vec3(0.01f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.5f, 0.15f, 0.15f), glm::vec3(1.0f, 0.0f, 1.0f), &dedo },	//Dedo
+		{ 4, glm::vec3(0.01f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.2f, 0.2f), glm::vec3(1.0f, 0.15f, 0.15f), glm::vec3(0.0f, 1.0f, 1.0f), &falange2 },	//Falange2
+		{ 5, glm::vec3(0.01f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.5f, 0.15f, 0.15f), glm::vec3(1.0f, 0.0f, 1.0f), &dedo2 },	//Dedo2
+	};
+	const GLuint numPiezas = sizeof(piezas) / sizeof(piezas[0]);
+
+	SceneGraph brazo;
+	for (GLuint i = 0; i < numPiezas; i++) {
+		piezas[i].ultimo = *piezas[i].angulo;
+		piezas[i].nodo = brazo.AddNode(piezas[i].padre < 0 ? SCENE_ROOT : (GLint)piezas[piezas[i].padre].nodo, articulacion(piezas[i]));
+	}
+
+	// Ruta de la cmara para --benchmark: gira alrededor del brazo
+	CameraPath &ruta = benchmark.GetCameraPath();
+	ruta.AddKey(0.0f, glm::vec3(3.0f, 0.5f, 7.0f), -90.0f, 0.0f);
+	ruta.AddKey(3.0f, glm::vec3(9.0f, 2.0f, 0.5f), -180.0f, -10.0f);
+	ruta.AddKey(6.0f, glm::vec3(3.0f, 3.0f, -6.0f), -270.0f, -20.0f);
+	ruta.AddKey(9.0f, glm::vec3(-3.0f, 1.0f, 0.5f), -360.0f, -5.0f);
+	ruta.AddKey(12.0f, glm::vec3(3.0f, 0.5f, 7.0f), -450.0f, 0.0f);
+
+	while (!context.ShouldClose() && !benchmark.IsFinished())
 	{
+		PROFILE_ZONE("Frame");
+		benchmark.BeginFrame();
+		glStats.BeginFrame();
+		gpuTimer.BeginFrame();
+		benchmark.BeginStage(FRAME_STAGE_UPDATE);
 		
-		Inputs(window);
+		if (window)
+			Inputs(window);
 		// Check if any events have been activiated (key pressed, mouse moved etc.) and call corresponding response functions
-		glfwPollEvents();
+		context.PollEvents();
 
 		// Render
 		// Clear the colorbuffer
@@ -183,14 +222,13 @@ int main() {
 		ourShader.Use();
 		glm::mat4 model=glm::mat4(1);
 		glm::mat4 view=glm::mat4(1);
-		glm::mat4 modelTemp = glm::mat4(1.0f); //Temp
-		glm::mat4 modelTemp2 = glm::mat4(1.0f); //Temp
 
 
 
 		//View set up 
 		view = glm::translate(view, glm::vec3(movX,movY, movZ));
 		view = glm::rotate(view, glm::radians(rot), glm::vec3(0.0f, 1.0f, 0.0f));
+		view = benchmark.GetViewMatrix(view, benchmark.GetTime(context.GetTime()));
 		
 		GLint modelLoc = glGetUniformLocation(ourShader.Program, "model");
 		GLint viewLoc = glGetUniformLocation(ourShader.Program, "view");
@@ -203,86 +241,47 @@ int main() {
 		glUniform3fv(uniformColor, 1, glm::value_ptr(color));
 	
 
+		// Solo las articulaciones cuyo ngulo cambi se marcan, el grafo recalcula esas ramas
+		for (GLuint i = 0; i < numPiezas; i++) {
+			Pieza &pieza = piezas[i];
+			if (*pieza.angulo != pieza.ultimo) {
+				pieza.ultimo = *pieza.angulo;
+				brazo.SetLocal(pieza.nodo, articulacion(pieza));
+			}
+		}
+		brazo.Update();
+
+		benchmark.EndStage(FRAME_STAGE_UPDATE);
+		benchmark.BeginStage(FRAME_STAGE_SUBMIT);
+
 		glBindVertexArray(VAO);
-		
-		//Model Bicep
-		model = glm::rotate(model, glm::radians(hombro), glm::vec3(0.0f, 0.0, 1.0f)); //hombro
-		modelTemp = model = glm::translate(model, glm::vec3(1.5f, 0.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(3.0f, 1.0f, 1.0f));
-		color = glm::vec3(0.0f, 1.0f, 0.0f);
-		glUniform3fv(uniformColor, 1, glm::value_ptr(color));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, 36);//A
-
-		//Model Antebrazo
-		model = glm::translate(modelTemp, glm::vec3(1.5f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(codo), glm::vec3(0.0f, 0.0, 1.0f));
-		modelTemp = model = glm::translate(model, glm::vec3(1.0f, 0.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(2.0f, 1.0f, 1.0f));
-		color = glm::vec3(1.0f, 0.0f, 0.0f);
-		glUniform3fv(uniformColor, 1, glm::value_ptr(color));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, 36);//
-
-		//Model Mueca
-		model = glm::translate(modelTemp, glm::vec3(0.75f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(mueca), glm::vec3(1.0f, 0.0, 0.0f));
-		modelTemp = model = glm::translate(model, glm::vec3(0.5f, 0.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(0.5f, 1.0f, 1.0f));
-		color = glm::vec3(1.0f, 1.0f, 1.0f);
-		glUniform3fv(uniformColor, 1, glm::value_ptr(color));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, 36);//B
-
-		//Model Falange
-		model = glm::translate(modelTemp, glm::vec3(0.01f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(falange), glm::vec3(1.0f, 0.0, 0.0f));
-		modelTemp = model = glm::translate(model, glm::vec3(0.5f, 0.2f, 0.2f));
-		model = glm::scale(model, glm::vec3(1.0f, 0.15f, 0.15f));
-		color = glm::vec3(0.0f, 1.0f, 1.0f);
-		glUniform3fv(uniformColor, 1, glm::value_ptr(color));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, 36);//B
-
-		//Model Dedo
-		model = glm::translate(modelTemp, glm::vec3(0.01f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(dedo), glm::vec3(1.0f, 0.0, 0.0f));
-		modelTemp = model = glm::translate(model, glm::vec3(0.5f, 0.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(0.5f, 0.15f, 0.15f));
-		color = glm::vec3(1.0f, 0.0f, 1.0f);
-		glUniform3fv(uniformColor, 1, glm::value_ptr(color));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, 36);//B
-
-		//Model Falange2
-		model = glm::translate(modelTemp, glm::vec3(0.01f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(falange2), glm::vec3(1.0f, 0.0, 0.0f));
-		modelTemp = model = glm::translate(model, glm::vec3(0.5f, 0.2f, 0.2f));
-		model = glm::scale(model, glm::vec3(1.0f, 0.15f, 0.15f));
-		color = glm::vec3(0.0f, 1.0f, 1.0f);
-		glUniform3fv(uniformColor, 1, glm::value_ptr(color));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, 36);//B
-
-		//Model Dedo2
-		model = glm::translate(modelTemp, glm::vec3(0.01f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(dedo2), glm::vec3(1.0f, 0.0, 0.0f));
-		modelTemp = model = glm::translate(model, glm::vec3(0.5f, 0.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(0.5f, 0.15f, 0.15f));
-		color = glm::vec3(1.0f, 0.0f, 1.0f);
-		glUniform3fv(uniformColor, 1, glm::value_ptr(color));
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, 36);//B
+
+		for (GLuint i = 0; i < numPiezas; i++) {
+			model = glm::scale(brazo.GetWorld(piezas[i].nodo), piezas[i].escala);
+			glUniform3fv(uniformColor, 1, glm::value_ptr(piezas[i].color));
+			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+			glDrawArrays(GL_TRIANGLES, 0, 36);
+		}
+
+		gpuTimer.EndFrame();
+		benchmark.EndStage(FRAME_STAGE_SUBMIT);
 
 		// Swap the screen buffers
-		glfwSwapBuffers(window);
+		context.SwapBuffers();
+		glStats.EndFrame();
+		benchmark.EndFrame();
 	
 	}
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 
+	// Los tiempos de GPU que faltan se leen antes de exportar la traza
+	gpuTimer.Destroy();
+
+	if (estadisticas.report) glStats.Report(std::cout);
+	if (!traza.tracePath.empty()) GetProfiler().ExportChromeTrace(traza.tracePath);
 
-	glfwTerminate();
+	context.Destroy();
 	return EXIT_SUCCESS;
  }
 
@@ -339,4 +338,9 @@ int main() {
 		 dedo2 -= 0.18f;
  }
 
-
+ // Transformacin local de una pieza respecto a su padre
+ glm::mat4 articulacion(const Pieza &pieza) {
+	 glm::mat4 local = glm::translate(glm::mat4(1.0f), pieza.antes);
+	 local = glm::rotate(local, glm::radians(*pieza.angulo), pieza.eje);
+	 return glm::translate(local, pieza.despues);
+ }
@@ -0,0 +1,287 @@
+#pragma once
+
+// Std. Includes
+#include <deque>
+#include <mutex>
+#include <cstring>
+#include <iostream>
+
+// GL Includes
+#include <GL/glew.h>
+
+#include "GLStats.h"
+#include "MemoryTracker.h"
+
+// Staging memory shared by the uploads in flight. The largest texture the scenes load (2048x2048 RGB,
+// 12 MB) fits twice; bigger images skip the ring and are uploaded from client memory.
+const GLsizeiptr PIXEL_UPLOAD_RING_SIZE = 32 * 1024 * 1024;
+
+// Start of every region, so the copies into the ring stay on whole cache lines
+const GLsizeiptr PIXEL_UPLOAD_RING_ALIGNMENT = 64;
+
+// Part of the ring reserved for one upload
+struct PixelUploadRegion
+{
+	GLuint id;
+	GLintptr offset;
+	GLsizeiptr size;
+	void *pointer;	// Where to write the pixels when the ring is persistently mapped, nullptr otherwise
+};
+
+// Ring of staging memory in one pixel unpack buffer. glTexImage2D from client memory makes the driver
+// copy the pixels before it returns; from a bound pixel buffer it only schedules the transfer, so the
+// GL thread doesn't stall on big textures.
+// With GL 4.4 or ARB_buffer_storage the buffer is mapped once, persistently and coherently: any thread
+// can Allocate a region and write its pixels there (the decode jobs do), and the GL thread only issues the
+// upload. Without it the regions are still reserved from any thread, and Upload copies the pixels in with
+// an unsynchronized map on the GL thread.
+// Every upload is followed by a fence; Reclaim frees regions, oldest first, once the GPU passed theirs.
+class PixelUploadRing
+{
+public:
+	PixelUploadRing() : buffer(0), capacity(0), persistent(false), mapped(nullptr), head(0), firstId(0)
+	{
+	}
+
+	~PixelUploadRing()
+	{
+		this->Destroy();
+	}
+
+	// On the context's thread. False when there are no fences (GL 3.2 or ARB_sync), the ring can't be used then.
+	bool Create(GLsizeiptr size = PIXEL_UPLOAD_RING_SIZE)
+	{
+		if (!GLEW_ARB_sync && !GLEW_VERSION_3_2)
+		{
+			std::cout << "ERROR::PIXEL_UPLOAD_RING::NO_FENCES" << std::endl;
+			return false;
+		}
+
+		this->capacity = size;
+		this->persistent = (GLEW_ARB_buffer_storage || GLEW_VERSION_4_4) ? true : false;
+
+		glGenBuffers(1, &this->buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->buffer);
+
+		if (this->persistent)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+			this->mapped = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+
+			if (!this->mapped)
+			{
+				std::cout << "ERROR::PIXEL_UPLOAD_RING::MAP_FAILED" << std::endl;
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				glDeleteBuffers(1, &this->buffer);
+				this->buffer = 0;
+				return false;
+			}
+		}
+		else
+		{
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		GetMemoryTracker().Set(MEMORY_RENDERER, "PixelUploadRing", 0, size);
+
+		return true;
+	}
+
+	// Waits for the uploads in flight and frees the buffer, on the context's thread
+	void Destroy()
+	{
+		if (!this->buffer)
+		{
+			return;
+		}
+
+		for (GLuint i = 0; i < this->regions.size(); i++)
+		{
+			if (this->regions[i].sync)
+			{
+				glClientWaitSync(this->regions[i].sync, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+				glDeleteSync(this->regions[i].sync);
+			}
+		}
+
+		this->regions.clear();
+
+		if (this->mapped)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->buffer);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			this->mapped = nullptr;
+		}
+
+		glDeleteBuffers(1, &this->buffer);
+		this->buffer = 0;
+		GetMemoryTracker().Set(MEMORY_RENDERER, "PixelUploadRing", 0, 0);
+	}
+
+	bool IsCreated() const
+	{
+		return this->buffer != 0;
+	}
+
+	// Workers can write into their regions directly
+	bool IsPersistent() const
+	{
+		return this->persistent;
+	}
+
+	// Reserves size bytes, from any thread. False when the ring has no room left; Reclaim (next frame)
+	// makes room once the GPU is done with older uploads.
+	bool Allocate(GLsizeiptr size, PixelUploadRegion &region)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if (!this->buffer || size > this->capacity)
+		{
+			return false;
+		}
+
+		GLintptr offset;
+
+		if (this->regions.empty())
+		{
+			offset = 0;
+		}
+		else
+		{
+			GLintptr tail = this->regions.front().offset;
+
+			// Regions reserved and head back at the oldest one: the ring wrapped and is full, not empty
+			if (this->head == tail)
+			{
+				return false;
+			}
+
+			if (this->head > tail && this->head + size <= this->capacity)
+			{
+				offset = this->head;
+			}
+			else if (this->head > tail && size <= tail)
+			{
+				offset = 0;
+			}
+			else if (this->head < tail && this->head + size <= tail)
+			{
+				offset = this->head;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		this->head = align(offset + size);
+
+		Region reserved = { offset, nullptr, false };
+		this->regions.push_back(reserved);
+
+		region.id = this->firstId + (GLuint)this->regions.size() - 1;
+		region.offset = offset;
+		region.size = size;
+		region.pointer = this->mapped ? this->mapped + offset : nullptr;
+
+		return true;
+	}
+
+	// On the context's thread: binds the ring as the pixel unpack buffer, copies pixels into the region unless
+	// they were already written through its pointer (pass nullptr then), and returns what to give
+	// glTexImage2D as its pixels. Follow the texture calls with Submit.
+	const GLvoid *Upload(const PixelUploadRegion &region, const void *pixels)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->buffer);
+
+		if (pixels && region.pointer)
+		{
+			memcpy(region.pointer, pixels, region.size);
+		}
+		else if (pixels)
+		{
+			// The range is reserved for this upload alone, there is nothing of the GPU's to wait for
+			void *target = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, region.offset, region.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+			if (target)
+			{
+				memcpy(target, pixels, region.size);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+		}
+
+		GetFrameCounters().bytesUploaded += (unsigned long long)region.size;
+
+		return (const GLvoid *)region.offset;
+	}
+
+	// Fences the upload of the region and unbinds the ring, on the context's thread
+	void Submit(const PixelUploadRegion &region)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		Region &reserved = this->regions[region.id - this->firstId];
+		reserved.sync = sync;
+		reserved.submitted = true;
+	}
+
+	// Gives back a region that won't be uploaded
+	void Release(const PixelUploadRegion &region)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->regions[region.id - this->firstId].submitted = true;
+	}
+
+	// Frees the oldest regions whose uploads the GPU finished, never waiting. Once per frame on the context's thread.
+	void Reclaim()
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		while (!this->regions.empty() && this->regions.front().submitted)
+		{
+			Region &oldest = this->regions.front();
+
+			if (oldest.sync)
+			{
+				GLenum status = glClientWaitSync(oldest.sync, 0, 0);
+
+				if (GL_ALREADY_SIGNALED != status && GL_CONDITION_SATISFIED != status)
+				{
+					break;
+				}
+
+				glDeleteSync(oldest.sync);
+			}
+
+			this->regions.pop_front();
+			this->firstId++;
+		}
+	}
+
+private:
+	struct Region
+	{
+		GLintptr offset;
+		GLsync sync;
+		bool submitted;	// Uploaded (sync set) or released
+	};
+
+	GLuint buffer;
+	GLsizeiptr capacity;
+	bool persistent;
+	unsigned char *mapped;
+	std::mutex mutex;
+	std::deque<Region> regions;	// Reserved regions, oldest first; the one at index i has id firstId + i
+	GLintptr head;				// Where the next region goes
+	GLuint firstId;
+
+	static GLintptr align(GLintptr offset)
+	{
+		return (offset + PIXEL_UPLOAD_RING_ALIGNMENT - 1) & ~(PIXEL_UPLOAD_RING_ALIGNMENT - 1);
+	}
+};
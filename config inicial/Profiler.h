@@ -0,0 +1,360 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// GL Includes
+#include <GL/glew.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PROFILER_USE_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Zones each thread keeps; when a thread records more, the oldest ones are overwritten
+const GLuint PROFILER_RING_SIZE = 1 << 15;
+
+// Trace ids of the tracks that aren't threads (GPU timings)
+const GLuint PROFILER_TRACK_ID = 1000;
+
+// Command line switch, added to the RenderContext ones:
+//   --trace file.json  write the recorded zones as a Chrome/Perfetto trace when the scene closes
+struct ProfilerOptions
+{
+	std::string tracePath;
+};
+
+inline ProfilerOptions ParseProfilerOptions(int argc, char **argv)
+{
+	ProfilerOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--trace") && i + 1 < argc)
+		{
+			options.tracePath = argv[++i];
+		}
+	}
+
+	return options;
+}
+
+// Raw timestamp: the CPU's time stamp counter where there is one, steady_clock nanoseconds otherwise
+inline unsigned long long ProfilerTicks()
+{
+#ifdef PROFILER_USE_TSC
+	return __rdtsc();
+#else
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// One closed zone. name must outlive the profiler (a string literal).
+struct ProfilerEvent
+{
+	const char *name;
+	unsigned long long begin, end;
+};
+
+// Zones of one thread. Only the owner writes: it fills the slot and then publishes it by advancing head,
+// so recording takes no lock. The exporter copies the published range and drops whatever the owner
+// overwrote meanwhile.
+struct ProfilerThreadBuffer
+{
+	GLuint id;
+	std::string name;
+	std::atomic<unsigned long long> head;
+	ProfilerEvent events[PROFILER_RING_SIZE];
+
+	ProfilerThreadBuffer(GLuint id) : id(id), head(0)
+	{
+	}
+
+	void Push(const char *name, unsigned long long begin, unsigned long long end)
+	{
+		unsigned long long index = this->head.load(std::memory_order_relaxed);
+		ProfilerEvent &event = this->events[index & (PROFILER_RING_SIZE - 1)];
+		event.name = name;
+		event.begin = begin;
+		event.end = end;
+		this->head.store(index + 1, std::memory_order_release);
+	}
+};
+
+// A zone timed by another clock (the GPU's). begin is in microseconds after anchor, a ProfilerTicks()
+// value read at the same moment as that clock, so the exporter can place it on the CPU timeline.
+struct ProfilerTrackEvent
+{
+	const char *name;
+	unsigned long long anchor;
+	double begin, duration;
+};
+
+// Zones that don't belong to a thread, shown on a track of their own
+struct ProfilerTrack
+{
+	std::string name;
+	std::vector<ProfilerTrackEvent> events;	// Ring of PROFILER_RING_SIZE, oldest at count % size once full
+	unsigned long long count;
+};
+
+// Collects the zones of every thread and writes them as Chrome trace events ("X" complete events, one
+// track per thread) that chrome://tracing and ui.perfetto.dev open directly. Buffers are never freed,
+// so the zones of job workers and other threads that already finished are still exported.
+class Profiler
+{
+public:
+	Profiler() : originTicks(ProfilerTicks()), originTime(std::chrono::steady_clock::now())
+	{
+	}
+
+	// The calling thread's buffer, created the first time the thread records a zone
+	ProfilerThreadBuffer &GetThreadBuffer()
+	{
+		static thread_local ProfilerThreadBuffer *buffer = nullptr;
+
+		if (!buffer)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->threads.push_back(std::unique_ptr<ProfilerThreadBuffer>(new ProfilerThreadBuffer((GLuint)this->threads.size() + 1)));
+			buffer = this->threads.back().get();
+		}
+
+		return *buffer;
+	}
+
+	// Name shown for the calling thread's track
+	void SetThreadName(const char *name)
+	{
+		ProfilerThreadBuffer &buffer = this->GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(this->mutex);
+		buffer.name = name;
+	}
+
+	// Index of the track with that name, created on first use
+	GLuint GetTrack(const std::string &name)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		for (GLuint i = 0; i < this->tracks.size(); i++)
+		{
+			if (this->tracks[i].name == name)
+			{
+				return i;
+			}
+		}
+
+		ProfilerTrack track;
+		track.name = name;
+		track.count = 0;
+		this->tracks.push_back(track);
+
+		return (GLuint)this->tracks.size() - 1;
+	}
+
+	// Takes the lock: meant for a few events per frame, not for hot loops
+	void AddTrackEvent(GLuint track, const ProfilerTrackEvent &event)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		ProfilerTrack &target = this->tracks[track];
+
+		if (target.events.size() < PROFILER_RING_SIZE)
+		{
+			target.events.push_back(event);
+		}
+		else
+		{
+			target.events[target.count % PROFILER_RING_SIZE] = event;
+		}
+
+		target.count++;
+	}
+
+	bool ExportChromeTrace(const std::string &path)
+	{
+		std::ofstream file(path.c_str());
+
+		if (!file)
+		{
+			std::cout << "ERROR::PROFILER::CANNOT_WRITE " << path << std::endl;
+			return false;
+		}
+
+		double ticksPerMicrosecond = this->ticksPerMicrosecond();
+		bool first = true;
+
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		for (GLuint i = 0; i < this->threads.size(); i++)
+		{
+			ProfilerThreadBuffer &buffer = *this->threads[i];
+			std::string name = buffer.name.empty() ? "Thread " + std::to_string(buffer.id) : buffer.name;
+
+			file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.id << ",\"args\":{\"name\":";
+			writeString(file, name.c_str());
+			file << "}}";
+			first = false;
+
+			std::vector<ProfilerEvent> events;
+			this->copyEvents(buffer, events);
+
+			for (GLuint j = 0; j < events.size(); j++)
+			{
+				file << ",\n{\"name\":";
+				writeString(file, events[j].name);
+				file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.id
+					<< ",\"ts\":" << (double)(long long)(events[j].begin - this->originTicks) / ticksPerMicrosecond
+					<< ",\"dur\":" << (double)(events[j].end - events[j].begin) / ticksPerMicrosecond << "}";
+			}
+		}
+
+		// Tracks follow the threads, with ids out of the range threads get
+		for (GLuint i = 0; i < this->tracks.size(); i++)
+		{
+			const ProfilerTrack &track = this->tracks[i];
+			GLuint id = PROFILER_TRACK_ID + i;
+
+			file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << id << ",\"args\":{\"name\":";
+			writeString(file, track.name.c_str());
+			file << "}}";
+			first = false;
+
+			for (GLuint j = 0; j < track.events.size(); j++)
+			{
+				const ProfilerTrackEvent &event = track.events[j];
+
+				file << ",\n{\"name\":";
+				writeString(file, event.name);
+				file << ",\"cat\":";
+				writeString(file, track.name.c_str());
+				file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << id
+					<< ",\"ts\":" << (double)(long long)(event.anchor - this->originTicks) / ticksPerMicrosecond + event.begin
+					<< ",\"dur\":" << event.duration << "}";
+			}
+		}
+
+		file << "\n]}\n";
+
+		return true;
+	}
+
+private:
+	unsigned long long originTicks;
+	std::chrono::steady_clock::time_point originTime;
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ProfilerThreadBuffer> > threads;
+	std::vector<ProfilerTrack> tracks;
+
+	// Measured against steady_clock since the profiler started; waits a little if that was too recent to be precise
+	double ticksPerMicrosecond()
+	{
+#ifdef PROFILER_USE_TSC
+		std::chrono::steady_clock::time_point now;
+		unsigned long long ticks;
+
+		do
+		{
+			now = std::chrono::steady_clock::now();
+			ticks = ProfilerTicks();
+		} while (now - this->originTime < std::chrono::milliseconds(20));
+
+		return (double)(ticks - this->originTicks) / std::chrono::duration<double, std::micro>(now - this->originTime).count();
+#else
+		return 1000.0;
+#endif
+	}
+
+	// The published zones still in the ring, oldest first
+	static void copyEvents(const ProfilerThreadBuffer &buffer, std::vector<ProfilerEvent> &events)
+	{
+		unsigned long long head = buffer.head.load(std::memory_order_acquire);
+		unsigned long long first = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+
+		for (unsigned long long i = first; i < head; i++)
+		{
+			events.push_back(buffer.events[i & (PROFILER_RING_SIZE - 1)]);
+		}
+
+		// Slots the owner reused while they were copied hold newer zones, drop them
+		unsigned long long after = buffer.head.load(std::memory_order_acquire);
+		unsigned long long valid = after > PROFILER_RING_SIZE ? after - PROFILER_RING_SIZE : 0;
+
+		if (valid > first)
+		{
+			events.erase(events.begin(), events.begin() + (size_t)std::min(valid - first, (unsigned long long)events.size()));
+		}
+	}
+
+	static void writeString(std::ostream &out, const char *text)
+	{
+		out << '"';
+
+		for (; *text; text++)
+		{
+			if ('"' == *text || '\\' == *text)
+			{
+				out << '\\';
+			}
+
+			out << *text;
+		}
+
+		out << '"';
+	}
+};
+
+inline Profiler &GetProfiler()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+// Times the enclosing scope. Costs two time stamp reads and one store into the thread's ring.
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char *name) : name(name), begin(ProfilerTicks())
+	{
+	}
+
+	~ProfileZone()
+	{
+		unsigned long long end = ProfilerTicks();
+		GetProfiler().GetThreadBuffer().Push(this->name, this->begin, end);
+	}
+
+private:
+	const char *name;
+	unsigned long long begin;
+};
+
+// PROFILE_ZONE("name") times the rest of the scope, PROFILE_THREAD("name") labels the thread's track.
+// Release-lite builds define PROFILER_DISABLED and the markers compile to nothing.
+#define PROFILER_CONCAT_IMPL(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_IMPL(a, b)
+
+#ifdef PROFILER_DISABLED
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD(name)
+#else
+#define PROFILE_ZONE(name) ProfileZone PROFILER_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) GetProfiler().SetThreadName(name)
+#endif
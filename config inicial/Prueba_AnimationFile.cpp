@@ -0,0 +1,101 @@
+// ===============================
+// Prueba_AnimationFile.cpp - Ida y vuelta de un clip: guardar, cargar y evaluar en lote
+// ===============================
+
+// Std
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+// Animación
+#include "Animation.h"
+#include "AnimationBatch.h"
+#include "AnimationFile.h"
+
+// Variables del perro, las mismas que anima Maquina de estados / KeyFrames
+float dogPosZ = 0.0f, rotDog = 0.0f, head = 0.0f, tail = 0.0f;
+
+// Error permitido contra el clip original: la tolerancia de simplificación más la cuantización a 16 bits
+const float valueError = 0.01f, angleError = 0.2f;
+
+// Canales con ritmos distintos: al simplificar cada uno conserva otras llaves
+void buildClip(AnimationClip &clip) {
+    clip.AddChannel("dogPosZ", &dogPosZ);
+    clip.AddChannel("rotDog", &rotDog, ANIMATION_CHANNEL_ANGLE);
+    clip.AddChannel("head", &head, ANIMATION_CHANNEL_ANGLE);
+    clip.AddChannel("tail", &tail, ANIMATION_CHANNEL_ANGLE);
+
+    for (int pose = 0; pose <= 40; pose++) {
+        float t = pose * 0.05f;
+        dogPosZ = t * 0.5f;                          // Recta: quedan dos llaves
+        rotDog = t < 1.0f ? 0.0f : (t - 1.0f) * 90.0f; // Un quiebre a mitad del clip
+        head = 15.0f * sinf(t * 3.0f);
+        tail = 30.0f * sinf(t * 12.0f);              // La más rápida, la que más llaves guarda
+        clip.Capture(t);
+    }
+}
+
+// Diferencia entre ángulos, en la vuelta más corta
+float angleDifference(float a, float b) {
+    float d = fmodf(fabsf(a - b), 360.0f);
+    return d > 180.0f ? 360.0f - d : d;
+}
+
+int main() {
+    AnimationClip original;
+    buildClip(original);
+    original.SetLooping(false);
+
+    std::stringstream file;
+    AnimationClip loaded;
+    if (!SaveAnimationClip(file, original) || !LoadAnimationClip(file, loaded)) {
+        printf("no se pudo guardar o cargar el clip\n");
+        return 1;
+    }
+    loaded.SetLooping(false);
+
+    for (GLuint c = 0; c < loaded.GetChannelCount(); c++)
+        printf("%-8s %2zu llaves\n", loaded.GetChannelName(c).c_str(), loaded.GetChannel(c).GetKeyCount());
+
+    // Varias instancias desfasadas, sin bucle, hasta el final del clip
+    const GLuint instances = 20;
+    const float dt = 1.0f / 60.0f, start = loaded.GetStartTime(), end = loaded.GetEndTime();
+    AnimationBatch batch(loaded, false);
+    for (GLuint i = 0; i < instances; i++)
+        batch.AddInstance(i * 0.013f);
+
+    std::vector<float> expected(loaded.GetChannelCount()), reference(original.GetChannelCount());
+    float worstLoaded = 0.0f, worstOriginal[2] = { 0.0f, 0.0f };
+
+    for (float elapsed = dt; elapsed < end - start; elapsed += dt) {
+        batch.Update(dt);
+
+        for (GLuint i = 0; i < instances; i++) {
+            float t = start + i * 0.013f + elapsed;
+            if (t >= end)
+                continue;
+
+            loaded.Evaluate(t, &expected[0]);
+            original.Evaluate(t, &reference[0]);
+
+            for (GLuint c = 0; c < loaded.GetChannelCount(); c++) {
+                bool angle = ANIMATION_CHANNEL_ANGLE == loaded.GetChannelType(c);
+                float value = batch.GetValue(c, i);
+
+                // El lote reproduce el clip cargado, y este al original dentro de la tolerancia
+                worstLoaded = std::max(worstLoaded, angle ? angleDifference(value, expected[c]) : fabsf(value - expected[c]));
+                worstOriginal[angle] = std::max(worstOriginal[angle], angle ? angleDifference(value, reference[c]) : fabsf(value - reference[c]));
+            }
+        }
+    }
+
+    bool matchesLoaded = worstLoaded < 1e-3f;
+    bool matchesOriginal = worstOriginal[0] < valueError && worstOriginal[1] < angleError;
+
+    printf("lote contra clip cargado:  %.5f %s\n", worstLoaded, matchesLoaded ? "ok" : "FALLA");
+    printf("lote contra clip original: valores %.5f, ángulos %.5f %s\n", worstOriginal[0], worstOriginal[1], matchesOriginal ? "ok" : "FALLA");
+
+    return matchesLoaded && matchesOriginal ? 0 : 1;
+}
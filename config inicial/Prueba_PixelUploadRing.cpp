@@ -0,0 +1,83 @@
+// ===============================
+// Prueba_PixelUploadRing.cpp - El anillo de subida no pisa regiones sin subir al dar la vuelta
+// ===============================
+
+// Std
+#include <iostream>
+#include <cstdio>
+
+// GLEW
+#include <GL/glew.h>
+
+// Anillo
+#include "RenderContext.h"
+#include "PixelUploadRing.h"
+
+// Una textura de 2048x2048 RGB, la más grande que cargan las escenas
+const GLsizeiptr textureBytes = 2048 * 2048 * 3;
+
+int failures = 0;
+
+void check(bool condition, const char *what) {
+    printf("%-60s %s\n", what, condition ? "ok" : "FALLA");
+    failures += condition ? 0 : 1;
+}
+
+// Sube la región (sin textura, solo la copia y la valla) y espera a la GPU
+void submit(PixelUploadRing &ring, const PixelUploadRegion &region) {
+    ring.Upload(region, nullptr);
+    ring.Submit(region);
+    glFinish();
+}
+
+bool overlaps(const PixelUploadRegion &a, const PixelUploadRegion &b) {
+    return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+}
+
+// Con --headless no hace falta ventana
+int main(int argc, char **argv) {
+    RenderContext context;
+    if (!context.Create(64, 64, "Prueba_PixelUploadRing", ParseRenderContextOptions(argc, argv)))
+        return 1;
+
+    {
+        PixelUploadRing ring;
+        if (!ring.Create()) {
+            context.Destroy();
+            return 1;
+        }
+
+        // A y B llenan 24 de los 32 MB
+        PixelUploadRegion a, b, c, d;
+        check(ring.Allocate(textureBytes, a) && 0 == a.offset, "A en [0, 12)");
+        check(ring.Allocate(textureBytes, b) && !overlaps(a, b), "B detrás de A");
+
+        // Se sube A y se recupera; B sigue sin subir
+        submit(ring, a);
+        ring.Reclaim();
+
+        // C vuelve al principio, donde estaba A
+        check(ring.Allocate(textureBytes, c) && 0 == c.offset, "C en [0, 12) tras dar la vuelta");
+
+        // El anillo está lleno: D no cabe sin pisar B
+        bool allocated = ring.Allocate(textureBytes, d);
+        check(!allocated || (!overlaps(d, b) && !overlaps(d, c)), "D no pisa B ni C");
+        check(!allocated, "D rechazada con el anillo lleno");
+
+        // Al subir B y C hay sitio otra vez
+        if (allocated)
+            ring.Release(d);
+        submit(ring, b);
+        submit(ring, c);
+        ring.Reclaim();
+        check(ring.Allocate(textureBytes, d), "D cabe cuando B y C se recuperan");
+        ring.Release(d);
+
+        ring.Destroy();
+    }
+
+    context.Destroy();
+
+    printf("%d fallas\n", failures);
+    return failures ? 1 : 0;
+}
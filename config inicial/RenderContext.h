@@ -0,0 +1,418 @@
+#pragma once
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+
+// GL Includes
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+// Headless contexts use EGL on Linux (link with -lEGL). Run with LIBGL_ALWAYS_SOFTWARE=1 to force
+// Mesa's llvmpipe on machines without a GPU. Elsewhere headless falls back to a hidden GLFW window.
+#if defined(__linux__)
+#define RENDER_CONTEXT_EGL
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// Frames rendered in headless mode when --frames isn't given
+const GLuint RENDER_CONTEXT_DEFAULT_FRAMES = 60;
+
+// Command line switches shared by every scene:
+//   --headless       render offscreen into a framebuffer object, no window or display needed
+//   --frames N       frames to render before closing (headless only)
+//   --dump file.ppm  write the last frame to disk
+struct RenderContextOptions
+{
+	bool headless = false;
+	GLuint frames = RENDER_CONTEXT_DEFAULT_FRAMES;
+	std::string dumpPath;
+};
+
+inline RenderContextOptions ParseRenderContextOptions(int argc, char **argv)
+{
+	RenderContextOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--headless"))
+		{
+			options.headless = true;
+		}
+		else if (0 == strcmp(argv[i], "--frames") && i + 1 < argc)
+		{
+			options.frames = (GLuint)atoi(argv[++i]);
+		}
+		else if (0 == strcmp(argv[i], "--dump") && i + 1 < argc)
+		{
+			options.dumpPath = argv[++i];
+		}
+	}
+
+	return options;
+}
+
+// The window and GL context of a scene: either a normal GLFW window or, with --headless, an offscreen
+// context that renders into a framebuffer object of the same size. Scenes use this in place of the
+// glfwInit/glfwCreateWindow/glewInit sequence, keep their loop as
+//   while (!context.ShouldClose()) { context.PollEvents(); ...draw...; context.SwapBuffers(); }
+// and only install input callbacks when GetWindow() isn't null.
+class RenderContext
+{
+public:
+	RenderContext() : window(nullptr), width(0), height(0), framesRendered(0), framebuffer(0), colorBuffer(0), depthBuffer(0)
+	{
+#ifdef RENDER_CONTEXT_EGL
+		this->display = EGL_NO_DISPLAY;
+		this->context = EGL_NO_CONTEXT;
+#endif
+	}
+
+	~RenderContext()
+	{
+		this->Destroy();
+	}
+
+	// Creates the window or the offscreen context and loads the GL functions. core asks for a 3.3 core
+	// profile like most scenes do, otherwise the default (compatibility) context is used.
+	bool Create(GLuint width, GLuint height, const char *title, const RenderContextOptions &options, bool core = true)
+	{
+		this->options = options;
+		this->start = std::chrono::steady_clock::now();
+
+#ifdef RENDER_CONTEXT_EGL
+		if (options.headless)
+		{
+			if (!this->createEGL(core))
+			{
+				return false;
+			}
+		}
+		else
+#endif
+		if (!this->createWindow(width, height, title, core))
+		{
+			return false;
+		}
+
+		glewExperimental = GL_TRUE;
+		GLenum error = glewInit();
+
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+		// GLEW built for GLX loads the GL functions and then fails looking for an X display
+		if (GLEW_ERROR_NO_GLX_DISPLAY == error && !this->window)
+		{
+			error = GLEW_OK;
+		}
+#endif
+
+		if (GLEW_OK != error)
+		{
+			std::cout << "ERROR::RENDER_CONTEXT::GLEW_INIT_FAILED" << std::endl;
+			return false;
+		}
+
+		if (options.headless)
+		{
+			this->width = width;
+			this->height = height;
+
+			if (!this->createFramebuffer())
+			{
+				return false;
+			}
+		}
+		else
+		{
+			glfwGetFramebufferSize(this->window, &this->width, &this->height);
+		}
+
+		glViewport(0, 0, this->width, this->height);
+
+		return true;
+	}
+
+	// Null in headless mode
+	GLFWwindow *GetWindow() const
+	{
+		return this->options.headless ? nullptr : this->window;
+	}
+
+	bool IsHeadless() const
+	{
+		return this->options.headless;
+	}
+
+	// Framebuffer size, what glViewport and the projection aspect ratio need
+	int GetWidth() const
+	{
+		return this->width;
+	}
+
+	int GetHeight() const
+	{
+		return this->height;
+	}
+
+	GLuint GetFramesRendered() const
+	{
+		return this->framesRendered;
+	}
+
+	bool ShouldClose() const
+	{
+		if (this->options.headless)
+		{
+			return this->framesRendered >= this->options.frames;
+		}
+
+		return 0 != glfwWindowShouldClose(this->window);
+	}
+
+	void PollEvents()
+	{
+		if (!this->options.headless)
+		{
+			glfwPollEvents();
+		}
+	}
+
+	// Seconds since Create, glfwGetTime() doesn't work without GLFW
+	double GetTime() const
+	{
+		if (!this->options.headless)
+		{
+			return glfwGetTime();
+		}
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+	}
+
+	// Presents the frame. The last frame is written to the dump path, if any, before it goes away.
+	void SwapBuffers()
+	{
+		this->framesRendered++;
+
+		bool last = this->options.headless ? this->framesRendered >= this->options.frames : 0 != glfwWindowShouldClose(this->window);
+
+		if (last && !this->options.dumpPath.empty())
+		{
+			this->Dump(this->options.dumpPath);
+		}
+
+		if (this->options.headless)
+		{
+			glFinish();
+		}
+		else
+		{
+			glfwSwapBuffers(this->window);
+		}
+	}
+
+	// Writes what was drawn so far as a binary PPM
+	bool Dump(const std::string &path)
+	{
+		std::vector<unsigned char> pixels((size_t)this->width * this->height * 3);
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadBuffer(this->options.headless ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+		glReadPixels(0, 0, this->width, this->height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+		std::ofstream file(path.c_str(), std::ios::binary);
+
+		if (!file)
+		{
+			std::cout << "ERROR::RENDER_CONTEXT::DUMP_NOT_WRITTEN: " << path << std::endl;
+			return false;
+		}
+
+		file << "P6\n" << this->width << " " << this->height << "\n255\n";
+
+		// GL rows go bottom to top, PPM rows top to bottom
+		for (int y = this->height - 1; y >= 0; y--)
+		{
+			file.write((const char *)&pixels[(size_t)y * this->width * 3], this->width * 3);
+		}
+
+		return true;
+	}
+
+	void Destroy()
+	{
+		if (this->framebuffer)
+		{
+			glDeleteFramebuffers(1, &this->framebuffer);
+			glDeleteRenderbuffers(1, &this->colorBuffer);
+			glDeleteRenderbuffers(1, &this->depthBuffer);
+			this->framebuffer = 0;
+		}
+
+#ifdef RENDER_CONTEXT_EGL
+		if (this->display != EGL_NO_DISPLAY)
+		{
+			eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+			if (this->context != EGL_NO_CONTEXT)
+			{
+				eglDestroyContext(this->display, this->context);
+			}
+
+			eglTerminate(this->display);
+			this->display = EGL_NO_DISPLAY;
+			this->context = EGL_NO_CONTEXT;
+		}
+#endif
+
+		if (this->window)
+		{
+			glfwTerminate();
+			this->window = nullptr;
+		}
+	}
+
+private:
+	RenderContextOptions options;
+	GLFWwindow *window;
+	int width, height;
+	GLuint framesRendered;
+	GLuint framebuffer, colorBuffer, depthBuffer;
+	std::chrono::steady_clock::time_point start;
+
+#ifdef RENDER_CONTEXT_EGL
+	EGLDisplay display;
+	EGLContext context;
+
+	// Surfaceless Mesa display when available (no X, no DRM device needed), the default one otherwise
+	bool createEGL(bool core)
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+		if (getPlatformDisplay)
+		{
+			this->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+
+		if (this->display == EGL_NO_DISPLAY)
+		{
+			this->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+
+		if (this->display == EGL_NO_DISPLAY || !eglInitialize(this->display, nullptr, nullptr))
+		{
+			std::cout << "ERROR::RENDER_CONTEXT::EGL_DISPLAY_NOT_AVAILABLE" << std::endl;
+			this->display = EGL_NO_DISPLAY;
+			return false;
+		}
+
+		// The default surface type is window, which surfaceless displays don't have
+		const EGLint configAttributes[] =
+		{
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE
+		};
+
+		EGLConfig config;
+		EGLint configCount = 0;
+
+		if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(this->display, configAttributes, &config, 1, &configCount) || 0 == configCount)
+		{
+			std::cout << "ERROR::RENDER_CONTEXT::EGL_NO_OPENGL_CONFIG" << std::endl;
+			return false;
+		}
+
+		const EGLint coreAttributes[] =
+		{
+			EGL_CONTEXT_MAJOR_VERSION, 3,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+
+		this->context = eglCreateContext(this->display, config, EGL_NO_CONTEXT, core ? coreAttributes : nullptr);
+
+		// No surface at all: everything is drawn into the framebuffer object
+		if (this->context == EGL_NO_CONTEXT || !eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, this->context))
+		{
+			std::cout << "ERROR::RENDER_CONTEXT::EGL_CONTEXT_NOT_CREATED" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+#endif
+
+	// Also used for headless runs where EGL isn't available, with the window kept hidden
+	bool createWindow(GLuint width, GLuint height, const char *title, bool core)
+	{
+		if (!glfwInit())
+		{
+			std::cout << "ERROR::RENDER_CONTEXT::GLFW_INIT_FAILED" << std::endl;
+			return false;
+		}
+
+		if (core)
+		{
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+			glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+			glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+		}
+
+		glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+
+		if (this->options.headless)
+		{
+			glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+		}
+
+		this->window = glfwCreateWindow(width, height, title, nullptr, nullptr);
+
+		if (!this->window)
+		{
+			std::cout << "ERROR::RENDER_CONTEXT::WINDOW_NOT_CREATED" << std::endl;
+			glfwTerminate();
+			return false;
+		}
+
+		glfwMakeContextCurrent(this->window);
+
+		return true;
+	}
+
+	// Color and depth/stencil renderbuffers, left bound so the scenes draw into them unchanged
+	bool createFramebuffer()
+	{
+		glGenFramebuffers(1, &this->framebuffer);
+		glGenRenderbuffers(1, &this->colorBuffer);
+		glGenRenderbuffers(1, &this->depthBuffer);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, this->colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, this->width, this->height);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, this->width, this->height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR::RENDER_CONTEXT::FRAMEBUFFER_INCOMPLETE" << std::endl;
+			return false;
+		}
+
+		glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+		return true;
+	}
+};
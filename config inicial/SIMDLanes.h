@@ -0,0 +1,125 @@
+#pragma once
+
+// Std. Includes
+#include <algorithm>
+#include <cstring>
+
+// SIMD Includes
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_LANES_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// GL Includes
+#include <GL/glew.h>
+
+// Float lanes for kernels written once, as templates over these: plain floats, 4 lanes in an SSE2
+// register, 8 in an AVX register. Comparisons give masks for Select, 1/0 in the scalar version and all
+// bits set/clear in the SIMD ones. StoreBytes truncates, for values already in [0, 255]. SSE2 is always
+// there on x64, AVX2 needs /arch:AVX2 in MSVC.
+struct SIMDLanes1
+{
+	static const GLuint LANES = 1;
+	GLfloat v;
+
+	SIMDLanes1() {}
+	SIMDLanes1(GLfloat v) : v(v) {}
+
+	static SIMDLanes1 Load(const GLfloat *source) { return SIMDLanes1(*source); }
+	static SIMDLanes1 LoadUnaligned(const GLfloat *source) { return SIMDLanes1(*source); }
+	static SIMDLanes1 LoadBytes(const unsigned char *source) { return SIMDLanes1((GLfloat)*source); }
+	void Store(GLfloat *target) const { *target = this->v; }
+	void StoreUnaligned(GLfloat *target) const { *target = this->v; }
+	void StoreBytes(unsigned char *target) const { *target = (unsigned char)(GLint)this->v; }
+};
+
+inline SIMDLanes1 operator+(SIMDLanes1 a, SIMDLanes1 b) { return SIMDLanes1(a.v + b.v); }
+inline SIMDLanes1 operator-(SIMDLanes1 a, SIMDLanes1 b) { return SIMDLanes1(a.v - b.v); }
+inline SIMDLanes1 operator*(SIMDLanes1 a, SIMDLanes1 b) { return SIMDLanes1(a.v * b.v); }
+inline SIMDLanes1 operator/(SIMDLanes1 a, SIMDLanes1 b) { return SIMDLanes1(a.v / b.v); }
+inline SIMDLanes1 Min(SIMDLanes1 a, SIMDLanes1 b) { return SIMDLanes1(std::min(a.v, b.v)); }
+inline SIMDLanes1 Max(SIMDLanes1 a, SIMDLanes1 b) { return SIMDLanes1(std::max(a.v, b.v)); }
+inline SIMDLanes1 Less(SIMDLanes1 a, SIMDLanes1 b) { return SIMDLanes1(a.v < b.v ? 1.0f : 0.0f); }
+inline SIMDLanes1 Equal(SIMDLanes1 a, SIMDLanes1 b) { return SIMDLanes1(a.v == b.v ? 1.0f : 0.0f); }
+inline SIMDLanes1 Select(SIMDLanes1 mask, SIMDLanes1 a, SIMDLanes1 b) { return mask.v != 0.0f ? a : b; }
+inline SIMDLanes1 Truncate(SIMDLanes1 a) { return SIMDLanes1((GLfloat)(GLint)a.v); }
+
+#if defined(SIMD_LANES_SSE2)
+struct SIMDLanes4
+{
+	static const GLuint LANES = 4;
+	__m128 v;
+
+	SIMDLanes4() {}
+	SIMDLanes4(__m128 v) : v(v) {}
+	SIMDLanes4(GLfloat f) : v(_mm_set1_ps(f)) {}
+
+	static SIMDLanes4 Load(const GLfloat *source) { return SIMDLanes4(_mm_load_ps(source)); }
+	static SIMDLanes4 LoadUnaligned(const GLfloat *source) { return SIMDLanes4(_mm_loadu_ps(source)); }
+	static SIMDLanes4 LoadBytes(const unsigned char *source)
+	{
+		// Rows of any width end at any byte, so the 4 bytes go through memcpy rather than an int pointer
+		int packed;
+		memcpy(&packed, source, sizeof(packed));
+		__m128i zero = _mm_setzero_si128(), bytes = _mm_cvtsi32_si128(packed);
+		return SIMDLanes4(_mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero)));
+	}
+	void Store(GLfloat *target) const { _mm_store_ps(target, this->v); }
+	void StoreUnaligned(GLfloat *target) const { _mm_storeu_ps(target, this->v); }
+	void StoreBytes(unsigned char *target) const
+	{
+		__m128i words = _mm_packs_epi32(_mm_cvttps_epi32(this->v), _mm_setzero_si128());
+		int packed = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+		memcpy(target, &packed, sizeof(packed));
+	}
+};
+
+inline SIMDLanes4 operator+(SIMDLanes4 a, SIMDLanes4 b) { return SIMDLanes4(_mm_add_ps(a.v, b.v)); }
+inline SIMDLanes4 operator-(SIMDLanes4 a, SIMDLanes4 b) { return SIMDLanes4(_mm_sub_ps(a.v, b.v)); }
+inline SIMDLanes4 operator*(SIMDLanes4 a, SIMDLanes4 b) { return SIMDLanes4(_mm_mul_ps(a.v, b.v)); }
+inline SIMDLanes4 operator/(SIMDLanes4 a, SIMDLanes4 b) { return SIMDLanes4(_mm_div_ps(a.v, b.v)); }
+inline SIMDLanes4 Min(SIMDLanes4 a, SIMDLanes4 b) { return SIMDLanes4(_mm_min_ps(a.v, b.v)); }
+inline SIMDLanes4 Max(SIMDLanes4 a, SIMDLanes4 b) { return SIMDLanes4(_mm_max_ps(a.v, b.v)); }
+inline SIMDLanes4 Less(SIMDLanes4 a, SIMDLanes4 b) { return SIMDLanes4(_mm_cmplt_ps(a.v, b.v)); }
+inline SIMDLanes4 Equal(SIMDLanes4 a, SIMDLanes4 b) { return SIMDLanes4(_mm_cmpeq_ps(a.v, b.v)); }
+inline SIMDLanes4 Select(SIMDLanes4 mask, SIMDLanes4 a, SIMDLanes4 b) { return SIMDLanes4(_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))); }
+inline SIMDLanes4 Truncate(SIMDLanes4 a) { return SIMDLanes4(_mm_cvtepi32_ps(_mm_cvttps_epi32(a.v))); }
+#endif
+
+#if defined(__AVX2__)
+struct SIMDLanes8
+{
+	static const GLuint LANES = 8;
+	__m256 v;
+
+	SIMDLanes8() {}
+	SIMDLanes8(__m256 v) : v(v) {}
+	SIMDLanes8(GLfloat f) : v(_mm256_set1_ps(f)) {}
+
+	static SIMDLanes8 Load(const GLfloat *source) { return SIMDLanes8(_mm256_load_ps(source)); }
+	static SIMDLanes8 LoadUnaligned(const GLfloat *source) { return SIMDLanes8(_mm256_loadu_ps(source)); }
+	static SIMDLanes8 LoadBytes(const unsigned char *source) { return SIMDLanes8(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)source)))); }
+	void Store(GLfloat *target) const { _mm256_store_ps(target, this->v); }
+	void StoreUnaligned(GLfloat *target) const { _mm256_storeu_ps(target, this->v); }
+	void StoreBytes(unsigned char *target) const
+	{
+		__m256i integers = _mm256_cvttps_epi32(this->v);
+		__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(integers), _mm256_extracti128_si256(integers, 1));
+		_mm_storel_epi64((__m128i *)target, _mm_packus_epi16(words, words));
+	}
+};
+
+inline SIMDLanes8 operator+(SIMDLanes8 a, SIMDLanes8 b) { return SIMDLanes8(_mm256_add_ps(a.v, b.v)); }
+inline SIMDLanes8 operator-(SIMDLanes8 a, SIMDLanes8 b) { return SIMDLanes8(_mm256_sub_ps(a.v, b.v)); }
+inline SIMDLanes8 operator*(SIMDLanes8 a, SIMDLanes8 b) { return SIMDLanes8(_mm256_mul_ps(a.v, b.v)); }
+inline SIMDLanes8 operator/(SIMDLanes8 a, SIMDLanes8 b) { return SIMDLanes8(_mm256_div_ps(a.v, b.v)); }
+inline SIMDLanes8 Min(SIMDLanes8 a, SIMDLanes8 b) { return SIMDLanes8(_mm256_min_ps(a.v, b.v)); }
+inline SIMDLanes8 Max(SIMDLanes8 a, SIMDLanes8 b) { return SIMDLanes8(_mm256_max_ps(a.v, b.v)); }
+inline SIMDLanes8 Less(SIMDLanes8 a, SIMDLanes8 b) { return SIMDLanes8(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+inline SIMDLanes8 Equal(SIMDLanes8 a, SIMDLanes8 b) { return SIMDLanes8(_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)); }
+inline SIMDLanes8 Select(SIMDLanes8 mask, SIMDLanes8 a, SIMDLanes8 b) { return SIMDLanes8(_mm256_blendv_ps(b.v, a.v, mask.v)); }
+inline SIMDLanes8 Truncate(SIMDLanes8 a) { return SIMDLanes8(_mm256_cvtepi32_ps(_mm256_cvttps_epi32(a.v))); }
+#endif
@@ -1369,15 +1369,23 @@ static void createMipmaps(const unsigned char *const img,
 		int MIPlevel = 1;
 		int MIPwidth = (width+1) / 2;
 		int MIPheight = (height+1) / 2;
-		unsigned char *resampled = (unsigned char*)malloc( channels*MIPwidth*MIPheight );
+		/*	each level is filtered from the one before it, not from the full image,
+			so levels alternate between a buffer for the odd ones and one for the even	*/
+		const unsigned char *previous = img;
+		int previous_width = width;
+		int previous_height = height;
+		unsigned char *resampled_odd = (unsigned char*)malloc( channels*MIPwidth*MIPheight );
+		unsigned char *resampled_even = (unsigned char*)malloc( channels*((MIPwidth+1)/2)*((MIPheight+1)/2) );
+		unsigned char *resampled;
 
 		while( ((1<<MIPlevel) <= width) || ((1<<MIPlevel) <= height) )
 		{
 			/*	do this MIPmap level	*/
+			resampled = (MIPlevel & 1) ? resampled_odd : resampled_even;
 			mipmap_image(
-					img, width, height, channels,
+					previous, previous_width, previous_height, channels,
 					resampled,
-					(1 << MIPlevel), (1 << MIPlevel) );
+					previous_width > 1 ? 2 : 1, previous_height > 1 ? 2 : 1 );
 
 			/*  upload the MIPmaps	*/
 			if( DXT_mode == SOIL_CAPABILITY_PRESENT )
@@ -1423,12 +1431,16 @@ static void createMipmaps(const unsigned char *const img,
 				check_for_GL_errors( "glTexImage2D" );
 			}
 			/*	prep for the next level	*/
+			previous = resampled;
+			previous_width = previous_width > 1 ? previous_width / 2 : 1;
+			previous_height = previous_height > 1 ? previous_height / 2 : 1;
 			++MIPlevel;
 			MIPwidth = (MIPwidth + 1) / 2;
 			MIPheight = (MIPheight + 1) / 2;
 		}
 
-		SOIL_free_image_data( resampled );
+		SOIL_free_image_data( resampled_odd );
+		SOIL_free_image_data( resampled_even );
 	}
 }
 
@@ -0,0 +1,329 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+// SIMD Includes
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCENE_GRAPH_SSE
+#include <xmmintrin.h>
+#endif
+
+// GL Includes
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+
+// Parent index of the nodes that hang from the world
+const GLint SCENE_ROOT = -1;
+
+// Levels smaller than this are updated on the calling thread, waking the workers would cost more
+const GLuint SCENE_PARALLEL_MIN_NODES = 2048;
+
+// Nodes per job when a level is split over the job system
+const GLuint SCENE_PARALLEL_CHUNK = 1024;
+
+// Filled by SceneGraph::UpdateParallel
+struct SceneUpdateStats
+{
+	GLuint nodesUpdated = 0;
+	GLuint levels = 0;
+	GLuint parallelLevels = 0;
+	GLuint threads = 0;
+	double wallSeconds = 0.0;
+	double busySeconds = 0.0; // Time spent multiplying matrices, summed over every thread
+
+	// Fraction of the available thread time that did useful work (1 = perfect scaling)
+	double Efficiency() const
+	{
+		return (wallSeconds > 0.0 && threads > 0) ? busySeconds / (wallSeconds * threads) : 0.0;
+	}
+};
+
+// out = a * b. GLM matrices are column major: every column of the result is a combination of a's columns.
+inline void MultiplyTransform(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out)
+{
+#ifdef SCENE_GRAPH_SSE
+	const float *pa = (const float *)&a;
+	const float *pb = (const float *)&b;
+	float *po = (float *)&out;
+	__m128 a0 = _mm_loadu_ps(pa);
+	__m128 a1 = _mm_loadu_ps(pa + 4);
+	__m128 a2 = _mm_loadu_ps(pa + 8);
+	__m128 a3 = _mm_loadu_ps(pa + 12);
+
+	for (int c = 0; c < 4; c++)
+	{
+		__m128 column = _mm_mul_ps(a0, _mm_set1_ps(pb[c * 4]));
+		column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(pb[c * 4 + 1])));
+		column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(pb[c * 4 + 2])));
+		column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(pb[c * 4 + 3])));
+		_mm_storeu_ps(po + c * 4, column);
+	}
+#else
+	out = a * b;
+#endif
+}
+
+// Transform hierarchy stored flat: node i only depends on parents[i] < i, so the nodes are always in
+// topological order and one forward pass over contiguous arrays updates every world matrix.
+// Local and world transforms live in separate arrays; changing a local marks the node dirty and
+// Update() only recomputes the dirty nodes and everything below them.
+class SceneGraph
+{
+public:
+	SceneGraph() : anyDirty(false), levelsDirty(true)
+	{
+	}
+
+	// Adds a node below parent (SCENE_ROOT or an existing node) and returns its index
+	GLuint AddNode(GLint parent, const glm::mat4 &local = glm::mat4(1.0f))
+	{
+		GLuint node = (GLuint)this->parents.size();
+
+		if (parent >= (GLint)node)
+		{
+			parent = SCENE_ROOT; // Parents must come first, anything else would break the single pass
+		}
+
+		this->parents.push_back(parent);
+		this->locals.push_back(local);
+		this->worlds.push_back(local);
+		this->dirty.push_back(1);
+		this->anyDirty = true;
+		this->levelsDirty = true;
+
+		return node;
+	}
+
+	// Setting the same matrix again doesn't dirty the node, so callers can set every frame
+	void SetLocal(GLuint node, const glm::mat4 &local)
+	{
+		if (this->locals[node] == local)
+		{
+			return;
+		}
+
+		this->locals[node] = local;
+		this->dirty[node] = 1;
+		this->anyDirty = true;
+	}
+
+	const glm::mat4 &GetLocal(GLuint node) const
+	{
+		return this->locals[node];
+	}
+
+	// World matrix as of the last Update()
+	const glm::mat4 &GetWorld(GLuint node) const
+	{
+		return this->worlds[node];
+	}
+
+	GLint GetParent(GLuint node) const
+	{
+		return this->parents[node];
+	}
+
+	GLuint GetNodeCount() const
+	{
+		return (GLuint)this->parents.size();
+	}
+
+	// Propagates the changed locals down the hierarchy. Returns how many world matrices were recomputed.
+	GLuint Update()
+	{
+		if (!this->anyDirty)
+		{
+			return 0;
+		}
+
+		GLuint recomputed = 0;
+		GLuint count = (GLuint)this->parents.size();
+
+		for (GLuint i = 0; i < count; i++)
+		{
+			GLint parent = this->parents[i];
+
+			// A dirty parent was processed earlier in this same pass, so it already carries the flag down
+			if (parent != SCENE_ROOT && this->dirty[parent])
+			{
+				this->dirty[i] = 1;
+			}
+
+			if (this->dirty[i])
+			{
+				this->updateNode(i);
+				recomputed++;
+			}
+		}
+
+		std::fill(this->dirty.begin(), this->dirty.end(), 0);
+		this->anyDirty = false;
+
+		return recomputed;
+	}
+
+	// Same result as Update(), for very large hierarchies. Nodes at the same depth never depend on each
+	// other, so the levels are processed in order and every big level is split in chunks over the jobs.
+	GLuint UpdateParallel(JobSystem &jobs, SceneUpdateStats *stats = nullptr)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		GLuint threadCount = jobs.GetThreadCount();
+		GLuint caller = jobs.GetWorkerIndex();
+
+		if (this->levelsDirty)
+		{
+			this->buildLevels();
+		}
+
+		// One accumulator per worker slot, outside threads included
+		std::vector<GLuint> counts(threadCount + 1, 0);
+		std::vector<double> busy(threadCount + 1, 0.0);
+		GLuint parallelLevels = 0;
+
+		if (this->anyDirty)
+		{
+			for (GLuint level = 0; level + 1 < this->levelOffsets.size(); level++)
+			{
+				GLuint first = this->levelOffsets[level];
+				GLuint size = this->levelOffsets[level + 1] - first;
+
+				if (size < SCENE_PARALLEL_MIN_NODES || threadCount <= 1)
+				{
+					this->updateLevelRange(first, first + size, counts[caller], busy[caller]);
+					continue;
+				}
+
+				parallelLevels++;
+
+				jobs.ParallelFor(size, SCENE_PARALLEL_CHUNK, [&](GLuint begin, GLuint end, GLuint worker)
+				{
+					this->updateLevelRange(first + begin, first + end, counts[worker], busy[worker]);
+				});
+			}
+
+			std::fill(this->dirty.begin(), this->dirty.end(), 0);
+			this->anyDirty = false;
+		}
+
+		GLuint recomputed = 0;
+
+		for (GLuint t = 0; t < counts.size(); t++)
+		{
+			recomputed += counts[t];
+		}
+
+		if (stats)
+		{
+			stats->nodesUpdated = recomputed;
+			stats->levels = this->levelOffsets.empty() ? 0 : (GLuint)this->levelOffsets.size() - 1;
+			stats->parallelLevels = parallelLevels;
+			stats->threads = threadCount;
+			stats->wallSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			stats->busySeconds = 0.0;
+
+			for (GLuint t = 0; t < busy.size(); t++)
+			{
+				stats->busySeconds += busy[t];
+			}
+		}
+
+		return recomputed;
+	}
+
+private:
+	std::vector<GLint> parents;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<unsigned char> dirty;
+	bool anyDirty;
+
+	// Nodes grouped by depth: levelNodes[levelOffsets[d], levelOffsets[d + 1]) are the nodes at depth d
+	std::vector<GLuint> levelNodes;
+	std::vector<GLuint> levelOffsets;
+	bool levelsDirty;
+
+	void updateNode(GLuint i)
+	{
+		GLint parent = this->parents[i];
+
+		if (parent == SCENE_ROOT)
+		{
+			this->worlds[i] = this->locals[i];
+		}
+		else
+		{
+			MultiplyTransform(this->worlds[parent], this->locals[i], this->worlds[i]);
+		}
+	}
+
+	// Parents are one level up and already final, each node only writes its own flag and matrix
+	// Adds to count and busy once at the end: they sit next to the other workers' accumulators, so
+	// bumping them per node would bounce the shared cache line between the threads
+	void updateLevelRange(GLuint begin, GLuint end, GLuint &count, double &busy)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		GLuint updated = 0;
+
+		for (GLuint n = begin; n < end; n++)
+		{
+			GLuint i = this->levelNodes[n];
+			GLint parent = this->parents[i];
+
+			if (parent != SCENE_ROOT && this->dirty[parent])
+			{
+				this->dirty[i] = 1;
+			}
+
+			if (this->dirty[i])
+			{
+				this->updateNode(i);
+				updated++;
+			}
+		}
+
+		count += updated;
+		busy += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Counting sort of the nodes by depth, keeping their order inside each level
+	void buildLevels()
+	{
+		GLuint count = (GLuint)this->parents.size();
+		std::vector<GLuint> depth(count, 0);
+		GLuint maxDepth = 0;
+
+		for (GLuint i = 0; i < count; i++)
+		{
+			depth[i] = (this->parents[i] == SCENE_ROOT) ? 0 : depth[this->parents[i]] + 1;
+			maxDepth = std::max(maxDepth, depth[i]);
+		}
+
+		this->levelOffsets.assign(count ? maxDepth + 2 : 1, 0);
+
+		for (GLuint i = 0; i < count; i++)
+		{
+			this->levelOffsets[depth[i] + 1]++;
+		}
+
+		for (GLuint d = 1; d < this->levelOffsets.size(); d++)
+		{
+			this->levelOffsets[d] += this->levelOffsets[d - 1];
+		}
+
+		std::vector<GLuint> fill(this->levelOffsets.begin(), this->levelOffsets.end() - 1);
+		this->levelNodes.resize(count);
+
+		for (GLuint i = 0; i < count; i++)
+		{
+			this->levelNodes[fill[depth[i]]++] = i;
+		}
+
+		this->levelsDirty = false;
+	}
+};
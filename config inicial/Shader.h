@@ -8,6 +8,9 @@
 
 #include <GL/glew.h>
 
+#include "GLStats.h"
+#include "Profiler.h"
+
 class Shader
 {
 public:
@@ -16,6 +19,8 @@ public:
 	// Constructor generates the shader on the fly
 	Shader(const GLchar *vertexPath, const GLchar *fragmentPath)
 	{
+		PROFILE_ZONE("Shader::Shader");
+
 		// 1. Retrieve the vertex/fragment source code from filePath
 		std::string vertexCode;
 		std::string fragmentCode;
@@ -91,6 +96,33 @@ public:
 		glDeleteShader(fragment);
 
 	}
+	// Constructor for transform feedback programs: vertex + geometry stages and no fragment stage.
+	// The given varyings are captured interleaved, in order, into the buffer bound at index 0.
+	Shader(const GLchar *vertexPath, const GLchar *geometryPath, const GLchar *const *varyings, GLsizei varyingCount)
+	{
+		PROFILE_ZONE("Shader::Shader");
+
+		GLuint vertex = compileFile(vertexPath, GL_VERTEX_SHADER, "VERTEX");
+		GLuint geometry = compileFile(geometryPath, GL_GEOMETRY_SHADER, "GEOMETRY");
+		GLint success;
+		GLchar infoLog[512];
+		// Shader Program, the varyings must be declared before linking
+		this->Program = glCreateProgram();
+		glAttachShader(this->Program, vertex);
+		glAttachShader(this->Program, geometry);
+		glTransformFeedbackVaryings(this->Program, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS);
+		glLinkProgram(this->Program);
+		// Print linking errors if any
+		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetProgramInfoLog(this->Program, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		}
+		uniformColor = glGetUniformLocation(this->Program, "color");
+		glDeleteShader(vertex);
+		glDeleteShader(geometry);
+	}
 	// Uses the current shader
 	void Use()
 	{
@@ -101,6 +133,40 @@ public:
 	{
 		return uniformColor;
 	}
+
+private:
+	// Reads and compiles a single stage, printing the errors like the constructor does
+	static GLuint compileFile(const GLchar *path, GLenum type, const char *stageName)
+	{
+		std::string code;
+		std::ifstream shaderFile;
+		shaderFile.exceptions(std::ifstream::badbit);
+		try
+		{
+			shaderFile.open(path);
+			std::stringstream shaderStream;
+			shaderStream << shaderFile.rdbuf();
+			shaderFile.close();
+			code = shaderStream.str();
+		}
+		catch (std::ifstream::failure e)
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+		}
+		const GLchar *shaderCode = code.c_str();
+		GLint success;
+		GLchar infoLog[512];
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &shaderCode, NULL);
+		glCompileShader(shader);
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shader, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+		}
+		return shader;
+	}
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 texCoords;
+// Per instance model matrix, one column per attribute (locations 3 to 6)
+layout (location = 3) in mat4 instanceModel;
+
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TexCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * view * instanceModel * vec4(position, 1.0f);
+    FragPos = vec3(instanceModel * vec4(position, 1.0f));
+    Normal = mat3(transpose(inverse(instanceModel))) * normal;
+    TexCoords = texCoords;
+}
\ No newline at end of file
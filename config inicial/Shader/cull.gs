@@ -0,0 +1,26 @@
+#version 330 core
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in mat4 vsModel[];
+flat in int vsVisible[];
+
+// Captured by transform feedback, the same layout the instanced draw reads
+out vec4 culledColumn0;
+out vec4 culledColumn1;
+out vec4 culledColumn2;
+out vec4 culledColumn3;
+
+void main()
+{
+    // Culled instances emit nothing, so the output buffer only holds the visible ones, packed
+    if (vsVisible[0] == 1)
+    {
+        culledColumn0 = vsModel[0][0];
+        culledColumn1 = vsModel[0][1];
+        culledColumn2 = vsModel[0][2];
+        culledColumn3 = vsModel[0][3];
+        EmitVertex();
+        EndPrimitive();
+    }
+}
\ No newline at end of file
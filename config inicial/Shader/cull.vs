@@ -0,0 +1,30 @@
+#version 330 core
+// Per instance model matrix, one column per attribute (locations 0 to 3)
+layout (location = 0) in mat4 instanceModel;
+
+out mat4 vsModel;
+flat out int vsVisible;
+
+// World space frustum planes (ax + by + cz + d >= 0 means inside)
+uniform vec4 planes[6];
+// Bounding sphere of the model in object space: xyz center, w radius
+uniform vec4 bounds;
+
+void main()
+{
+    vec3 center = vec3(instanceModel * vec4(bounds.xyz, 1.0f));
+    // Non uniform scales grow the sphere by the largest axis
+    float scale = max(length(instanceModel[0].xyz), max(length(instanceModel[1].xyz), length(instanceModel[2].xyz)));
+    float radius = bounds.w * scale;
+
+    vsVisible = 1;
+    for (int i = 0; i < 6; i++)
+    {
+        if (dot(planes[i].xyz, center) + planes[i].w < -radius)
+        {
+            vsVisible = 0;
+        }
+    }
+
+    vsModel = instanceModel;
+}
\ No newline at end of file
@@ -0,0 +1,369 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <string>
+
+// GL Includes
+#include <GL/glew.h>
+
+// Comparison made by a transition guard
+enum StateGuardType
+{
+	GUARD_INPUT_SET = 0,	// The input is on
+	GUARD_INPUT_CLEAR,		// The input is off
+	GUARD_CHANNEL_ABOVE,	// channel >= value
+	GUARD_CHANNEL_BELOW,	// channel <= value
+	GUARD_TIME_IN_STATE		// Seconds since the state was entered >= value
+};
+
+// Description of a state machine by name: states, the channels they animate, the inputs that drive them
+// and the guarded transitions between them. It is only used to build a StateMachine.
+class StateMachineDefinition
+{
+public:
+	GLuint AddChannel(const std::string &name)
+	{
+		this->channelNames.push_back(name);
+		return (GLuint)this->channelNames.size() - 1;
+	}
+
+	GLuint AddInput(const std::string &name)
+	{
+		this->inputNames.push_back(name);
+		return (GLuint)this->inputNames.size() - 1;
+	}
+
+	// The first state added is the initial one
+	GLuint AddState(const std::string &name)
+	{
+		State state;
+		state.name = name;
+		this->states.push_back(state);
+		return (GLuint)this->states.size() - 1;
+	}
+
+	// While in the state the channel changes by rate units per second
+	void AddRate(GLuint state, GLuint channel, GLfloat rate)
+	{
+		Action action = { channel, rate };
+		this->states[state].rates.push_back(action);
+	}
+
+	// The channel takes this value when the state is entered
+	void AddEnterValue(GLuint state, GLuint channel, GLfloat value)
+	{
+		Action action = { channel, value };
+		this->states[state].enterValues.push_back(action);
+	}
+
+	// Transitions of a state are tested in the order they were added, the first one whose guards all pass is taken.
+	// A transition without guards is always taken.
+	GLuint AddTransition(GLuint from, GLuint to)
+	{
+		Transition transition;
+		transition.from = from;
+		transition.to = to;
+		this->transitions.push_back(transition);
+		return (GLuint)this->transitions.size() - 1;
+	}
+
+	// index is an input for the input guards, a channel for the channel guards and ignored for the time guard
+	void AddGuard(GLuint transition, StateGuardType type, GLuint index = 0, GLfloat value = 0.0f)
+	{
+		Guard guard = { type, index, value };
+		this->transitions[transition].guards.push_back(guard);
+	}
+
+	GLint FindState(const std::string &name) const
+	{
+		for (GLuint i = 0; i < this->states.size(); i++)
+		{
+			if (this->states[i].name == name)
+			{
+				return (GLint)i;
+			}
+		}
+
+		return -1;
+	}
+
+private:
+	friend class StateMachine;
+
+	struct Action
+	{
+		GLuint channel;
+		GLfloat value;
+	};
+
+	struct Guard
+	{
+		StateGuardType type;
+		GLuint index;
+		GLfloat value;
+	};
+
+	struct State
+	{
+		std::string name;
+		std::vector<Action> rates;
+		std::vector<Action> enterValues;
+	};
+
+	struct Transition
+	{
+		GLuint from, to;
+		std::vector<Guard> guards;
+	};
+
+	std::vector<std::string> channelNames;
+	std::vector<std::string> inputNames;
+	std::vector<State> states;
+	std::vector<Transition> transitions;
+};
+
+// A compiled state machine and the state of all its instances.
+// The definition is flattened into index ranges over plain arrays: per state a range of rate actions
+// and a range of transitions, per transition a range of guards. Every guard becomes the same test,
+// source[instance] * sign >= threshold, where the source is the time in state, a channel or an input
+// (stored as 0 or 1), so ticking is a few tight loops with no virtual calls and no switch.
+// Instances are structure of arrays: one state, one timer and one value per channel and input each.
+class StateMachine
+{
+public:
+	explicit StateMachine(const StateMachineDefinition &definition) : instanceCount(0)
+	{
+		this->channelCount = (GLuint)definition.channelNames.size();
+		this->inputCount = (GLuint)definition.inputNames.size();
+		this->channelNames = definition.channelNames;
+		this->inputNames = definition.inputNames;
+
+		GLuint stateCount = (GLuint)definition.states.size();
+
+		// Rates and enter values grouped by state
+		for (GLuint s = 0; s < stateCount; s++)
+		{
+			const StateMachineDefinition::State &state = definition.states[s];
+
+			this->stateNames.push_back(state.name);
+			this->rateStart.push_back((GLuint)this->rateChannel.size());
+
+			for (GLuint a = 0; a < state.rates.size(); a++)
+			{
+				this->rateChannel.push_back(1 + state.rates[a].channel);
+				this->rateValue.push_back(state.rates[a].value);
+			}
+
+			this->enterStart.push_back((GLuint)this->enterChannel.size());
+
+			for (GLuint a = 0; a < state.enterValues.size(); a++)
+			{
+				this->enterChannel.push_back(1 + state.enterValues[a].channel);
+				this->enterValue.push_back(state.enterValues[a].value);
+			}
+		}
+
+		this->rateStart.push_back((GLuint)this->rateChannel.size());
+		this->enterStart.push_back((GLuint)this->enterChannel.size());
+
+		// Transitions grouped by source state, keeping their order
+		for (GLuint s = 0; s < stateCount; s++)
+		{
+			this->transitionStart.push_back((GLuint)this->transitionTarget.size());
+
+			for (GLuint t = 0; t < definition.transitions.size(); t++)
+			{
+				const StateMachineDefinition::Transition &transition = definition.transitions[t];
+
+				if (transition.from != s)
+				{
+					continue;
+				}
+
+				this->transitionTarget.push_back(transition.to);
+				this->guardStart.push_back((GLuint)this->guardSource.size());
+
+				for (GLuint g = 0; g < transition.guards.size(); g++)
+				{
+					this->compileGuard(transition.guards[g]);
+				}
+			}
+		}
+
+		this->transitionStart.push_back((GLuint)this->transitionTarget.size());
+		this->guardStart.push_back((GLuint)this->guardSource.size());
+
+		// Source 0 is the timer, then the channels, then the inputs
+		this->sources.resize(1 + this->channelCount + this->inputCount);
+	}
+
+	// Adds an instance in the given state and returns its index
+	GLuint AddInstance(GLuint initialState = 0)
+	{
+		GLuint i = this->instanceCount++;
+
+		this->state.push_back((unsigned short)initialState);
+
+		for (GLuint s = 0; s < this->sources.size(); s++)
+		{
+			this->sources[s].push_back(0.0f);
+		}
+
+		this->enterState(i, initialState);
+
+		return i;
+	}
+
+	// Advances every instance by deltaTime seconds: applies the rates of the current state, then takes
+	// at most one transition
+	void Tick(GLfloat deltaTime)
+	{
+		this->Tick(deltaTime, 0, this->instanceCount);
+	}
+
+	// Same as Tick for the instances in [begin, end), ranges can run on different threads
+	void Tick(GLfloat deltaTime, GLuint begin, GLuint end)
+	{
+		GLfloat *timer = this->sources[0].data();
+
+		for (GLuint i = begin; i < end; i++)
+		{
+			GLuint s = this->state[i];
+
+			timer[i] += deltaTime;
+
+			for (GLuint a = this->rateStart[s]; a < this->rateStart[s + 1]; a++)
+			{
+				this->sources[this->rateChannel[a]][i] += this->rateValue[a] * deltaTime;
+			}
+
+			// First transition whose guards all pass
+			for (GLuint t = this->transitionStart[s]; t < this->transitionStart[s + 1]; t++)
+			{
+				bool pass = true;
+
+				for (GLuint g = this->guardStart[t]; g < this->guardStart[t + 1]; g++)
+				{
+					pass &= this->sources[this->guardSource[g]][i] * this->guardSign[g] >= this->guardThreshold[g];
+				}
+
+				if (pass)
+				{
+					this->enterState(i, this->transitionTarget[t]);
+					break;
+				}
+			}
+		}
+	}
+
+	void SetInput(GLuint instance, GLuint input, bool on)
+	{
+		this->sources[1 + this->channelCount + input][instance] = on ? 1.0f : 0.0f;
+	}
+
+	bool GetInput(GLuint instance, GLuint input) const
+	{
+		return this->sources[1 + this->channelCount + input][instance] > 0.5f;
+	}
+
+	void SetChannel(GLuint instance, GLuint channel, GLfloat value)
+	{
+		this->sources[1 + channel][instance] = value;
+	}
+
+	GLfloat GetChannel(GLuint instance, GLuint channel) const
+	{
+		return this->sources[1 + channel][instance];
+	}
+
+	// Contiguous values of one channel for every instance
+	const GLfloat *GetChannelData(GLuint channel) const
+	{
+		return this->sources[1 + channel].data();
+	}
+
+	GLuint GetState(GLuint instance) const
+	{
+		return this->state[instance];
+	}
+
+	const std::string &GetStateName(GLuint state) const
+	{
+		return this->stateNames[state];
+	}
+
+	GLfloat GetTimeInState(GLuint instance) const
+	{
+		return this->sources[0][instance];
+	}
+
+	GLuint GetInstanceCount() const
+	{
+		return this->instanceCount;
+	}
+
+private:
+	/*  Compiled tables  */
+	GLuint channelCount, inputCount;
+	std::vector<std::string> stateNames, channelNames, inputNames;
+	std::vector<GLuint> rateStart, rateChannel;			// rateChannel is a source index
+	std::vector<GLfloat> rateValue;
+	std::vector<GLuint> enterStart, enterChannel;		// enterChannel is a source index
+	std::vector<GLfloat> enterValue;
+	std::vector<GLuint> transitionStart, transitionTarget, guardStart;
+	std::vector<GLuint> guardSource;
+	std::vector<GLfloat> guardSign, guardThreshold;
+
+	/*  Instance data  */
+	GLuint instanceCount;
+	std::vector<unsigned short> state;
+	std::vector<std::vector<GLfloat> > sources;
+
+	/*  Functions    */
+	// Every guard becomes source * sign >= threshold
+	void compileGuard(const StateMachineDefinition::Guard &guard)
+	{
+		GLuint source = 0;
+		GLfloat sign = 1.0f, threshold = guard.value;
+
+		switch (guard.type)
+		{
+		case GUARD_INPUT_SET:
+			source = 1 + this->channelCount + guard.index;
+			threshold = 0.5f;
+			break;
+		case GUARD_INPUT_CLEAR:
+			source = 1 + this->channelCount + guard.index;
+			sign = -1.0f;
+			threshold = -0.5f;
+			break;
+		case GUARD_CHANNEL_ABOVE:
+			source = 1 + guard.index;
+			break;
+		case GUARD_CHANNEL_BELOW:
+			source = 1 + guard.index;
+			sign = -1.0f;
+			threshold = -guard.value;
+			break;
+		case GUARD_TIME_IN_STATE:
+			source = 0;
+			break;
+		}
+
+		this->guardSource.push_back(source);
+		this->guardSign.push_back(sign);
+		this->guardThreshold.push_back(threshold);
+	}
+
+	void enterState(GLuint i, GLuint s)
+	{
+		this->state[i] = (unsigned short)s;
+		this->sources[0][i] = 0.0f;
+
+		for (GLuint a = this->enterStart[s]; a < this->enterStart[s + 1]; a++)
+		{
+			this->sources[this->enterChannel[a]][i] = this->enterValue[a];
+		}
+	}
+};
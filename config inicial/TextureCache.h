@@ -0,0 +1,298 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// GL Includes
+#include <GL/glew.h>
+
+#include "DXTCompressor.h"
+#include "MipChain.h"
+extern "C"
+{
+#include "SOIL2/image_DXT.h"
+}
+
+// Where the compressed copies go, relative to the working directory the scenes run from
+const char *const TEXTURE_CACHE_DIRECTORY = "TextureCache";
+
+// Command line switch, added to the RenderContext ones:
+//   --no-texture-cache  decode the source images every time and upload them uncompressed
+struct TextureCacheOptions
+{
+	bool enabled = true;
+};
+
+inline TextureCacheOptions ParseTextureCacheOptions(int argc, char **argv)
+{
+	TextureCacheOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--no-texture-cache"))
+		{
+			options.enabled = false;
+		}
+	}
+
+	return options;
+}
+
+// The options every texture load uses; scenes set them once after parsing the command line
+inline TextureCacheOptions &GetTextureCacheOptions()
+{
+	static TextureCacheOptions options;
+	return options;
+}
+
+// A BC1 (DXT1, RGB) or BC3 (DXT5, RGBA) texture with its mip chain, every level after the previous one as
+// in a DDS file
+struct CompressedTexture
+{
+	GLenum format = 0;
+	GLsizei width = 0, height = 0;
+	GLuint levels = 0;
+	std::vector<unsigned char> data;
+};
+
+// Bytes of one level: 4x4 blocks of 8 bytes (BC1) or 16 (BC3), partial blocks rounded up
+inline GLsizei CompressedLevelSize(GLenum format, GLsizei width, GLsizei height)
+{
+	GLsizei blockBytes = GL_COMPRESSED_RGB_S3TC_DXT1_EXT == format ? 8 : 16;
+	return ((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+}
+
+// Bytes of the whole mip chain
+inline size_t CompressedTextureSize(const CompressedTexture &texture)
+{
+	size_t size = 0;
+
+	for (GLuint i = 0; i < texture.levels; i++)
+	{
+		size += CompressedLevelSize(texture.format, std::max(1, texture.width >> i), std::max(1, texture.height >> i));
+	}
+
+	return size;
+}
+
+// The cache is used when it's on and the GPU samples S3TC textures. Safe from any thread once GLEW is initialized.
+inline bool IsTextureCacheEnabled()
+{
+	return GetTextureCacheOptions().enabled && GLEW_EXT_texture_compression_s3tc;
+}
+
+// FNV-1a over the file's bytes, so an edited image gets a new entry whatever its name or date
+inline unsigned long long HashTextureSource(const std::vector<unsigned char> &bytes)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < bytes.size(); i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+// Cache file of a source image. What is done to the pixels before compressing them (flipping, the channels
+// kept) is part of the key too.
+inline std::string TextureCachePath(unsigned long long sourceHash, bool flipVertically, int channels)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "/%016llx_%c%d.dds", sourceHash, flipVertically ? 'f' : 'n', channels);
+
+	return std::string(TEXTURE_CACHE_DIRECTORY) + name;
+}
+
+inline bool ReadFileBytes(const std::string &path, std::vector<unsigned char> &bytes)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+
+	if (!file)
+	{
+		return false;
+	}
+
+	bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	return true;
+}
+
+// Compresses the image and the mip chain MipChainBuilder builds from it (2x2 box filter, down to 1x1).
+// Three channels give BC1, four BC3, with the blocks image_DXT.c would write. The decode jobs compress
+// several textures at once already, so by default each one stays on its own thread; pass a job system
+// to split the rows.
+inline bool CompressTexture(const unsigned char *pixels, int width, int height, int channels, CompressedTexture &texture, JobSystem *jobs = nullptr)
+{
+	if (3 != channels && 4 != channels)
+	{
+		return false;
+	}
+
+	texture.format = 3 == channels ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	texture.width = width;
+	texture.height = height;
+	texture.levels = 0;
+	texture.data.clear();
+
+	// Level 0 is read in place, the smaller ones come from the mip chain
+	std::vector<MipLevel> levels;
+	MipChainBuilder builder(jobs);
+	DXTCompressor compressor(jobs);
+
+	if (!builder.Build(pixels, width, height, channels, levels))
+	{
+		return false;
+	}
+
+	for (GLuint i = 0; i <= levels.size(); i++)
+	{
+		const unsigned char *level = 0 == i ? pixels : &levels[i - 1].pixels[0];
+		int levelWidth = 0 == i ? width : levels[i - 1].width, levelHeight = 0 == i ? height : levels[i - 1].height;
+		size_t offset = texture.data.size();
+		texture.data.resize(offset + DXTCompressor::GetCompressedSize(levelWidth, levelHeight, 4 == channels));
+
+		if (!compressor.Compress(level, levelWidth, levelHeight, channels, 4 == channels, &texture.data[offset]))
+		{
+			return false;
+		}
+
+		texture.levels++;
+	}
+
+	return true;
+}
+
+// Writes the texture as a DDS file with mipmaps, the layout SOIL_direct_load_DDS reads. It goes to a
+// temporary name first, so a loader running at the same time never sees half a file.
+inline bool WriteCachedTexture(const std::string &path, const CompressedTexture &texture)
+{
+#if defined(_WIN32)
+	_mkdir(TEXTURE_CACHE_DIRECTORY);
+#else
+	mkdir(TEXTURE_CACHE_DIRECTORY, 0755);
+#endif
+
+	DDS_header header;
+	memset(&header, 0, sizeof(header));
+	header.dwMagic = ('D' << 0) | ('D' << 8) | ('S' << 16) | (' ' << 24);
+	header.dwSize = 124;
+	header.dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | DDSD_MIPMAPCOUNT;
+	header.dwWidth = texture.width;
+	header.dwHeight = texture.height;
+	header.dwPitchOrLinearSize = CompressedLevelSize(texture.format, texture.width, texture.height);
+	header.dwMipMapCount = texture.levels;
+	header.sPixelFormat.dwSize = 32;
+	header.sPixelFormat.dwFlags = DDPF_FOURCC;
+	header.sPixelFormat.dwFourCC = ('D' << 0) | ('X' << 8) | ('T' << 16) | ((GL_COMPRESSED_RGB_S3TC_DXT1_EXT == texture.format ? '1' : '5') << 24);
+	header.sCaps.dwCaps1 = DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+
+	std::string temporary = path + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+
+	if (!file)
+	{
+		std::cout << "ERROR::TEXTURE_CACHE::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	bool written = 1 == fwrite(&header, sizeof(header), 1, file) && 1 == fwrite(&texture.data[0], texture.data.size(), 1, file);
+	written = 0 == fclose(file) && written;
+
+	// Another loader may have written the same entry meanwhile, that one is as good
+	if (!written || 0 != rename(temporary.c_str(), path.c_str()))
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+// Reads a DDS file written by WriteCachedTexture. Anything else (wrong format, truncated) is rejected,
+// the caller then decodes the source again and rewrites the entry.
+inline bool ReadCachedTexture(const std::string &path, CompressedTexture &texture)
+{
+	std::vector<unsigned char> bytes;
+
+	if (!ReadFileBytes(path, bytes) || bytes.size() < sizeof(DDS_header))
+	{
+		return false;
+	}
+
+	DDS_header header;
+	memcpy(&header, &bytes[0], sizeof(header));
+
+	GLuint fourCC = header.sPixelFormat.dwFourCC;
+	GLenum format;
+
+	if (fourCC == (GLuint)(('D' << 0) | ('X' << 8) | ('T' << 16) | ('1' << 24)))
+	{
+		format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	}
+	else if (fourCC == (GLuint)(('D' << 0) | ('X' << 8) | ('T' << 16) | ('5' << 24)))
+	{
+		format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+	else
+	{
+		return false;
+	}
+
+	texture.format = format;
+	texture.width = header.dwWidth;
+	texture.height = header.dwHeight;
+	texture.levels = std::max(1u, header.dwMipMapCount);
+
+	if (texture.width < 1 || texture.height < 1 || texture.levels > 32)
+	{
+		return false;
+	}
+
+	size_t expected = CompressedTextureSize(texture);
+
+	if (bytes.size() < sizeof(header) + expected)
+	{
+		return false;
+	}
+
+	texture.data.assign(bytes.begin() + sizeof(header), bytes.begin() + sizeof(header) + expected);
+
+	return true;
+}
+
+// Creates every level of the texture. data is client memory, or an offset into the pixel unpack buffer
+// bound, pointing at the first level.
+inline void SetCompressedTextureImage(GLuint textureID, const CompressedTexture &texture, const unsigned char *data)
+{
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	for (GLuint i = 0; i < texture.levels; i++)
+	{
+		GLsizei width = std::max(1, texture.width >> i), height = std::max(1, texture.height >> i);
+		GLsizei size = CompressedLevelSize(texture.format, width, height);
+
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, texture.format, width, height, 0, size, data);
+		data += size;
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
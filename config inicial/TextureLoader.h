@@ -0,0 +1,433 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <iostream>
+#include <mutex>
+#include <climits>
+#include <cstring>
+
+// GL Includes
+#include <GL/glew.h>
+#include "SOIL2/SOIL2.h"
+
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include "PixelUploadRing.h"
+#include "TextureCache.h"
+
+using namespace std;
+
+// Pixels decoded from an image file, waiting to be uploaded. With the texture cache on they come
+// compressed instead, and pixels is nullptr.
+struct TextureImage
+{
+	unsigned char *pixels;
+	int width, height;
+	string name;	// File it came from, to tag its memory
+	CompressedTexture compressed;
+};
+
+inline bool IsCompressed(const TextureImage &image)
+{
+	return 0 != image.compressed.format;
+}
+
+// Bytes to upload: the RGB pixels or the compressed mip chain
+inline size_t TextureImageBytes(const TextureImage &image)
+{
+	return IsCompressed(image) ? image.compressed.data.size() : (image.pixels ? (size_t)image.width * image.height * 3 : 0);
+}
+
+inline const unsigned char *TextureImageData(const TextureImage &image)
+{
+	return IsCompressed(image) ? (image.compressed.data.empty() ? nullptr : &image.compressed.data[0]) : image.pixels;
+}
+
+// Turns the rows upside down, for textures authored with the origin at the bottom (what stbi's flip does)
+inline void FlipTextureImage(TextureImage &image)
+{
+	GLuint rowBytes = (GLuint)image.width * 3;
+	vector<unsigned char> row(rowBytes);
+
+	for (int top = 0, bottom = image.height - 1; top < bottom; top++, bottom--)
+	{
+		unsigned char *a = image.pixels + (size_t)top * rowBytes, *b = image.pixels + (size_t)bottom * rowBytes;
+		memcpy(&row[0], a, rowBytes);
+		memcpy(a, b, rowBytes);
+		memcpy(b, &row[0], rowBytes);
+	}
+}
+
+// Reads and decodes the image, no GL calls so it can run on a worker thread. With the texture cache on,
+// an image seen before comes straight from its DDS file; a new one is compressed and its entry written.
+TextureImage DecodeTextureFile(const char *path, string directory, bool flipVertically = false)
+{
+	PROFILE_ZONE("DecodeTextureFile");
+
+	string filename = string(path);
+	filename = directory + '/' + filename;
+
+	TextureImage image;
+	image.pixels = nullptr;
+	image.width = image.height = 0;
+	image.name = filename;
+
+	vector<unsigned char> source;
+
+	if (!ReadFileBytes(filename, source) || source.empty())
+	{
+		return image;
+	}
+
+	bool cached = IsTextureCacheEnabled();
+	string cachePath;
+
+	if (cached)
+	{
+		cachePath = TextureCachePath(HashTextureSource(source), flipVertically, 3);
+
+		if (ReadCachedTexture(cachePath, image.compressed))
+		{
+			image.width = image.compressed.width;
+			image.height = image.compressed.height;
+			GetMemoryTracker().Add(MEMORY_IMAGE, image.name, (long long)TextureImageBytes(image), 0);
+
+			return image;
+		}
+	}
+
+	image.pixels = SOIL_load_image_from_memory(&source[0], (int)source.size(), &image.width, &image.height, 0, SOIL_LOAD_RGB);
+
+	if (!image.pixels)
+	{
+		return image;
+	}
+
+	if (flipVertically)
+	{
+		FlipTextureImage(image);
+	}
+
+	if (cached && CompressTexture(image.pixels, image.width, image.height, 3, image.compressed))
+	{
+		PROFILE_ZONE("WriteCachedTexture");
+
+		WriteCachedTexture(cachePath, image.compressed);
+		SOIL_free_image_data(image.pixels);
+		image.pixels = nullptr;
+	}
+
+	GetMemoryTracker().Add(MEMORY_IMAGE, image.name, (long long)TextureImageBytes(image), 0);
+
+	return image;
+}
+
+// Fills the texture with tightly packed RGB rows and builds its mipmaps. pixels is client memory, or an
+// offset into the pixel unpack buffer bound.
+inline void SetTextureImage(GLuint textureID, GLsizei width, GLsizei height, const GLvoid *pixels)
+{
+	// Assign texture to ID
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	// Parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Either kind of image; data as in SetTextureImage. Tags the texture's GPU memory.
+inline void SetTextureImage(GLuint textureID, const TextureImage &image, const GLvoid *data)
+{
+	if (IsCompressed(image))
+	{
+		SetCompressedTextureImage(textureID, image.compressed, (const unsigned char *)data);
+		GetMemoryTracker().Add(MEMORY_TEXTURE, image.name, 0, CompressedTextureSize(image.compressed));
+	}
+	else
+	{
+		SetTextureImage(textureID, image.width, image.height, data);
+		// RGB8 is usually stored as RGBA8, and the mip chain adds about a third
+		GetMemoryTracker().Add(MEMORY_TEXTURE, image.name, 0, EstimateTextureBytes(image.width, image.height, 4, true));
+	}
+}
+
+// Frees the decoded pixels or compressed blocks, whether they were uploaded or not
+inline void FreeTextureImage(TextureImage &image)
+{
+	size_t bytes = TextureImageBytes(image);
+
+	if (bytes)
+	{
+		GetMemoryTracker().Add(MEMORY_IMAGE, image.name, -(long long)bytes, 0);
+	}
+
+	SOIL_free_image_data(image.pixels);
+	image.pixels = nullptr;
+	vector<unsigned char>().swap(image.compressed.data);
+}
+
+// Creates the texture from decoded pixels and frees them, must run on the context's thread.
+// With a textureID the pixels replace that texture's contents instead of creating a new one.
+GLuint UploadTexture(TextureImage &image, GLuint textureID = 0)
+{
+	PROFILE_ZONE("UploadTexture");
+
+	//Generate texture ID and load texture data
+	if (!textureID)
+	{
+		glGenTextures(1, &textureID);
+	}
+
+	if (TextureImageData(image))
+	{
+		SetTextureImage(textureID, image, TextureImageData(image));
+	}
+	else
+	{
+		// Nothing decoded: the texture is left empty, as it always was
+		SetTextureImage(textureID, image.width, image.height, nullptr);
+	}
+
+	FreeTextureImage(image);
+
+	return textureID;
+}
+
+// Uploads per Update() when the scene doesn't give a budget; a 2048x2048 RGB upload plus its mipmaps
+// takes a few milliseconds, so this keeps a burst of finished decodes from stalling one frame.
+const GLuint TEXTURE_LOADER_UPLOADS_PER_FRAME = 4;
+
+// Decodes textures on the job system and uploads them on the GL thread. Load() returns at once with a
+// texture that holds a grey 1x1 placeholder, so meshes and batches can be built with their final ids;
+// a job reads and decodes the file, and Update() (once per frame, on the context's thread) uploads the
+// pixels of the decodes that finished into that same texture. A file that can't be read is reported by
+// Update() and keeps the placeholder, nothing waits for it. Loading many textures decodes them on every
+// worker at once; a JobSystem of a single thread decodes one per Update() instead.
+// The pixels travel through a PixelUploadRing: when it is persistently mapped the decode job copies them
+// into the staging memory itself, otherwise Update does. Either way glTexImage2D reads from the buffer
+// and returns without copying.
+class TextureLoader
+{
+public:
+	explicit TextureLoader(JobSystem &jobs) : jobs(jobs), ringCreated(false), failed(0), uploaded(0)
+	{
+	}
+
+	// Destroy() must have run while the context was current, the ring's buffer is gone by then
+	~TextureLoader()
+	{
+		this->Destroy();
+	}
+
+	// Waits for the decodes still running (their jobs point to this loader), drops what wasn't uploaded
+	// and frees the upload ring. On the context's thread, before the context is destroyed.
+	void Destroy()
+	{
+		this->waitJobs();
+
+		for (GLuint i = 0; i < this->ready.size(); i++)
+		{
+			if (this->ready[i].staged)
+			{
+				this->ring.Release(this->ready[i].region);
+			}
+
+			FreeTextureImage(this->ready[i].image);
+		}
+
+		this->ready.clear();
+		this->ring.Destroy();
+	}
+
+	// Same arguments as TextureFromFile. Must be called on the context's thread; a file already requested
+	// returns the texture it got the first time.
+	GLuint Load(const char *path, string directory, bool flipVertically = false)
+	{
+		PROFILE_ZONE("TextureLoader::Load");
+
+		if (!this->ringCreated)
+		{
+			this->ring.Create();
+			this->ringCreated = true;
+		}
+
+		string filename = directory + '/' + string(path);
+		map<string, GLuint>::const_iterator found = this->textures.find(filename);
+
+		if (found != this->textures.end())
+		{
+			return found->second;
+		}
+
+		const unsigned char placeholder[3] = { 128, 128, 128 };
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		this->textures[filename] = textureID;
+
+		string file = path;
+		Job *job = this->jobs.Create([this, textureID, file, directory, flipVertically]
+		{
+			Decoded decoded = { textureID, DecodeTextureFile(file.c_str(), directory, flipVertically), false };
+
+			// Straight into the staging memory, the GL thread only has to issue the upload
+			if (TextureImageData(decoded.image) && this->ring.IsPersistent() && this->ring.Allocate(TextureImageBytes(decoded.image), decoded.region))
+			{
+				memcpy(decoded.region.pointer, TextureImageData(decoded.image), decoded.region.size);
+				FreeTextureImage(decoded.image);
+				decoded.staged = true;
+			}
+
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->ready.push_back(decoded);
+		});
+
+		this->running.push_back(job);
+		this->jobs.Run(job);
+
+		return textureID;
+	}
+
+	// Uploads up to maxUploads finished decodes and reports the failed ones. Call once per frame on the
+	// context's thread. Returns the textures uploaded.
+	GLuint Update(GLuint maxUploads = TEXTURE_LOADER_UPLOADS_PER_FRAME)
+	{
+		PROFILE_ZONE("TextureLoader::Update");
+
+		this->ring.Reclaim();
+
+		// Without worker threads nobody else runs the decodes: one per call here
+		if (this->jobs.GetThreadCount() <= 1 && !this->running.empty())
+		{
+			this->jobs.Wait(this->running.back());
+		}
+
+		vector<Decoded> finished;
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			while (!this->ready.empty() && finished.size() < maxUploads)
+			{
+				finished.push_back(this->ready.front());
+				this->ready.pop_front();
+			}
+		}
+
+		GLuint uploads = 0;
+
+		for (GLuint i = 0; i < finished.size(); i++)
+		{
+			Decoded &decoded = finished[i];
+
+			// Not staged yet (the ring isn't mapped, or had no room when the job finished): copy them in now
+			if (!decoded.staged && TextureImageData(decoded.image) && this->ring.Allocate(TextureImageBytes(decoded.image), decoded.region))
+			{
+				decoded.staged = true;
+			}
+
+			if (decoded.staged)
+			{
+				SetTextureImage(decoded.textureID, decoded.image, this->ring.Upload(decoded.region, TextureImageData(decoded.image)));
+				this->ring.Submit(decoded.region);
+				FreeTextureImage(decoded.image);
+				uploads++;
+			}
+			else if (TextureImageData(decoded.image))
+			{
+				// Bigger than the whole ring, or no fences
+				UploadTexture(decoded.image, decoded.textureID);
+				uploads++;
+			}
+			else
+			{
+				std::cout << "ERROR::TEXTURE_LOADER::DECODE_FAILED " << finished[i].image.name << std::endl;
+				this->failed++;
+			}
+		}
+
+		this->uploaded += uploads;
+
+		// Forget the jobs that are done, their handles are reused once the job ring wraps
+		for (GLuint i = 0; i < this->running.size();)
+		{
+			if (this->jobs.IsFinished(this->running[i]))
+			{
+				this->running[i] = this->running.back();
+				this->running.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		return uploads;
+	}
+
+	// Waits for every requested texture and uploads all of them, e.g. before a benchmark starts. The calling
+	// thread decodes too while it waits.
+	void Finish()
+	{
+		PROFILE_ZONE("TextureLoader::Finish");
+
+		this->waitJobs();
+		this->Update(UINT_MAX);
+	}
+
+	// Textures requested whose pixels aren't uploaded yet
+	GLuint GetPendingCount() const
+	{
+		return (GLuint)this->textures.size() - this->uploaded - this->failed;
+	}
+
+	// Files that couldn't be decoded so far
+	GLuint GetFailedCount() const
+	{
+		return this->failed;
+	}
+
+private:
+	struct Decoded
+	{
+		GLuint textureID;
+		TextureImage image;
+		bool staged;				// The pixels are in region (or go there in Update)
+		PixelUploadRegion region;
+	};
+
+	JobSystem &jobs;
+	PixelUploadRing ring;
+	bool ringCreated;
+	map<string, GLuint> textures;	// Every file requested, by its full path
+	vector<Job *> running;			// Decode jobs that may still be running, only touched on the GL thread
+	std::mutex mutex;
+	deque<Decoded> ready;			// Filled by the jobs, emptied by Update
+	GLuint failed, uploaded;
+
+	void waitJobs()
+	{
+		for (GLuint i = 0; i < this->running.size(); i++)
+		{
+			this->jobs.Wait(this->running[i]);
+		}
+
+		this->running.clear();
+	}
+};
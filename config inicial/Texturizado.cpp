@@ -18,6 +18,7 @@
 
 // Other includes
 #include "Shader.h"
+#include "RenderContext.h"
 #include "Camera.h"
 
 
@@ -45,46 +46,25 @@ GLfloat deltaTime = 0.0f;	// Time between current frame and last frame
 GLfloat lastFrame = 0.0f;  	// Time of last frame
 
 // The MAIN function, from here we start the application and run the game loop
-int main()
+int main(int argc, char **argv)
 {
-	// Init GLFW
-	glfwInit();
-	// Set all the required options for GLFW
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-
-	// Create a GLFWwindow object that we can use for GLFW's functions
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Texturizado", nullptr, nullptr);
-
-	if (nullptr == window)
-	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-
+	// Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+	RenderContext context;
+	if (!context.Create(WIDTH, HEIGHT, "Texturizado", ParseRenderContextOptions(argc, argv)))
 		return EXIT_FAILURE;
-	}
-
-	glfwMakeContextCurrent(window);
 
-	glfwGetFramebufferSize(window, &SCREEN_WIDTH, &SCREEN_HEIGHT);
+	GLFWwindow* window = context.GetWindow();
+	SCREEN_WIDTH = context.GetWidth();
+	SCREEN_HEIGHT = context.GetHeight();
 
-	// Set the required callback functions
-	glfwSetKeyCallback(window, KeyCallback);
-	glfwSetCursorPosCallback(window, MouseCallback);
-
-	// GLFW Options
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	// Set this to true so GLEW knows to use a modern approach to retrieving function pointers and extensions
-	glewExperimental = GL_TRUE;
-	// Initialize GLEW to setup the OpenGL Function pointers
-	if (GLEW_OK != glewInit())
+	// Sin ventana no hay eventos de entrada
+	if (window)
 	{
-		std::cout << "Failed to initialize GLEW" << std::endl;
-		return EXIT_FAILURE;
+		// Set the required callback functions
+		glfwSetKeyCallback(window, KeyCallback);
+		glfwSetCursorPosCallback(window, MouseCallback);
+		// GLFW Options
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	}
 
 	// Define the viewport dimensions
@@ -194,15 +174,15 @@ int main()
 
 
 	// Game loop
-	while (!glfwWindowShouldClose(window))
+	while (!context.ShouldClose())
 	{
 		// Calculate deltatime of current frame
-		GLfloat currentFrame = glfwGetTime();
+		GLfloat currentFrame = context.GetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		// Check if any events have been activiated (key pressed, mouse moved etc.) and call corresponding response functions
-		glfwPollEvents();
+		context.PollEvents();
 		DoMovement();
 
 		// Clear the colorbuffer
@@ -235,14 +215,14 @@ int main()
 		glBindVertexArray(0);
 
 		// Swap the screen buffers
-		glfwSwapBuffers(window);
+		context.SwapBuffers();
 	}
 
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
 	// Terminate GLFW, clearing any resources allocated by GLFW.
-	glfwTerminate();
+	context.Destroy();
 
 	return 0;
 }
@@ -21,6 +21,7 @@
 
 // Other includes
 #include "Shader.h"
+#include "RenderContext.h"
 #include "Camera.h"
 #include "Model.h"
 
@@ -104,46 +105,29 @@ glm::vec3 Light1 = glm::vec3(0);
 GLfloat deltaTime = 0.0f;	// Time between current frame and last frame
 GLfloat lastFrame = 0.0f;  	// Time of last frame
 
-int main()
+int main(int argc, char **argv)
 {
-	// Init GLFW
-	glfwInit();
-	// Set all the required options for GLFW
-	/*glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);*/
-
-	// Create a GLFWwindow object that we can use for GLFW's functions
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Fuentes de luz", nullptr, nullptr);
-
-	if (nullptr == window)
-	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-
+	// Ventana, o contexto sin pantalla con --headless [--frames N] [--dump archivo.ppm]
+	RenderContext context;
+	if (!context.Create(WIDTH, HEIGHT, "Fuentes de luz", ParseRenderContextOptions(argc, argv), false))
 		return EXIT_FAILURE;
-	}
-
-	glfwMakeContextCurrent(window);
 
-	glfwGetFramebufferSize(window, &SCREEN_WIDTH, &SCREEN_HEIGHT);
+	// --glstats muestra al cerrar las llamadas a GL y los bytes subidos por frame
+	GLStatsOptions estadisticas = ParseGLStatsOptions(argc, argv);
+	GLStats glStats("fuentesDeLuz");
 
-	// Set the required callback functions
-	glfwSetKeyCallback(window, KeyCallback);
-	glfwSetCursorPosCallback(window, MouseCallback);
+	GLFWwindow* window = context.GetWindow();
+	SCREEN_WIDTH = context.GetWidth();
+	SCREEN_HEIGHT = context.GetHeight();
 
-	// GLFW Options
-	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	// Set this to true so GLEW knows to use a modern approach to retrieving function pointers and extensions
-	glewExperimental = GL_TRUE;
-	// Initialize GLEW to setup the OpenGL Function pointers
-	if (GLEW_OK != glewInit())
+	// Sin ventana no hay eventos de entrada
+	if (window)
 	{
-		std::cout << "Failed to initialize GLEW" << std::endl;
-		return EXIT_FAILURE;
+		// Set the required callback functions
+		glfwSetKeyCallback(window, KeyCallback);
+		glfwSetCursorPosCallback(window, MouseCallback);
+		// GLFW Options
+		//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	}
 
 	// Define the viewport dimensions
@@ -182,16 +166,17 @@ int main()
 	glm::mat4 projection = glm::perspective(camera.GetZoom(), (GLfloat)SCREEN_WIDTH / (GLfloat)SCREEN_HEIGHT, 0.1f, 100.0f);
 
 	// Game loop
-	while (!glfwWindowShouldClose(window))
+	while (!context.ShouldClose())
 	{
+		glStats.BeginFrame();
 
 		// Calculate deltatime of current frame
-		GLfloat currentFrame = glfwGetTime();
+		GLfloat currentFrame = context.GetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		// Check if any events have been activiated (key pressed, mouse moved etc.) and call corresponding response functions
-		glfwPollEvents();
+		context.PollEvents();
 		DoMovement();
 
 		// Clear the colorbuffer
@@ -225,9 +210,9 @@ int main()
 
 		// Point light 1
 	    glm::vec3 lightColor;
-		lightColor.x= abs(sin(glfwGetTime() *Light1.x));
-		lightColor.y= abs(sin(glfwGetTime() *Light1.y));
-		lightColor.z= sin(glfwGetTime() *Light1.z);
+		lightColor.x= abs(sin(context.GetTime() *Light1.x));
+		lightColor.y= abs(sin(context.GetTime() *Light1.y));
+		lightColor.z= sin(context.GetTime() *Light1.z);
 
 		
 		glUniform3f(glGetUniformLocation(lightingShader.Program, "pointLights[0].position"), pointLightPositions[0].x, pointLightPositions[0].y, pointLightPositions[0].z);
@@ -375,15 +360,18 @@ int main()
 
 		glBindVertexArray(0);
 
-
+		glStats.EndFrame();
 
 		// Swap the screen buffers
-		glfwSwapBuffers(window);
+		context.SwapBuffers();
 	}
 
+	if (estadisticas.report)
+		glStats.Report(std::cout);
+
 
 	// Terminate GLFW, clearing any resources allocated by GLFW.
-	glfwTerminate();
+	context.Destroy();
 
 
 